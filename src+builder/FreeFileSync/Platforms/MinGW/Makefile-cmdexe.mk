@@ -154,6 +154,7 @@ CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/ui/taskbar.cpp
 CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/ui/triple_splitter.cpp
 CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/ui/tray_icon.cpp
 CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/lib/binary.cpp
+CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/lib/change_list.cpp
 CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/lib/db_file.cpp
 CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/lib/dir_lock.cpp
 CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/lib/hard_filter.cpp
@@ -162,6 +163,7 @@ CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/lib/icon_loader.cpp
 CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/lib/localization.cpp
 CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/lib/parallel_scan.cpp
 CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/lib/process_xml.cpp
+CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/lib/scan_index.cpp
 CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/lib/resolve_path.cpp
 CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/lib/perf_check.cpp
 CPP_LIST+=$(PROJECT_TOP)/FreeFileSync/Source/lib/status_handler.cpp
@@ -7,12 +7,16 @@
 #include "monitor.h"
 #include <ctime>
 #include <set>
+#include <deque>
 #include <zen/file_access.h>
 #include <zen/dir_watcher.h>
 #include <zen/thread.h>
 #include <zen/tick_count.h>
 #include <wx/utils.h>
+#include <zen/scope_guard.h>
 #include "../lib/resolve_path.h"
+#include "../lib/ffs_paths.h"
+#include "../lib/change_list.h"
 //#include "../library/db_file.h"     //SYNC_DB_FILE_ENDING -> complete file too much of a dependency; file ending too little to decouple into single header
 //#include "../library/lock_holder.h" //LOCK_FILE_ENDING
 //TEMP_FILE_ENDING
@@ -36,33 +40,18 @@ std::vector<Zstring> getFormattedDirs(const std::vector<Zstring>& folderPathPhra
 }
 
 
-//wait until changes are detected or if a directory is not available (anymore)
-struct WaitResult
-{
-    enum ChangeType
-    {
-        CHANGE_DETECTED,
-        CHANGE_DIR_MISSING
-    };
-
-    WaitResult(const zen::DirWatcher::Entry& changedItem) : type(CHANGE_DETECTED), changedItem_(changedItem) {}
-    WaitResult(const Zstring& folderPath) : type(CHANGE_DIR_MISSING), folderPath_(folderPath) {}
-
-    ChangeType type;
-    zen::DirWatcher::Entry changedItem_; //for type == CHANGE_DETECTED: file or directory
-    Zstring folderPath_;                 //for type == CHANGE_DIR_MISSING
-};
-
+using WatchList = std::vector<std::pair<Zstring, std::shared_ptr<DirWatcher>>>; //folder path => watcher
 
-WaitResult waitForChanges(const std::vector<Zstring>& folderPathPhrases, //throw FileError
-                          const std::function<void(bool readyForSync)>& onRefreshGui)
+//create watches for all folders; returns path of a folder which is not available (anymore)
+Opt<Zstring> createWatches(const std::vector<Zstring>& folderPathPhrases, WatchList& watches, //throw FileError
+                           const std::function<void()>& onRefreshGui)
 {
     const std::vector<Zstring> folderPathsFmt = getFormattedDirs(folderPathPhrases); //throw FileError
     if (folderPathsFmt.empty()) //pathological case, but we have to check else this function will wait endlessly
         throw zen::FileError(_("A folder input field is empty.")); //should have been checked by caller!
 
     //detect when volumes are removed/are not available anymore
-    std::vector<std::pair<Zstring, std::shared_ptr<DirWatcher>>> watches;
+    WatchList newWatches;
 
     for (const Zstring& folderPathFmt : folderPathsFmt)
     {
@@ -72,36 +61,84 @@ WaitResult waitForChanges(const std::vector<Zstring>& folderPathPhrases, //throw
             auto ftDirExists = runAsync([=] { return zen::dirExists(folderPathFmt); });
             //we need to check dirExists(), not somethingExists(): it's not clear if DirWatcher detects a type clash (file instead of directory!)
             while (ftDirExists.wait_for(std::chrono::milliseconds(rts::UI_UPDATE_INTERVAL / 2)) != std::future_status::ready)
-                onRefreshGui(false /*readyForSync*/); //may throw!
+                onRefreshGui(); //may throw!
             if (!ftDirExists.get())
-                return WaitResult(folderPathFmt);
+                return folderPathFmt;
 
-            watches.emplace_back(folderPathFmt, std::make_shared<DirWatcher>(folderPathFmt)); //throw FileError
+            newWatches.emplace_back(folderPathFmt, std::make_shared<DirWatcher>(folderPathFmt)); //throw FileError
         }
         catch (FileError&)
         {
             if (!somethingExists(folderPathFmt)) //a benign(?) race condition with FileError
-                return WaitResult(folderPathFmt);
+                return folderPathFmt;
             throw;
         }
     }
 
-    const std::int64_t TICKS_DIR_CHECK_INTERVAL = CHECK_DIR_INTERVAL * ticksPerSec(); //0 on error
-    TickVal lastCheck = getTicks(); //0 on error
+    watches.swap(newWatches);
+    return NoValue();
+}
+
+
+//wait until changes are detected or if a directory is not available (anymore)
+struct WaitResult
+{
+    enum ChangeType
+    {
+        CHANGE_DETECTED,
+        CHANGE_DIR_MISSING
+    };
+
+    WaitResult(const std::vector<DirWatcher::Entry>& changedItems) : type(CHANGE_DETECTED), changedItems_(changedItems) {}
+    WaitResult(const Zstring& folderPath) : type(CHANGE_DIR_MISSING), folderPath_(folderPath) {}
+
+    ChangeType type;
+    std::vector<DirWatcher::Entry> changedItems_; //for type == CHANGE_DETECTED: files or directories, including those to be ignored
+    Zstring folderPath_;                          //for type == CHANGE_DIR_MISSING
+};
+
+
+//coalesce changes of the same item: keep the most recent one
+void coalesceChanges(std::vector<DirWatcher::Entry>& changedItems)
+{
+    std::set<Zstring, LessFilePath> itemsSeen;
+
+    auto itOut = changedItems.end();
+    for (auto it = changedItems.end(); it != changedItems.begin();)
+        if (itemsSeen.insert((--it)->filepath_).second)
+            if (--itOut != it)
+                *itOut = std::move(*it);
+
+    changedItems.erase(changedItems.begin(), itOut);
+}
+
+
+WaitResult waitForChanges(const WatchList& watches, time_t nextExecDate, //throw FileError
+                          const std::function<void(bool readyForSync)>& onRefreshGui)
+{
+    using namespace std::chrono;
+
+    std::vector<const DirWatcher*> watchers;
+    for (const auto& item : watches)
+        watchers.push_back(item.second.get());
+
+    steady_clock::time_point nextDirCheck = steady_clock::now() + seconds(CHECK_DIR_INTERVAL);
     while (true)
     {
         const bool checkDirExistNow = [&]() -> bool //checking once per sec should suffice
         {
-            const TickVal now = getTicks(); //0 on error
-            if (dist(lastCheck, now) >= TICKS_DIR_CHECK_INTERVAL)
+            const steady_clock::time_point now = steady_clock::now();
+            if (now >= nextDirCheck)
             {
-                lastCheck = now;
+                nextDirCheck = now + seconds(CHECK_DIR_INTERVAL);
                 return true;
             }
             return false;
         }();
 
 
+        std::vector<DirWatcher::Entry> changedItems; //collect changes of all watchers at once: bursts of changes are handled in large batches
+
         for (auto it = watches.begin(); it != watches.end(); ++it)
         {
             const Zstring& folderPath = it->first;
@@ -113,23 +150,7 @@ WaitResult waitForChanges(const std::vector<Zstring>& folderPathPhrases, //throw
                     return WaitResult(folderPath);
             try
             {
-                std::vector<DirWatcher::Entry> changedItems = watcher.getChanges([&] { onRefreshGui(false /*readyForSync*/); /*may throw!*/ }); //throw FileError
-
-                //remove to be ignored changes
-                erase_if(changedItems, [](const DirWatcher::Entry& e)
-                {
-                    return
-#ifdef ZEN_MAC
-                        pathEndsWith(e.filepath_, Zstr("/.DS_Store")) ||
-#endif
-                        pathEndsWith(e.filepath_, Zstr(".ffs_tmp"))  ||
-                        pathEndsWith(e.filepath_, Zstr(".ffs_lock")) || //sync.ffs_lock, sync.Del.ffs_lock
-                        pathEndsWith(e.filepath_, Zstr(".ffs_db"));     //sync.ffs_db, .sync.tmp.ffs_db
-                    //no need to ignore temporal recycle bin directory: this must be caused by a file deletion anyway
-                });
-
-                if (!changedItems.empty())
-                    return WaitResult(changedItems[0]); //directory change detected
+                append(changedItems, watcher.getChanges([&] { onRefreshGui(false /*readyForSync*/); /*may throw!*/ })); //throw FileError
             }
             catch (FileError&)
             {
@@ -139,12 +160,36 @@ WaitResult waitForChanges(const std::vector<Zstring>& folderPathPhrases, //throw
             }
         }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(rts::UI_UPDATE_INTERVAL / 2));
+        if (!changedItems.empty())
+        {
+            coalesceChanges(changedItems);
+            return WaitResult(changedItems); //directory change detected
+        }
+
+        //instead of sleeping: block until changes are available or the next folder check, command execution or GUI refresh is due
+        milliseconds timeout = std::min(milliseconds(rts::UI_UPDATE_INTERVAL_IDLE), duration_cast<milliseconds>(nextDirCheck - steady_clock::now()));
+        if (nextExecDate != std::numeric_limits<time_t>::max())
+            timeout = std::min(timeout, duration_cast<milliseconds>(system_clock::from_time_t(nextExecDate) - system_clock::now()) + milliseconds(1)); //round up
+
+        DirWatcher::waitForChanges(watchers, std::max(timeout, milliseconds(0)));
         onRefreshGui(true /*readyForSync*/); //throw ?: may start sync at this presumably idle time
     }
 }
 
 
+bool ignoreChange(const DirWatcher::Entry& e)
+{
+    return
+#ifdef ZEN_MAC
+        pathEndsWith(e.filepath_, Zstr("/.DS_Store")) ||
+#endif
+        pathEndsWith(e.filepath_, Zstr(".ffs_tmp"))  ||
+        pathEndsWith(e.filepath_, Zstr(".ffs_lock")) || //sync.ffs_lock, sync.Del.ffs_lock
+        pathEndsWith(e.filepath_, Zstr(".ffs_db"));     //sync.ffs_db, .sync.tmp.ffs_db
+    //no need to ignore temporal recycle bin directory: this must be caused by a file deletion anyway
+}
+
+
 //wait until all directories become available (again) + logs in network share
 void waitForMissingDirs(const std::vector<Zstring>& folderPathPhrases, //throw FileError
                         const std::function<void(const Zstring& folderPath)>& onRefreshGui)
@@ -164,14 +209,14 @@ void waitForMissingDirs(const std::vector<Zstring>& folderPathPhrases, //throw F
                 //2. check dir existence
                 return zen::dirExists(folderPathFmt);
             });
-            while (ftDirExisting.wait_for(std::chrono::milliseconds(rts::UI_UPDATE_INTERVAL / 2)) != std::future_status::ready)
+            while (ftDirExisting.wait_for(std::chrono::milliseconds(rts::UI_UPDATE_INTERVAL_IDLE)) != std::future_status::ready)
                 onRefreshGui(folderPathFmt); //may throw!
 
             if (!ftDirExisting.get())
             {
                 allExisting = false;
                 //wait some time...
-                const int refreshInterval = rts::UI_UPDATE_INTERVAL / 2;
+                const int refreshInterval = rts::UI_UPDATE_INTERVAL_IDLE;
                 static_assert(CHECK_DIR_INTERVAL * 1000 % refreshInterval == 0, "");
                 for (int i = 0; i < CHECK_DIR_INTERVAL * 1000 / refreshInterval; ++i)
                 {
@@ -187,6 +232,100 @@ void waitForMissingDirs(const std::vector<Zstring>& folderPathPhrases, //throw F
 }
 
 
+//rolling rate of changes: counted in buckets of one second
+class ChangeRate
+{
+public:
+    void addChanges(size_t count)
+    {
+        const std::int64_t now = std::time(nullptr);
+        if (buckets_.empty() || buckets_.back().first != now)
+            buckets_.emplace_back(now, 0);
+        buckets_.back().second += count;
+    }
+
+    double getChangesPerSec() //changes of the last few seconds (excluding the current one, which is incomplete)
+    {
+        const std::int64_t now = std::time(nullptr);
+        while (!buckets_.empty() && buckets_.front().first < now - WINDOW_SEC)
+            buckets_.pop_front();
+
+        size_t changeCount = 0;
+        for (const auto& bucket : buckets_)
+            if (bucket.first != now)
+                changeCount += bucket.second;
+        return static_cast<double>(changeCount) / WINDOW_SEC;
+    }
+
+private:
+    static const int WINDOW_SEC = 5;
+    std::deque<std::pair<std::int64_t, size_t>> buckets_; //second since epoch, number of changes
+};
+
+
+//all items changed since "monitoringStartTime", see change_list.h
+class ChangeRecorder
+{
+public:
+    //watches were (re-)created: changes before are unknown
+    void setWatches(const WatchList& watches)
+    {
+        watchedFolderPaths_.clear();
+        for (const auto& item : watches)
+            watchedFolderPaths_.push_back(item.first);
+        invalidate();
+    }
+
+    void addChanges(const std::vector<DirWatcher::Entry>& changedItems)
+    {
+        for (const DirWatcher::Entry& e : changedItems)
+            if (std::any_of(watchedFolderPaths_.begin(), watchedFolderPaths_.end(),
+            [&](const Zstring& folderPath) { return pathStartsWith(e.filepath_, appendSeparator(folderPath)); }))
+                changedItemPaths_.insert(e.filepath_);
+            else //e.g. "Overflow." or removal of a watched folder: changes were lost
+                invalidate();
+
+        if (changedItemPaths_.size() > CHANGED_ITEMS_MAX) //reading all folders is cheaper anyway
+            invalidate();
+    }
+
+    size_t getItemCount() const { return changedItemPaths_.size(); }
+
+    //return changes recorded so far and continue with an empty list
+    ChangeList extractChanges()
+    {
+        ChangeList changes;
+        changes.monitoringStartTime = monitoringStartTime_;
+        changes.watchedFolderPaths  = watchedFolderPaths_;
+        changes.changedItemPaths.assign(changedItemPaths_.begin(), changedItemPaths_.end());
+
+        changedItemPaths_.clear();
+        monitoringStartTime_ = std::max<std::int64_t>(monitoringStartTime_, std::time(nullptr));
+        return changes;
+    }
+
+private:
+    void invalidate()
+    {
+        changedItemPaths_.clear();
+        monitoringStartTime_ = std::time(nullptr) + 1; //second precision: changes within the current second may have been missed
+    }
+
+    static const size_t CHANGED_ITEMS_MAX = 100000;
+
+    std::int64_t monitoringStartTime_ = 0;
+    std::vector<Zstring> watchedFolderPaths_;
+    std::set<Zstring, LessFilePath> changedItemPaths_;
+};
+
+
+Zstring getChangeListFilePath()
+{
+    //one file per process: multiple RealtimeSync instances may be running
+    return getConfigDir() + Zstr("ChangeList") + FILE_NAME_SEPARATOR + Zstr("RealtimeSync_") + numberTo<Zstring>(::wxGetProcessId()) + Zstr(".ffs_changes");
+}
+
+
 inline
 wxString toString(DirWatcher::ActionType type)
 {
@@ -214,6 +353,10 @@ void rts::monitorDirectories(const std::vector<Zstring>& folderPathPhrases, unsi
         return;
     }
 
+    const Zstring changeListFilePath = getChangeListFilePath();
+    ZEN_ON_SCOPE_EXIT(try { removeFile(changeListFilePath); /*throw FileError*/ }
+    catch (FileError&) {});
+
     auto execMonitoring = [&] //throw FileError
     {
         callback.setPhase(MonitorCallback::MONITOR_PHASE_WAITING);
@@ -223,6 +366,11 @@ void rts::monitorDirectories(const std::vector<Zstring>& folderPathPhrases, unsi
         //schedule initial execution (*after* all directories have arrived, which could take some time which we don't want to include)
         time_t nextExecDate = std::time(nullptr) + delay;
 
+        //keep watches across command invocations: record changes made while the command is running for the next invocation
+        WatchList watches;
+        ChangeRecorder recorder;
+        ChangeRate changeRate;
+
         while (true) //loop over command invocations
         {
             DirWatcher::Entry lastChangeDetected;
@@ -230,25 +378,45 @@ void rts::monitorDirectories(const std::vector<Zstring>& folderPathPhrases, unsi
             {
                 while (true) //loop over detected changes
                 {
-                    //wait for changes (and for all directories to become available)
-                    WaitResult res = waitForChanges(folderPathPhrases, [&](bool readyForSync) //throw FileError, ExecCommandNowException
+                    auto onRefreshGui = [&](bool readyForSync) //throw ExecCommandNowException
                     {
                         if (readyForSync)
                             if (nextExecDate <= std::time(nullptr))
                                 throw ExecCommandNowException(); //abort wait and start sync
+                        callback.reportChangeStats(recorder.getItemCount(), changeRate.getChangesPerSec());
                         callback.requestUiRefresh();
-                    });
+                    };
+
+                    Opt<Zstring> missingFolderPath;
+                    if (watches.empty())
+                    {
+                        missingFolderPath = createWatches(folderPathPhrases, watches, [&] { onRefreshGui(false /*readyForSync*/); }); //throw FileError
+                        recorder.setWatches(watches);
+                    }
+
+                    //wait for changes (and for all directories to become available)
+                    const WaitResult res = missingFolderPath ? WaitResult(*missingFolderPath) : waitForChanges(watches, nextExecDate, onRefreshGui); //throw FileError, ExecCommandNowException
                     switch (res.type)
                     {
                         case WaitResult::CHANGE_DIR_MISSING: //don't execute the command before all directories are available!
+                            watches.clear();
                             callback.setPhase(MonitorCallback::MONITOR_PHASE_WAITING);
                             waitForMissingDirs(folderPathPhrases, [&](const Zstring& folderPath) { callback.requestUiRefresh(); }); //throw FileError
                             callback.setPhase(MonitorCallback::MONITOR_PHASE_ACTIVE);
                             break;
 
                         case WaitResult::CHANGE_DETECTED:
-                            lastChangeDetected = res.changedItem_;
-                            break;
+                        {
+                            recorder.addChanges(res.changedItems_);
+                            changeRate.addChanges(res.changedItems_.size());
+                            callback.requestUiRefresh(); //bursts of changes: keep the UI responsive
+
+                            auto it = std::find_if(res.changedItems_.begin(), res.changedItems_.end(), [](const DirWatcher::Entry& e) { return !ignoreChange(e); });
+                            if (it == res.changedItems_.end())
+                                continue; //keep waiting: don't postpone execution
+                            lastChangeDetected = *it;
+                        }
+                        break;
                     }
                     nextExecDate = std::time(nullptr) + delay;
                 }
@@ -258,9 +426,27 @@ void rts::monitorDirectories(const std::vector<Zstring>& folderPathPhrases, unsi
             ::wxSetEnv(L"change_path", utfCvrtTo<wxString>(lastChangeDetected.filepath_)); //some way to output what file changed to the user
             ::wxSetEnv(L"change_action", toString(lastChangeDetected.action_)); //
 
+            try //pass all changes to FreeFileSync: "-ChangeList %change_list%"
+            {
+                makeDirectoryRecursively(beforeLast(changeListFilePath, FILE_NAME_SEPARATOR, IF_MISSING_RETURN_NONE)); //throw FileError
+                saveChangeList(recorder.extractChanges(), changeListFilePath); //throw FileError
+                ::wxSetEnv(L"change_list", utfCvrtTo<wxString>(changeListFilePath));
+            }
+            catch (FileError&) { ::wxSetEnv(L"change_list", wxString()); } //the change list is only an optimization
+
             //execute command
             callback.executeExternalCommand();
             nextExecDate = std::numeric_limits<time_t>::max();
+
+            //changes made by the command (e.g. synchronization) don't trigger another invocation, but are recorded
+            std::vector<DirWatcher::Entry> changedItems;
+            try
+            {
+                for (const auto& item : watches)
+                    append(changedItems, item.second->getChanges([&] { callback.requestUiRefresh(); })); //throw FileError
+            }
+            catch (FileError&) { watches.clear(); } //let createWatches() report the error
+            recorder.addChanges(changedItems);
         }
     };
 
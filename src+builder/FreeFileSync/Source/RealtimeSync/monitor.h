@@ -14,6 +14,7 @@
 namespace rts
 {
 const int UI_UPDATE_INTERVAL = 100; //unit: [ms]; perform ui updates not more often than necessary, 100 seems to be a good value with only a minimal performance loss
+const int UI_UPDATE_INTERVAL_IDLE = 500; //unit: [ms]; while monitoring only the tray icon is shown: no need to wake up more often than this when nothing happens
 
 
 struct MonitorCallback
@@ -28,6 +29,7 @@ struct MonitorCallback
     virtual void setPhase(WatchPhase mode) = 0;
     virtual void executeExternalCommand () = 0;
     virtual void requestUiRefresh       () = 0;
+    virtual void reportChangeStats(size_t itemsPending, double changesPerSec) = 0; //items changed since the last command invocation
     virtual void reportError(const std::wstring& msg) = 0; //automatically retries after return!
 };
 void monitorDirectories(const std::vector<Zstring>& folderPathPhrases,
@@ -14,6 +14,7 @@
 #include <wx/timer.h>
 #include <wx+/image_tools.h>
 #include <zen/shell_execute.h>
+#include <zen/format_unit.h>
 #include <wx+/popup_dlg.h>
 #include <wx+/image_resources.h>
 #include "monitor.h"
@@ -84,7 +85,7 @@ public:
         switch (m)
         {
             case TRAY_MODE_ACTIVE:
-                setTrayIcon(trayBmp, _("Directory monitoring active"));
+                setTrayIcon(trayBmp, _("Directory monitoring active") + changeStats);
                 break;
 
             case TRAY_MODE_WAITING:
@@ -98,6 +99,16 @@ public:
         }
     }
 
+    void setChangeStats(const wxString& stats)
+    {
+        if (stats != changeStats) //avoid needless icon updates: called during each UI refresh
+        {
+            changeStats = stats;
+            if (mode == TRAY_MODE_ACTIVE)
+                setTrayIcon(trayBmp, _("Directory monitoring active") + changeStats);
+        }
+    }
+
 private:
     void OnErrorFlashIcon(wxEvent& event)
     {
@@ -191,6 +202,8 @@ private:
     bool iconFlashStatusLast; //flash try icon for TRAY_MODE_ERROR
     wxTimer timer;            //
 
+    wxString changeStats; //shown during TRAY_MODE_ACTIVE
+
     const wxString jobName_; //RTS job name, may be empty
     const wxBitmap trayBmp;
 };
@@ -231,6 +244,7 @@ public:
     }
 
     void setMode(TrayMode m) { trayObj->setMode(m); }
+    void setChangeStats(const wxString& stats) { trayObj->setChangeStats(stats); }
 
     bool getShowErrorRequested() const { return trayObj->getShowErrorRequested(); }
     void clearShowErrorRequested() { trayObj->clearShowErrorRequested(); }
@@ -299,6 +313,16 @@ rts::AbortReason rts::startDirectoryMonitor(const xmlAccess::XmlRealConfig& conf
                 trayIcon.doUiRefreshNow(); //throw AbortMonitoring
         }
 
+        void reportChangeStats(size_t itemsPending, double changesPerSec) override
+        {
+            wxString stats;
+            if (itemsPending > 0)
+                stats += L"\n" + _P("1 change", "%x changes", itemsPending);
+            if (changesPerSec > 0)
+                stats += L"\n" + replaceCpy(_("%x items/sec"), L"%x", formatTwoDigitPrecision(changesPerSec));
+            trayIcon.setChangeStats(stats);
+        }
+
         void reportError(const std::wstring& msg) override
         {
             trayIcon.setMode(TRAY_MODE_ERROR);
@@ -324,19 +324,22 @@ private:
 
         if ((!exLeftOnlyById .empty() || !exLeftOnlyByPath .empty()) &&
             (!exRightOnlyById.empty() || !exRightOnlyByPath.empty()))
-            detectMovePairs(dbFolder);
+            detectMovePairs();
     }
 
     void recurse(HierarchyObject& hierObj, const InSyncFolder* dbFolder)
     {
+        if (dbFolder)
+            dbFoldersVisited.push_back(dbFolder);
+
         for (FilePair& file : hierObj.refSubFiles())
         {
             auto getDbFileEntry = [&]() -> const InSyncFile* //evaluate lazily!
             {
                 if (dbFolder)
                 {
-                    auto it = dbFolder->files.find(file.getPairItemName());
-                    if (it != dbFolder->files.end())
+                    auto it = dbFolder->refSubFiles().find(file.getPairItemName());
+                    if (it != dbFolder->refSubFiles().end())
                         return &it->second;
                 }
                 return nullptr;
@@ -373,8 +376,8 @@ private:
             const InSyncFolder* dbSubFolder = nullptr; //try to find corresponding database entry
             if (dbFolder)
             {
-                auto it = dbFolder->folders.find(folder.getPairItemName());
-                if (it != dbFolder->folders.end())
+                auto it = dbFolder->refSubFolders().find(folder.getPairItemName());
+                if (it != dbFolder->refSubFolders().end())
                     dbSubFolder = &it->second;
             }
 
@@ -382,13 +385,13 @@ private:
         }
     }
 
-    void detectMovePairs(const InSyncFolder& container) const
+    //consider database folders matching a folder of the current comparison only: don't decode the rest of the database!
+    //a database file in a folder deleted on both sides could only be associated via file ids on both sides: not worth decoding all folders
+    void detectMovePairs() const
     {
-        for (auto& dbFile : container.files)
-            findAndSetMovePair(dbFile.second);
-
-        for (auto& dbFolder : container.folders)
-            detectMovePairs(dbFolder.second);
+        for (const InSyncFolder* dbFolder : dbFoldersVisited)
+            for (auto& dbFile : dbFolder->refSubFiles())
+                findAndSetMovePair(dbFile.second);
     }
 
     template <SelectedSide side>
@@ -453,6 +456,8 @@ private:
 
     std::unordered_map<const InSyncFile*, FilePair*> exLeftOnlyByPath; //MSVC: only 4% faster than std::map for 1 million items!
     std::unordered_map<const InSyncFile*, FilePair*> exRightOnlyByPath;
+
+    std::vector<const InSyncFolder*> dbFoldersVisited; //database folders corresponding to a folder of the current comparison
     /*
     detect renamed files:
 
@@ -529,8 +534,8 @@ private:
         const InSyncFolder::FileList::value_type* dbEntry = nullptr;
         if (dbFolder)
         {
-            auto it = dbFolder->files.find(file.getPairItemName());
-            if (it != dbFolder->files.end())
+            auto it = dbFolder->refSubFiles().find(file.getPairItemName());
+            if (it != dbFolder->refSubFiles().end())
                 dbEntry = &*it;
         }
 
@@ -565,8 +570,8 @@ private:
         const InSyncFolder::SymlinkList::value_type* dbEntry = nullptr;
         if (dbFolder)
         {
-            auto it = dbFolder->symlinks.find(symlink.getPairItemName());
-            if (it != dbFolder->symlinks.end())
+            auto it = dbFolder->refSubLinks().find(symlink.getPairItemName());
+            if (it != dbFolder->refSubLinks().end())
                 dbEntry = &*it;
         }
 
@@ -606,8 +611,8 @@ private:
         const InSyncFolder::FolderList::value_type* dbEntry = nullptr;
         if (dbFolder)
         {
-            auto it = dbFolder->folders.find(folder.getPairItemName());
-            if (it != dbFolder->folders.end())
+            auto it = dbFolder->refSubFolders().find(folder.getPairItemName());
+            if (it != dbFolder->refSubFolders().end())
                 dbEntry = &*it;
         }
 
@@ -669,16 +674,17 @@ std::vector<DirectionConfig> zen::extractDirectionCfg(const MainConfiguration& m
 void zen::redetermineSyncDirection(const DirectionConfig& dirCfg,
                                    BaseFolderPair& baseFolder,
                                    const std::function<void(const std::wstring& msg)>& reportWarning,
-                                   const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus)
+                                   const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus,
+                                   std::shared_ptr<InSyncFolder> lastSyncState)
 {
     //try to load sync-database files
-    std::shared_ptr<InSyncFolder> lastSyncState;
-    if (dirCfg.var == DirectionConfig::TWOWAY || detectMovedFilesEnabled(dirCfg))
+    if (dirCfg.var != DirectionConfig::TWOWAY && !detectMovedFilesEnabled(dirCfg))
+        lastSyncState.reset();
+    else if (allItemsCategoryEqual(baseFolder))
+        return; //nothing to do: abort and don't even try to open db files
+    else if (!lastSyncState)
         try
         {
-            if (allItemsCategoryEqual(baseFolder))
-                return; //nothing to do: abort and don't even try to open db files
-
             lastSyncState = loadLastSynchronousState(baseFolder, onUpdateStatus); //throw FileError, FileErrorDatabaseNotExisting
         }
         catch (FileErrorDatabaseNotExisting&) {} //let's ignore this error, there's no value in reporting it other than confuse users
@@ -694,8 +700,18 @@ void zen::redetermineSyncDirection(const DirectionConfig& dirCfg,
     if (dirCfg.var == DirectionConfig::TWOWAY)
     {
         if (lastSyncState)
-            RedetermineTwoWay::execute(baseFolder, *lastSyncState);
-        else //default fallback
+            try
+            {
+                RedetermineTwoWay::execute(baseFolder, *lastSyncState); //throw FileError: database folders are decoded on first access
+            }
+            catch (const FileError& e)
+            {
+                lastSyncState.reset();
+                if (reportWarning)
+                    reportWarning(e.toString() + L" \n\n" + _("Setting default synchronization directions: Old files will be overwritten with newer files."));
+            }
+
+        if (!lastSyncState) //default fallback: sets *all* directions => no leftovers of a partially evaluated database
             Redetermine::execute(getTwoWayUpdateSet(), baseFolder);
     }
     else
@@ -703,7 +719,15 @@ void zen::redetermineSyncDirection(const DirectionConfig& dirCfg,
 
     //detect renamed files
     if (lastSyncState)
-        DetectMovedFiles::execute(baseFolder, *lastSyncState);
+        try
+        {
+            DetectMovedFiles::execute(baseFolder, *lastSyncState); //throw FileError
+        }
+        catch (const FileError& e) //move pairs are always set for both files at once => pairs found so far are fine
+        {
+            if (reportWarning)
+                reportWarning(e.toString());
+        }
 }
 
 
@@ -917,10 +941,26 @@ template <FilterStrategy strategy>
 class ApplySoftFilter //falsify only! -> can run directly after "hard/base filter"
 {
 public:
-    static void execute(HierarchyObject& hierObj, const SoftFilter& timeSizeFilter) { ApplySoftFilter(hierObj, timeSizeFilter); }
+    static void execute(HierarchyObject& hierObj, const SoftFilter& timeSizeFilter) { ApplySoftFilter(timeSizeFilter).recurse(hierObj); }
+
+    static void execute(FileSystemObject& fsObj, const SoftFilter& timeSizeFilter)
+    {
+        struct Dispatch : public FSObjectVisitor
+        {
+            Dispatch(const ApplySoftFilter& sf) : sf_(sf) {}
+            void visit(const FilePair&    file  ) override { sf_.processFile(const_cast<FilePair&   >(file  )); } //object is not physically const here anyway
+            void visit(const SymlinkPair& link  ) override { sf_.processLink(const_cast<SymlinkPair&>(link  )); } //
+            void visit(const FolderPair&  folder) override { sf_.processDir (const_cast<FolderPair& >(folder)); } //
+        private:
+            const ApplySoftFilter& sf_;
+        };
+        const ApplySoftFilter sf(timeSizeFilter);
+        Dispatch dispatch(sf);
+        fsObj.accept(dispatch);
+    }
 
 private:
-    ApplySoftFilter(HierarchyObject& hierObj, const SoftFilter& timeSizeFilter) : timeSizeFilter_(timeSizeFilter) { recurse(hierObj); }
+    ApplySoftFilter(const SoftFilter& timeSizeFilter) : timeSizeFilter_(timeSizeFilter) {}
 
     void recurse(zen::HierarchyObject& hierObj) const
     {
@@ -1019,6 +1059,13 @@ void zen::addSoftFiltering(BaseFolderPair& baseFolder, const SoftFilter& timeSiz
 }
 
 
+void zen::addSoftFiltering(FileSystemObject& fsObj, const SoftFilter& timeSizeFilter)
+{
+    if (!timeSizeFilter.isNull()) //since we use STRATEGY_AND, we may skip a "null" filter
+        ApplySoftFilter<STRATEGY_AND>::execute(fsObj, timeSizeFilter);
+}
+
+
 void zen::applyFiltering(FolderComparison& folderCmp, const MainConfiguration& mainCfg)
 {
     if (folderCmp.empty())
@@ -1229,7 +1276,7 @@ void copyToAlternateFolderFrom(const std::vector<FileSystemObject*>& rowsToCopy,
 
             auto onNotifyCopyStatus = [&](std::int64_t bytesDelta) { statReporter.reportDelta(0, bytesDelta); };
             AFS::copyFileTransactional(file.getAbstractPath<side>(), targetPath, //throw FileError, ErrorFileLocked
-                                       false /*copyFilePermissions*/, true /*transactionalCopy*/, deleteTargetItem, onNotifyCopyStatus);
+                                       false /*copyFilePermissions*/, true /*transactionalCopy*/, false /*computeContentHash*/, deleteTargetItem, onNotifyCopyStatus);
             statReporter.reportDelta(1, 0);
 
             statReporter.reportFinished();
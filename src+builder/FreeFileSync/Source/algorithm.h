@@ -19,10 +19,13 @@ void swapGrids(const MainConfiguration& config, FolderComparison& folderCmp);
 
 std::vector<DirectionConfig> extractDirectionCfg(const MainConfiguration& mainCfg);
 
+struct InSyncFolder;
+
 void redetermineSyncDirection(const DirectionConfig& directConfig,
                               BaseFolderPair& baseFolder,
                               const std::function<void(const std::wstring& msg)>& reportWarning,
-                              const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus);
+                              const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus,
+                              std::shared_ptr<InSyncFolder> lastSyncState = nullptr); //optional: database already loaded by the caller (comparison by content)
 
 void redetermineSyncDirection(const MainConfiguration& mainCfg,
                               FolderComparison& folderCmp,
@@ -37,6 +40,7 @@ bool allElementsEqual(const FolderComparison& folderCmp);
 void applyFiltering  (FolderComparison& folderCmp, const MainConfiguration& mainCfg); //full filter apply
 void addHardFiltering(BaseFolderPair& baseFolder, const Zstring& excludeFilter);     //exclude additional entries only
 void addSoftFiltering(BaseFolderPair& baseFolder, const SoftFilter& timeSizeFilter); //exclude additional entries only
+void addSoftFiltering(FileSystemObject& fsObj,      const SoftFilter& timeSizeFilter); //same for a single item; folders: including all sub items
 
 void applyTimeSpanFilter(FolderComparison& folderCmp, std::int64_t timeFrom, std::int64_t timeTo); //overwrite current active/inactive settings
 
@@ -37,6 +37,7 @@
 #include "lib/process_xml.h"
 #include "lib/error_log.h"
 #include "lib/resolve_path.h"
+#include "lib/change_list.h"
 
 #ifdef ZEN_WIN
     #include <zen/win_ver.h>
@@ -274,7 +275,7 @@ void Application::onQueryEndSession(wxEvent& event)
 
 void runGuiMode  (const Zstring& globalConfigFile);
 void runGuiMode  (const Zstring& globalConfigFile, const XmlGuiConfig& guiCfg, const std::vector<Zstring>& referenceFiles, bool startComparison);
-void runBatchMode(const Zstring& globalConfigFile, const XmlBatchConfig& batchCfg, const Zstring& referenceFile, FfsReturnCode& returnCode);
+void runBatchMode(const Zstring& globalConfigFile, const XmlBatchConfig& batchCfg, const Zstring& referenceFile, const ChangeList* changeList, FfsReturnCode& returnCode);
 void showSyntaxHelp();
 
 
@@ -302,11 +303,13 @@ void Application::launch(const std::vector<Zstring>& commandArgs)
     std::vector<Zstring> dirPathPhrasesRight;
     std::vector<std::pair<Zstring, XmlType>> configFiles; //XmlType: batch or GUI files only
     Opt<Zstring> globalConfigFile;
+    Opt<Zstring> changeListFile;
     bool openForEdit = false;
     {
-        const Zchar optionEdit    [] = Zstr("-edit");
-        const Zchar optionLeftDir [] = Zstr("-leftdir");
-        const Zchar optionRightDir[] = Zstr("-rightdir");
+        const Zchar optionEdit      [] = Zstr("-edit");
+        const Zchar optionLeftDir   [] = Zstr("-leftdir");
+        const Zchar optionRightDir  [] = Zstr("-rightdir");
+        const Zchar optionChangeList[] = Zstr("-changelist");
 
         auto syntaxHelpRequested = [&](const Zstring& arg)
         {
@@ -342,6 +345,15 @@ void Application::launch(const std::vector<Zstring>& commandArgs)
                 }
                 dirPathPhrasesRight.push_back(*it);
             }
+            else if (equalNoCase(*it, optionChangeList))
+            {
+                if (++it == commandArgs.end())
+                {
+                    notifyError(replaceCpy(_("A file path is expected after %x."), L"%x", utfCvrtTo<std::wstring>(optionChangeList)), _("Syntax error"));
+                    return;
+                }
+                changeListFile = *it; //may be empty: RealtimeSync failed to write the change list
+            }
             else
             {
                 Zstring filePath = getResolvedFilePath(*it);
@@ -468,7 +480,16 @@ void Application::launch(const std::vector<Zstring>& commandArgs)
             }
             if (!replaceDirectories(batchCfg.mainCfg))
                 return;
-            runBatchMode(globalConfigFilePath, batchCfg, filepath, returnCode);
+
+            Opt<ChangeList> changeList;
+            if (changeListFile && !changeListFile->empty())
+                try
+                {
+                    changeList = loadChangeList(*changeListFile); //throw FileError
+                }
+                catch (FileError&) {} //the change list is only an optimization => read all folders
+
+            runBatchMode(globalConfigFilePath, batchCfg, filepath, changeList ? &*changeList : nullptr, returnCode);
         }
         //GUI mode: single config (ffs_gui *or* ffs_batch)
         else
@@ -554,7 +575,8 @@ void showSyntaxHelp()
                                                  L"    [" + _("global config file:") + L" GlobalSettings.xml]" + L"\n" +
                                                  L"    [" + _("config files:") + L" *.ffs_gui/*.ffs_batch]" + L"\n" +
                                                  L"    [-LeftDir " + _("directory") + L"] [-RightDir " + _("directory") + L"]" + L"\n" +
-                                                 L"    [-Edit]" + L"\n\n" +
+                                                 L"    [-Edit]" + L"\n" +
+                                                 L"    [-ChangeList " + _("file") + L"]" + L"\n\n" +
 
                                                  _("global config file:") + L"\n" +
                                                  _("Path to an alternate GlobalSettings.xml file.") + L"\n\n" +
@@ -566,11 +588,14 @@ void showSyntaxHelp()
                                                  _("Any number of alternative directory pairs for at most one config file.") + L"\n\n" +
 
                                                  L"-Edit" + L"\n" +
-                                                 _("Open configuration for editing without executing it.")));
+                                                 _("Open configuration for editing without executing it.") + L"\n\n" +
+
+                                                 L"-ChangeList " + _("file") + L"\n" +
+                                                 _("Items changed according to RealtimeSync: the scan index only needs to read folders containing changes.")));
 }
 
 
-void runBatchMode(const Zstring& globalConfigFile, const XmlBatchConfig& batchCfg, const Zstring& referenceFile, FfsReturnCode& returnCode)
+void runBatchMode(const Zstring& globalConfigFile, const XmlBatchConfig& batchCfg, const Zstring& referenceFile, const ChangeList* changeList, FfsReturnCode& returnCode)
 {
     auto notifyError = [&](const std::wstring& msg, FfsReturnCode rc)
     {
@@ -654,6 +679,14 @@ void runBatchMode(const Zstring& globalConfigFile, const XmlBatchConfig& batchCf
         FolderComparison cmpResult = compare(globalCfg.optDialogs,
                                              allowPwPrompt, //allowUserInteraction
                                              globalCfg.runWithBackgroundPriority,
+                                             globalCfg.traverserThreadsPerFolder,
+                                             globalCfg.traverserStatQueueDepth,
+                                             globalCfg.traverserStatQueueDepthPerFolder,
+                                             globalCfg.useScanIndex,
+                                             changeList,
+                                             globalCfg.contentCmpThreads,
+                                             globalCfg.contentCmpThreadsPerDevice,
+                                             globalCfg.contentCmpSampling,
                                              globalCfg.createLockFile,
                                              dirLocks,
                                              cmpConfig,
@@ -671,6 +704,7 @@ void runBatchMode(const Zstring& globalConfigFile, const XmlBatchConfig& batchCf
                     globalCfg.copyFilePermissions,
                     globalCfg.failsafeFileCopy,
                     globalCfg.runWithBackgroundPriority,
+                    globalCfg.fileCopyThreads,
                     syncProcessCfg,
                     cmpResult,
                     statusHandler);
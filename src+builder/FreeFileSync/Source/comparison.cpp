@@ -5,12 +5,16 @@
 // **************************************************************************
 
 #include "comparison.h"
+#include <deque>
+#include <unordered_map>
 #include <zen/process_priority.h>
 #include <zen/perf.h>
+#include <zen/thread.h>
 #include "algorithm.h"
 #include "lib/parallel_scan.h"
 #include "lib/dir_exist_async.h"
 #include "lib/binary.h"
+#include "lib/db_file.h"
 #include "lib/cmp_filetime.h"
 #include "lib/status_handler_impl.h"
 #include "fs/concrete.h"
@@ -163,11 +167,27 @@ void checkFolderDependency(const std::vector<ResolvedFolderPair>& folderPairs, b
 class ComparisonBuffer
 {
 public:
-    ComparisonBuffer(const std::set<DirectoryKey>& keysToRead, ProcessCallback& callback);
+    ComparisonBuffer(const std::set<DirectoryKey>& keysToRead,
+                     size_t traverserThreadsPerFolder,
+                     const std::map<AbstractPath, size_t, AFS::LessAbstractPath>& statQueueDepths,
+                     bool useScanIndex,
+                     const ChangeList* changeList,
+                     ProcessCallback& callback);
 
     //create comparison result table and fill category except for files existing on both sides: undefinedFiles and undefinedSymlinks are appended!
     std::shared_ptr<BaseFolderPair> compareByTimeSize(const ResolvedFolderPair& fp, const FolderPairCfg& fpConfig) const;
-    std::list<std::shared_ptr<BaseFolderPair>> compareByContent(const std::vector<std::pair<ResolvedFolderPair, FolderPairCfg>>& workLoad) const;
+    //lastSyncStates: receives the databases loaded for the content hashes => redetermineSyncDirection() need not read them again
+    std::list<std::shared_ptr<BaseFolderPair>> compareByContent(const std::vector<std::pair<ResolvedFolderPair, FolderPairCfg>>& workLoad,
+                                                                size_t threadsTotal, size_t threadsPerDevice, bool sampleFirst,
+                                                                std::map<const BaseFolderPair*, std::shared_ptr<InSyncFolder>>& lastSyncStates) const;
+
+    //content hash recorded by the last sync: only one side has changed since => read this side only and compare against the hash
+    struct KnownContent
+    {
+        SelectedSide sideToRead;
+        std::uint64_t contentHash;
+    };
+    using KnownContentList = std::unordered_map<const FilePair*, KnownContent>;
 
 private:
     ComparisonBuffer           (const ComparisonBuffer&) = delete;
@@ -178,12 +198,19 @@ private:
                                                       std::vector<FilePair*>& undefinedFiles,
                                                       std::vector<SymlinkPair*>& undefinedSymlinks) const;
 
+    void compareFilesParallel(const std::vector<FilePair*>& filesToCompare, const KnownContentList& knownContent, size_t threadsTotal, size_t threadsPerDevice, bool sampleFirst) const;
+
     std::map<DirectoryKey, DirectoryValue> directoryBuffer; //contains only *existing* directories
     ProcessCallback& callback_;
 };
 
 
-ComparisonBuffer::ComparisonBuffer(const std::set<DirectoryKey>& keysToRead, ProcessCallback& callback) : callback_(callback)
+ComparisonBuffer::ComparisonBuffer(const std::set<DirectoryKey>& keysToRead,
+                                   size_t traverserThreadsPerFolder,
+                                   const std::map<AbstractPath, size_t, AFS::LessAbstractPath>& statQueueDepths,
+                                   bool useScanIndex,
+                                   const ChangeList* changeList,
+                                   ProcessCallback& callback) : callback_(callback)
 {
     class CbImpl : public FillBufferCallback
     {
@@ -222,7 +249,11 @@ ComparisonBuffer::ComparisonBuffer(const std::set<DirectoryKey>& keysToRead, Pro
     fillBuffer(keysToRead, //in
                directoryBuffer, //out
                cb,
-               UI_UPDATE_INTERVAL / 2); //every ~50 ms
+               UI_UPDATE_INTERVAL / 2, //every ~50 ms
+               traverserThreadsPerFolder,
+               statQueueDepths,
+               useScanIndex,
+               changeList);
 }
 
 
@@ -411,7 +442,225 @@ void categorizeSymlinkByContent(SymlinkPair& symlink, int fileTimeTolerance, uns
 }
 
 
-std::list<std::shared_ptr<BaseFolderPair>> ComparisonBuffer::compareByContent(const std::vector<std::pair<ResolvedFolderPair, FolderPairCfg>>& workLoad) const
+using KnownContent = ComparisonBuffer::KnownContent;
+
+
+//find a file's state of the last sync: nullptr if unknown
+const InSyncFile* findDbFile(const InSyncFolder& dbRoot, const FilePair& file) //throw FileError
+{
+    const InSyncFolder* dbFolder = &dbRoot;
+    for (const Zstring& itemName : split(beforeLast(file.getPairRelativePath(), FILE_NAME_SEPARATOR, IF_MISSING_RETURN_NONE), FILE_NAME_SEPARATOR))
+        if (!itemName.empty())
+        {
+            auto it = dbFolder->refSubFolders().find(itemName); //throw FileError
+            if (it == dbFolder->refSubFolders().end())
+                return nullptr;
+            dbFolder = &it->second;
+        }
+
+    auto it = dbFolder->refSubFiles().find(file.getPairItemName()); //throw FileError
+    return it != dbFolder->refSubFiles().end() ? &it->second : nullptr;
+}
+
+
+//a file id is required: without it a different file of the same size and time could have taken the place of the synced one
+template <SelectedSide side> inline
+bool unchangedSinceSync(const FilePair& file, const InSyncFile& dbFile)
+{
+    const InSyncDescrFile& descr = SelectParam<side>::ref(dbFile.left, dbFile.right);
+    return file.getLastWriteTime<side>() == descr.lastWriteTimeRaw &&
+           !descr.fileId.empty() && file.getFileId<side>() == descr.fileId &&
+           file.getFileSize<side>() == dbFile.fileSize;
+}
+
+
+bool filesHaveSameContent(const AbstractPath& filePathL, const AbstractPath& filePathR, std::uint64_t fileSize, const KnownContent* knownContent, bool sampleFirst, //throw FileError
+                          std::uint64_t& contentHash,
+                          const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus)
+{
+    if (knownContent) //XxHash64 collisions are as unlikely as undetected read errors
+    {
+        contentHash = getFileContentHash(knownContent->sideToRead == LEFT_SIDE ? filePathL : filePathR, onUpdateStatus); //throw FileError
+        return contentHash == knownContent->contentHash;
+    }
+
+    //two stages: files differing e.g. in trailing metadata are rejected after a few reads; files passing the samples are read completely
+    if (sampleFirst && !fileSamplesMatch(filePathL, filePathR, fileSize, onUpdateStatus)) //throw FileError
+        return false;
+
+    return filesHaveSameContent(filePathL, filePathR, onUpdateStatus, &contentHash); //throw FileError
+}
+
+
+void categorizeFileByContent(FilePair& file, const Opt<std::wstring>& errMsg, bool haveSameContent, std::uint64_t contentHash)
+{
+    if (errMsg)
+        file.setCategoryConflict(*errMsg);
+    else
+    {
+        if (haveSameContent)
+        {
+            file.setContentHash(contentHash); //=> lib/db_file.cpp: next comparison only needs to read files modified in the meantime
+
+            //Caveat:
+            //1. FILE_EQUAL may only be set if short names match in case: InSyncFolder's mapping tables use short name as a key! see db_file.cpp
+            //2. FILE_EQUAL is expected to mean identical file sizes! See InSyncFile
+            //3. harmonize with "bool stillInSync()" in algorithm.cpp, FilePair::syncTo() in file_hierarchy.cpp
+            if (file.getItemName<LEFT_SIDE>() != file.getItemName<RIGHT_SIDE>())
+                file.setCategoryDiffMetadata(getDescrDiffMetaShortnameCase(file));
+            else if (!sameFileTime(file.getLastWriteTime<LEFT_SIDE>(),
+                                   file.getLastWriteTime<RIGHT_SIDE>(), file.base().getFileTimeTolerance(), file.base().getTimeShift()))
+                file.setCategoryDiffMetadata(getDescrDiffMetaDate(file));
+            else
+                file.setCategory<FILE_EQUAL>();
+        }
+        else
+            file.setCategory<FILE_DIFFERENT_CONTENT>();
+    }
+}
+
+
+/*
+Parallel content comparison:
+    - up to "threadsTotal" file pairs are compared at the same time, but at most "threadsPerDevice" of them may access the same base folder
+      => base folders approximate devices: the abstract file system does not tell which folders share a physical disk
+    - worker threads do not access the file hierarchy: paths are resolved up front, categories are set by the main thread after all workers have finished
+    - a failed comparison is repeated by the main thread to support interactive error handling (retry/ignore)
+*/
+class ContentComparisonQueue
+{
+public:
+    struct Task
+    {
+        Task(FilePair& file, const Opt<KnownContent>& knownContent, size_t deviceL, size_t deviceR) :
+            file_(file),
+            filePathL(file.getAbstractPath<LEFT_SIDE>()),
+            filePathR(file.getAbstractPath<RIGHT_SIDE>()),
+            fileSize(file.getFileSize<LEFT_SIDE>()),
+            knownContent_(knownContent),
+            deviceL_(deviceL),
+            deviceR_(deviceR) {}
+
+        FilePair& file_; //access by main thread only!
+        const AbstractPath filePathL;
+        const AbstractPath filePathR;
+        const std::uint64_t fileSize; //left and right filesizes are equal
+        const Opt<KnownContent> knownContent_;
+        const size_t deviceL_;
+        const size_t deviceR_;
+
+        bool haveSameContent = false; //written by worker thread, read by main thread after join
+        std::uint64_t contentHash = 0; //
+        bool failed          = false; //
+    };
+
+    ContentComparisonQueue(const std::vector<FilePair*>& filesToCompare, const ComparisonBuffer::KnownContentList& knownContent, size_t threadsPerDevice) : threadsPerDevice_(threadsPerDevice)
+    {
+        std::map<AbstractPath, size_t, AFS::LessAbstractPath> deviceIds;
+        auto getDeviceId = [&](const AbstractPath& baseFolderPath) { return deviceIds.emplace(baseFolderPath, deviceIds.size()).first->second; };
+
+        std::map<std::pair<size_t, size_t>, size_t> groupIdxs;
+        tasks.reserve(filesToCompare.size());
+        for (FilePair* file : filesToCompare)
+        {
+            auto itKnown = knownContent.find(file);
+            tasks.emplace_back(*file, itKnown != knownContent.end() ? Opt<KnownContent>(itKnown->second) : NoValue(),
+                               getDeviceId(file->base().getAbstractPath<LEFT_SIDE >()),
+                               getDeviceId(file->base().getAbstractPath<RIGHT_SIDE>()));
+
+            auto itGroup = groupIdxs.emplace(std::make_pair(tasks.back().deviceL_, tasks.back().deviceR_), groups.size()).first;
+            if (itGroup->second == groups.size())
+                groups.emplace_back();
+            groups[itGroup->second].push_back(tasks.size() - 1);
+        }
+        activeOps.resize(deviceIds.size());
+        tasksPending = tasks.size();
+    }
+
+    //context of worker thread: blocks until a task can be started without exceeding device limits; nullptr if there are no more tasks
+    Task* getNextTask() //throw ThreadInterruption
+    {
+        std::unique_lock<std::mutex> dummy(lockTasks);
+        std::deque<size_t>* group = nullptr;
+        interruptibleWait(conditionTasksChanged, dummy, [&] { return tasksPending == 0 || (group = findStartableGroup()) != nullptr; }); //throw ThreadInterruption
+        if (!group)
+            return nullptr;
+
+        Task& task = tasks[group->front()];
+        group->pop_front();
+        --tasksPending;
+
+        ++activeOps[task.deviceL_];
+        if (task.deviceR_ != task.deviceL_)
+            ++activeOps[task.deviceR_];
+
+        currentTaskIdx = &task - &tasks[0];
+        return &task;
+    }
+
+    //context of worker thread:
+    void reportTaskDone(Task& task, bool haveSameContent, std::uint64_t contentHash, bool failed)
+    {
+        {
+            std::lock_guard<std::mutex> dummy(lockTasks);
+            task.haveSameContent = haveSameContent;
+            task.contentHash     = contentHash;
+            task.failed          = failed;
+
+            --activeOps[task.deviceL_];
+            if (task.deviceR_ != task.deviceL_)
+                --activeOps[task.deviceR_];
+        }
+        if (!failed)
+            ++itemsDone;
+        conditionTasksChanged.notify_all(); //instead of notify_one(); workaround bug: https://svn.boost.org/trac/boost/ticket/7796
+    }
+
+    void addBytesDone(std::int64_t bytesDelta) { bytesDone += bytesDelta; } //context of worker thread
+
+    //context of main thread:
+    int          getItemsDone() const { return itemsDone; } //failed tasks are not counted
+    std::int64_t getBytesDone() const { return bytesDone; }
+    FilePair&    getCurrentFile() { return tasks[currentTaskIdx].file_; } //file hierarchy is not modified while comparing
+
+    std::vector<Task>& getTasks() { return tasks; } //call after all workers have finished!
+
+private:
+    ContentComparisonQueue           (const ContentComparisonQueue&) = delete;
+    ContentComparisonQueue& operator=(const ContentComparisonQueue&) = delete;
+
+    std::deque<size_t>* findStartableGroup() //call while locked!
+    {
+        for (std::deque<size_t>& group : groups)
+            if (!group.empty())
+            {
+                const Task& task = tasks[group.front()];
+                if (task.deviceL_ == task.deviceR_ ?
+                    activeOps[task.deviceL_] < threadsPerDevice_ :
+                    activeOps[task.deviceL_] < threadsPerDevice_ && activeOps[task.deviceR_] < threadsPerDevice_)
+                    return &group;
+            }
+        return nullptr;
+    }
+
+    const size_t threadsPerDevice_;
+
+    std::mutex lockTasks;
+    std::condition_variable conditionTasksChanged;
+    std::vector<Task> tasks;
+    std::vector<std::deque<size_t>> groups; //task indices grouped by device pair: all tasks of a group are subject to the same limits
+    std::vector<size_t> activeOps;          //per device
+    size_t tasksPending = 0;
+
+    std::atomic<size_t>       currentTaskIdx{ 0 }; //std:atomic is uninitialized by default!
+    std::atomic<int>          itemsDone     { 0 }; //
+    std::atomic<std::int64_t> bytesDone     { 0 }; //
+};
+
+
+std::list<std::shared_ptr<BaseFolderPair>> ComparisonBuffer::compareByContent(const std::vector<std::pair<ResolvedFolderPair, FolderPairCfg>>& workLoad,
+                                                                              size_t threadsTotal, size_t threadsPerDevice, bool sampleFirst,
+                                                                              std::map<const BaseFolderPair*, std::shared_ptr<InSyncFolder>>& lastSyncStates) const
 {
     std::list<std::shared_ptr<BaseFolderPair>> output;
     if (workLoad.empty())
@@ -419,6 +668,7 @@ std::list<std::shared_ptr<BaseFolderPair>> ComparisonBuffer::compareByContent(co
 
     //PERF_START;
     std::vector<FilePair*> filesToCompareBytewise;
+    KnownContentList knownContent;
 
     //process folder pairs one after another
     for (const auto& w : workLoad)
@@ -429,6 +679,21 @@ std::list<std::shared_ptr<BaseFolderPair>> ComparisonBuffer::compareByContent(co
 
         output.push_back(performComparison(w.first, w.second, undefinedFiles, uncategorizedLinks));
 
+        //content hashes of the last sync: files unchanged since then need not be read again
+        const bool haveCandidates = std::any_of(undefinedFiles.begin(), undefinedFiles.end(), [](const FilePair* file)
+        {
+            return file->isActive() && file->getFileSize<LEFT_SIDE>() == file->getFileSize<RIGHT_SIDE>();
+        });
+
+        std::shared_ptr<InSyncFolder> lastSyncState;
+        if (haveCandidates)
+            try
+            {
+                lastSyncState = loadLastSynchronousState(*output.back(), [&](std::int64_t bytesDelta) { callback_.requestUiRefresh(); }); //throw FileError, FileErrorDatabaseNotExisting
+                lastSyncStates[output.back().get()] = lastSyncState;
+            }
+            catch (FileError&) {} //no database or incompatible: just compare all files bytewise (redetermineSyncDirection() tries again and reports the error)
+
         //content comparison of file content happens AFTER finding corresponding files and AFTER filtering
         //in order to separate into two processes (scanning and comparing)
         for (FilePair* file : undefinedFiles)
@@ -442,7 +707,24 @@ std::list<std::shared_ptr<BaseFolderPair>> ComparisonBuffer::compareByContent(co
                 if (!file->isActive())
                     file->setCategoryConflict(getConflictSkippedBinaryComparison(*file));
                 else
-                    filesToCompareBytewise.push_back(file);
+                {
+                    const InSyncFile* dbFile = nullptr;
+                    if (lastSyncState)
+                        try { dbFile = findDbFile(*lastSyncState, *file); /*throw FileError*/ }
+                        catch (FileError&) {} //corrupt database record: ignore
+
+                    const bool unchangedL = dbFile && dbFile->contentHash && unchangedSinceSync<LEFT_SIDE >(*file, *dbFile);
+                    const bool unchangedR = dbFile && dbFile->contentHash && unchangedSinceSync<RIGHT_SIDE>(*file, *dbFile);
+
+                    if (unchangedL && unchangedR) //both sides still have the content of the last sync
+                        categorizeFileByContent(*file, NoValue(), true, *dbFile->contentHash);
+                    else
+                    {
+                        if (unchangedL || unchangedR)
+                            knownContent.emplace(file, KnownContent({ unchangedL ? RIGHT_SIDE : LEFT_SIDE, *dbFile->contentHash }));
+                        filesToCompareBytewise.push_back(file);
+                    }
+                }
             }
 
         //finish symlink categorization
@@ -461,6 +743,12 @@ std::list<std::shared_ptr<BaseFolderPair>> ComparisonBuffer::compareByContent(co
                            bytesTotal,
                            ProcessCallback::PHASE_COMPARING_CONTENT);
 
+    if (threadsTotal > 1 && filesToCompareBytewise.size() > 1)
+    {
+        compareFilesParallel(filesToCompareBytewise, knownContent, threadsTotal, std::max<size_t>(threadsPerDevice, 1), sampleFirst);
+        return output;
+    }
+
     const std::wstring txtComparingContentOfFiles = _("Comparing content of files %x");
 
     //PERF_START;
@@ -472,7 +760,10 @@ std::list<std::shared_ptr<BaseFolderPair>> ComparisonBuffer::compareByContent(co
 
         //check files that exist in left and right model but have different content
 
+        auto itKnown = knownContent.find(file);
+
         bool haveSameContent = false;
+        std::uint64_t contentHash = 0;
         Opt<std::wstring> errMsg = tryReportingError([&]
         {
             StatisticsReporter statReporter(1, file->getFileSize<LEFT_SIDE>(), callback_);
@@ -480,35 +771,115 @@ std::list<std::shared_ptr<BaseFolderPair>> ComparisonBuffer::compareByContent(co
             auto onUpdateStatus = [&](std::int64_t bytesDelta) { statReporter.reportDelta(0, bytesDelta); };
 
             haveSameContent = filesHaveSameContent(file->getAbstractPath<LEFT_SIDE>(),
-                                                   file->getAbstractPath<RIGHT_SIDE>(), onUpdateStatus); //throw FileError
+                                                   file->getAbstractPath<RIGHT_SIDE>(),
+                                                   file->getFileSize<LEFT_SIDE>(),
+                                                   itKnown != knownContent.end() ? &itKnown->second : nullptr, sampleFirst, contentHash, onUpdateStatus); //throw FileError
             statReporter.reportDelta(1, 0);
 
             statReporter.reportFinished();
         }, callback_); //throw X?
 
-        if (errMsg)
-            file->setCategoryConflict(*errMsg);
-        else
+        categorizeFileByContent(*file, errMsg, haveSameContent, contentHash);
+    }
+    return output;
+}
+
+
+void ComparisonBuffer::compareFilesParallel(const std::vector<FilePair*>& filesToCompare, const KnownContentList& knownContent, size_t threadsTotal, size_t threadsPerDevice, bool sampleFirst) const
+{
+    ContentComparisonQueue queue(filesToCompare, knownContent, threadsPerDevice);
+
+    std::vector<InterruptibleThread> worker;
+    worker.reserve(threadsTotal);
+
+    ZEN_ON_SCOPE_EXIT( //not only on failure: joined workers are not joinable anymore
+        for (InterruptibleThread& wt : worker)
+        if (wt.joinable())
+            wt.interrupt(); //interrupt all at once first, then join
+        for (InterruptibleThread& wt : worker)
+            if (wt.joinable())
+                wt.join();
+            );
+
+    for (size_t i = 0; i < std::min(threadsTotal, filesToCompare.size()); ++i)
+        worker.emplace_back([&queue, sampleFirst]
+    {
+#ifdef ZEN_WIN
+        setCurrentThreadName("Compare Content");
+#endif
+        while (ContentComparisonQueue::Task* task = queue.getNextTask()) //throw ThreadInterruption
         {
-            if (haveSameContent)
+            bool haveSameContent = false;
+            std::uint64_t contentHash = 0;
+            bool failed = false;
+            std::int64_t taskBytesDone = 0;
+            try
             {
-                //Caveat:
-                //1. FILE_EQUAL may only be set if short names match in case: InSyncFolder's mapping tables use short name as a key! see db_file.cpp
-                //2. FILE_EQUAL is expected to mean identical file sizes! See InSyncFile
-                //3. harmonize with "bool stillInSync()" in algorithm.cpp, FilePair::syncTo() in file_hierarchy.cpp
-                if (file->getItemName<LEFT_SIDE>() != file->getItemName<RIGHT_SIDE>())
-                    file->setCategoryDiffMetadata(getDescrDiffMetaShortnameCase(*file));
-                else if (!sameFileTime(file->getLastWriteTime<LEFT_SIDE>(),
-                                       file->getLastWriteTime<RIGHT_SIDE>(), file->base().getFileTimeTolerance(), file->base().getTimeShift()))
-                    file->setCategoryDiffMetadata(getDescrDiffMetaDate(*file));
-                else
-                    file->setCategory<FILE_EQUAL>();
+                haveSameContent = filesHaveSameContent(task->filePathL, task->filePathR, task->fileSize, task->knownContent_.get(), sampleFirst, contentHash, [&](std::int64_t bytesDelta) //throw FileError
+                {
+                    queue.addBytesDone(bytesDelta);
+                    taskBytesDone += bytesDelta;
+                    interruptionPoint(); //throw ThreadInterruption
+                });
             }
-            else
-                file->setCategory<FILE_DIFFERENT_CONTENT>();
+            catch (ThreadInterruption&) { throw; }
+            catch (...) //FileError, std::bad_alloc, ...: must not leave the thread => repeat in main thread, which reports the error or throws
+            {
+                failed = true;
+                queue.addBytesDone(-taskBytesDone); //the retry in the main thread reports these bytes again
+            }
+
+            queue.reportTaskDone(*task, haveSameContent, contentHash, failed);
         }
+    });
+
+    const std::wstring txtComparingContentOfFiles = _("Comparing content of files %x");
+
+    std::uint64_t bytesTotal = 0;
+    for (FilePair* file : filesToCompare)
+        bytesTotal += file->getFileSize<LEFT_SIDE>();
+
+    StatisticsReporter statReporter(static_cast<int>(filesToCompare.size()), bytesTotal, callback_);
+    int          itemsReported = 0;
+    std::int64_t bytesReported = 0;
+
+    auto reportProgress = [&]
+    {
+        const int          itemsDone = queue.getItemsDone();
+        const std::int64_t bytesDone = queue.getBytesDone();
+        statReporter.reportDelta(itemsDone - itemsReported, bytesDone - bytesReported); //may throw!
+        itemsReported = itemsDone;
+        bytesReported = bytesDone;
+    };
+
+    //wait until done
+    for (InterruptibleThread& wt : worker)
+        do
+        {
+            callback_.reportStatus(replaceCpy(txtComparingContentOfFiles, L"%x", fmtPath(queue.getCurrentFile().getPairRelativePath()))); //throw X
+            reportProgress(); //throw X
+        }
+        while (!wt.tryJoinFor(std::chrono::milliseconds(UI_UPDATE_INTERVAL / 2)));
+    reportProgress(); //throw X
+
+    for (ContentComparisonQueue::Task& task : queue.getTasks())
+    {
+        Opt<std::wstring> errMsg;
+        if (task.failed)
+        {
+            //repeat in main thread: allow user to retry or ignore
+            callback_.reportStatus(replaceCpy(txtComparingContentOfFiles, L"%x", fmtPath(task.file_.getPairRelativePath())));
+
+            errMsg = tryReportingError([&]
+            {
+                task.haveSameContent = filesHaveSameContent(task.filePathL, task.filePathR, task.fileSize, task.knownContent_.get(), sampleFirst, task.contentHash,
+                                                            [&](std::int64_t bytesDelta) { statReporter.reportDelta(0, bytesDelta); }); //throw FileError
+                statReporter.reportDelta(1, 0);
+            }, callback_); //throw X?
+        }
+        categorizeFileByContent(task.file_, errMsg, task.haveSameContent, task.contentHash);
     }
-    return output;
+    statReporter.reportFinished();
 }
 
 //-----------------------------------------------------------------------------------------------
@@ -516,6 +887,21 @@ std::list<std::shared_ptr<BaseFolderPair>> ComparisonBuffer::compareByContent(co
 class MergeSides
 {
 public:
+    //folder of the base folder pair: its sub tree can be merged independently
+    struct SubTreeTask
+    {
+        SubTreeTask(FolderPair& folder, const FolderContainer* lhs, const FolderContainer* rhs, const std::wstring* errorMsg) :
+            folder_(folder), lhs_(lhs), rhs_(rhs), errorMsg_(errorMsg) {}
+
+        FolderPair& folder_;
+        const FolderContainer* lhs_; //nullptr if folder exists on right side only
+        const FolderContainer* rhs_; //nullptr if folder exists on left side only
+        const std::wstring* errorMsg_;
+
+        std::vector<FilePair*>    undefinedFiles;    //append in task order => same sequence as when merging recursively
+        std::vector<SymlinkPair*> undefinedSymlinks; //
+    };
+
     MergeSides(const std::map<Zstring, std::wstring, LessFilePath>& failedItemReads,
                std::vector<FilePair*>& undefinedFilesOut,
                std::vector<SymlinkPair*>& undefinedSymlinksOut) :
@@ -523,15 +909,30 @@ public:
         undefinedFiles(undefinedFilesOut),
         undefinedSymlinks(undefinedSymlinksOut) {}
 
-    void execute(const FolderContainer& lhs, const FolderContainer& rhs, HierarchyObject& output)
+    //subTrees: optional; if bound, sub trees of the base folder's folders are not merged, but returned as tasks for executeSubTree()
+    void execute(const FolderContainer& lhs, const FolderContainer& rhs, HierarchyObject& output, std::vector<SubTreeTask>* subTrees = nullptr)
     {
         auto it = failedItemReads_.find(Zstring()); //empty path if read-error for whole base directory
 
+        subTrees_ = subTrees;
+        ZEN_ON_SCOPE_EXIT(subTrees_ = nullptr);
+
         mergeTwoSides(lhs, rhs,
                       it != failedItemReads_.end() ? &it->second : nullptr,
                       output);
     }
 
+    //may run in parallel for different tasks: each task uses its own MergeSides instance with "undefinedFilesOut/undefinedSymlinksOut" of the task
+    void executeSubTree(const SubTreeTask& task)
+    {
+        if (task.lhs_ && task.rhs_)
+            mergeTwoSides(*task.lhs_, *task.rhs_, task.errorMsg_, task.folder_);
+        else if (task.lhs_)
+            fillOneSide<LEFT_SIDE>(*task.lhs_, task.errorMsg_, task.folder_);
+        else
+            fillOneSide<RIGHT_SIDE>(*task.rhs_, task.errorMsg_, task.folder_);
+    }
+
 private:
     void mergeTwoSides(const FolderContainer& lhs, const FolderContainer& rhs, const std::wstring* errorMsg, HierarchyObject& output);
 
@@ -543,6 +944,7 @@ private:
     const std::map<Zstring, std::wstring, LessFilePath>& failedItemReads_; //base-relative paths or empty if read-error for whole base directory
     std::vector<FilePair*>& undefinedFiles;
     std::vector<SymlinkPair*>& undefinedSymlinks;
+    std::vector<SubTreeTask>* subTrees_ = nullptr; //only bound while merging the base folder
 };
 
 
@@ -674,13 +1076,19 @@ void MergeSides::mergeTwoSides(const FolderContainer& lhs, const FolderContainer
     {
         FolderPair& newFolder = output.addSubFolder<LEFT_SIDE>(dirLeft.first);
         const std::wstring* errorMsgNew = checkFailedRead(newFolder, errorMsg);
-        this->fillOneSide<LEFT_SIDE>(dirLeft.second, errorMsgNew, newFolder); //recurse
+        if (subTrees_)
+            subTrees_->emplace_back(newFolder, &dirLeft.second, nullptr, errorMsgNew);
+        else
+            this->fillOneSide<LEFT_SIDE>(dirLeft.second, errorMsgNew, newFolder); //recurse
     },
     [&](const FolderData& dirRight) //right only
     {
         FolderPair& newFolder = output.addSubFolder<RIGHT_SIDE>(dirRight.first);
         const std::wstring* errorMsgNew = checkFailedRead(newFolder, errorMsg);
-        this->fillOneSide<RIGHT_SIDE>(dirRight.second, errorMsgNew, newFolder); //recurse
+        if (subTrees_)
+            subTrees_->emplace_back(newFolder, nullptr, &dirRight.second, errorMsgNew);
+        else
+            this->fillOneSide<RIGHT_SIDE>(dirRight.second, errorMsgNew, newFolder); //recurse
     },
 
     [&](const FolderData& dirLeft, const FolderData& dirRight) //both sides
@@ -692,17 +1100,21 @@ void MergeSides::mergeTwoSides(const FolderContainer& lhs, const FolderContainer
             if (dirLeft.first != dirRight.first)
                 newFolder.setCategoryDiffMetadata(getDescrDiffMetaShortnameCase(newFolder));
 
-        mergeTwoSides(dirLeft.second, dirRight.second, errorMsgNew, newFolder); //recurse
+        if (subTrees_)
+            subTrees_->emplace_back(newFolder, &dirLeft.second, &dirRight.second, errorMsgNew);
+        else
+            mergeTwoSides(dirLeft.second, dirRight.second, errorMsgNew, newFolder); //recurse
     });
 }
 
 //-----------------------------------------------------------------------------------------------
 
 //mark excluded directories (see fillBuffer()) + remove superfluous excluded subdirectories
-void stripExcludedDirectories(HierarchyObject& hierObj, const HardFilter& filterProc)
+void stripExcludedDirectories(HierarchyObject& hierObj, const HardFilter& filterProc, bool recursive = true)
 {
-    for (FolderPair& folder : hierObj.refSubFolders())
-        stripExcludedDirectories(folder, filterProc);
+    if (recursive)
+        for (FolderPair& folder : hierObj.refSubFolders())
+            stripExcludedDirectories(folder, filterProc);
 
     //remove superfluous directories:
     //   this does not invalidate "std::vector<FilePair*>& undefinedFiles", since we delete folders only
@@ -771,20 +1183,89 @@ std::shared_ptr<BaseFolderPair> ComparisonBuffer::performComparison(const Resolv
                                                                               fpCfg.optTimeShiftHours);
 
     //PERF_START;
-    FolderContainer emptyFolderCont; //WTF!!! => using a temporary in the ternary conditional would implicitly call the FolderContainer copy-constructor!!!!!!
+    Arena emptyArena;
+    FolderContainer emptyFolderCont(emptyArena); //WTF!!! => using a temporary in the ternary conditional would implicitly call the FolderContainer copy-constructor!!!!!!
+    std::vector<MergeSides::SubTreeTask> subTrees;
     MergeSides(failedReads, undefinedFiles, undefinedSymlinks).execute(bufValueLeft  ? bufValueLeft ->folderCont : emptyFolderCont,
-                                                                       bufValueRight ? bufValueRight->folderCont : emptyFolderCont, *output);
-    //PERF_STOP;
+                                                                       bufValueRight ? bufValueRight->folderCont : emptyFolderCont, *output, &subTrees);
 
-    //##################### in/exclude rows according to filtering #####################
-    //NOTE: we need to finish de-activating rows BEFORE binary comparison is run so that it can skip them!
+    //sub trees of the base folder's folders are independent => merge and filter them in parallel:
+    //each sub tree is attached to a FolderPair created above => result does not depend on the order of execution
+    auto processSubTree = [&](MergeSides::SubTreeTask& task)
+    {
+        MergeSides(failedReads, task.undefinedFiles, task.undefinedSymlinks).executeSubTree(task);
+
+        //##################### in/exclude rows according to filtering #####################
+        //NOTE: we need to finish de-activating rows BEFORE binary comparison is run so that it can skip them!
+
+        //attention: some excluded directories are still in the comparison result! (see include filter handling!)
+        if (!fpCfg.filter.nameFilter->isNull())
+            stripExcludedDirectories(task.folder_, *fpCfg.filter.nameFilter); //mark excluded directories (see fillBuffer()) + remove superfluous excluded subdirectories
+
+        //apply soft filtering (hard filter already applied during traversal!)
+        addSoftFiltering(task.folder_, fpCfg.filter.timeSizeFilter); //falsify only => order relative to stripping "task.folder_" itself doesn't matter
+    };
 
-    //attention: some excluded directories are still in the comparison result! (see include filter handling!)
+    const size_t threadCount = std::min<size_t>(subTrees.size(), std::max(std::thread::hardware_concurrency(), 1U));
+    if (threadCount <= 1)
+        for (MergeSides::SubTreeTask& task : subTrees)
+            processSubTree(task);
+    else
+    {
+        std::vector<Arena*> arenas; //Arena is not thread-safe => one per worker
+        for (size_t i = 0; i < threadCount; ++i)
+            arenas.push_back(&output->createArena());
+
+        std::atomic<size_t> nextTaskIdx{ 0 };
+        std::vector<std::exception_ptr> exceptions(threadCount); //e.g. std::bad_alloc
+
+        std::vector<InterruptibleThread> worker;
+        ZEN_ON_SCOPE_EXIT(
+            for (InterruptibleThread& wt : worker)
+            if (wt.joinable())
+                wt.join(); //workers don't call back => no need to interrupt
+            );
+
+        for (size_t threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+            worker.emplace_back([&, threadIdx]
+        {
+#ifdef ZEN_WIN
+            setCurrentThreadName("Merge Sub Tree");
+#endif
+            try
+            {
+                for (size_t taskIdx = nextTaskIdx++; taskIdx < subTrees.size(); taskIdx = nextTaskIdx++)
+                {
+                    subTrees[taskIdx].folder_.setChildArena(*arenas[threadIdx]);
+                    processSubTree(subTrees[taskIdx]);
+                }
+            }
+            catch (...) { exceptions[threadIdx] = std::current_exception(); }
+        });
+
+        for (InterruptibleThread& wt : worker)
+            wt.join();
+
+        for (const std::exception_ptr& e : exceptions)
+            if (e)
+                std::rethrow_exception(e);
+    }
+
+    for (const MergeSides::SubTreeTask& task : subTrees)
+    {
+        append(undefinedFiles,    task.undefinedFiles);
+        append(undefinedSymlinks, task.undefinedSymlinks);
+    }
+    //PERF_STOP;
+
+    //remaining items of the base folder:
     if (!fpCfg.filter.nameFilter->isNull())
-        stripExcludedDirectories(*output, *fpCfg.filter.nameFilter); //mark excluded directories (see fillBuffer()) + remove superfluous excluded subdirectories
+        stripExcludedDirectories(*output, *fpCfg.filter.nameFilter, false /*recursive*/); //sub trees were already processed
 
-    //apply soft filtering (hard filter already applied during traversal!)
-    addSoftFiltering(*output, fpCfg.filter.timeSizeFilter);
+    for (FilePair& file : output->refSubFiles())
+        addSoftFiltering(file, fpCfg.filter.timeSizeFilter);
+    for (SymlinkPair& link : output->refSubLinks())
+        addSoftFiltering(link, fpCfg.filter.timeSizeFilter);
 
     //##################################################################################
     return output;
@@ -795,6 +1276,14 @@ std::shared_ptr<BaseFolderPair> ComparisonBuffer::performComparison(const Resolv
 FolderComparison zen::compare(xmlAccess::OptionalDialogs& warnings,
                               bool allowUserInteraction,
                               bool runWithBackgroundPriority,
+                              size_t traverserThreadsPerFolder,
+                              size_t traverserStatQueueDepth,
+                              const std::vector<std::pair<Zstring, size_t>>& traverserStatQueueDepthPerFolder,
+                              bool useScanIndex,
+                              const ChangeList* changeList,
+                              size_t contentCmpThreads,
+                              size_t contentCmpThreadsPerDevice,
+                              bool contentCmpSampling,
                               bool createDirLocks,
                               std::unique_ptr<LockHolder>& dirLocks,
                               const std::vector<FolderPairCfg>& cfgList,
@@ -875,13 +1364,24 @@ FolderComparison zen::compare(xmlAccess::OptionalDialogs& warnings,
                 dirsToRead.emplace(w.first.folderPathRight, w.second.filter.nameFilter, w.second.handleSymlinks);
         }
 
+        std::map<AbstractPath, size_t, AFS::LessAbstractPath> statQueueDepths;
+        for (const DirectoryKey& key : dirsToRead)
+        {
+            size_t& depth = statQueueDepths[key.folderPath_];
+            depth = traverserStatQueueDepth;
+            for (const auto& item : traverserStatQueueDepthPerFolder)
+                if (AFS::equalAbstractPath(createAbstractPath(item.first), key.folderPath_))
+                    depth = item.second;
+        }
+
         FolderComparison output;
+        std::map<const BaseFolderPair*, std::shared_ptr<InSyncFolder>> lastSyncStates; //loaded during comparison by content
 
         //reduce peak memory by restricting lifetime of ComparisonBuffer to have ended when loading potentially huge InSyncFolder instance in redetermineSyncDirection()
         {
             //------------ traverse/read folders -----------------------------------------------------
             //PERF_START;
-            ComparisonBuffer cmpBuff(dirsToRead, callback);
+            ComparisonBuffer cmpBuff(dirsToRead, traverserThreadsPerFolder, statQueueDepths, useScanIndex, changeList, callback);
             //PERF_STOP;
 
             //process binary comparison as one junk
@@ -895,7 +1395,7 @@ FolderComparison zen::compare(xmlAccess::OptionalDialogs& warnings,
                         workLoadByContent.push_back(w);
                         break;
                 }
-            std::list<std::shared_ptr<BaseFolderPair>> outputByContent = cmpBuff.compareByContent(workLoadByContent);
+            std::list<std::shared_ptr<BaseFolderPair>> outputByContent = cmpBuff.compareByContent(workLoadByContent, contentCmpThreads, contentCmpThreadsPerDevice, contentCmpSampling, lastSyncStates);
 
             //write output in expected order
             for (const auto& w : totalWorkLoad)
@@ -926,9 +1426,15 @@ FolderComparison zen::compare(xmlAccess::OptionalDialogs& warnings,
             callback.reportStatus(_("Calculating sync directions..."));
             callback.forceUiRefresh();
 
+            std::shared_ptr<InSyncFolder> lastSyncState;
+            auto itState = lastSyncStates.find(&*j);
+            if (itState != lastSyncStates.end())
+                lastSyncState = std::move(itState->second); //release after use: see peak memory above
+
             zen::redetermineSyncDirection(fpCfg.directionCfg, *j,
             [&](const std::wstring& warning) { callback.reportWarning(warning, warnings.warningDatabaseError); },
-            [&](std::int64_t bytesDelta) { callback.requestUiRefresh(); });//throw X
+            [&](std::int64_t bytesDelta) { callback.requestUiRefresh(); }, //throw X
+            std::move(lastSyncState));
         }
 
         return output;
@@ -12,6 +12,7 @@
 #include "process_callback.h"
 #include "lib/norm_filter.h"
 #include "lib/lock_holder.h"
+#include "lib/change_list.h"
 
 
 namespace zen
@@ -54,6 +55,14 @@ std::vector<FolderPairCfg> extractCompareCfg(const MainConfiguration& mainCfg, i
 FolderComparison compare(xmlAccess::OptionalDialogs& warnings,
                          bool allowUserInteraction,
                          bool runWithBackgroundPriority,
+                         size_t traverserThreadsPerFolder,
+                         size_t traverserStatQueueDepth, //default for all base folders: see AbstractFileSystem::traverseFolder()
+                         const std::vector<std::pair<Zstring, size_t>>& traverserStatQueueDepthPerFolder, //folder path phrase, queue depth
+                         bool useScanIndex,
+                         const ChangeList* changeList, //optional: RealtimeSync change list
+                         size_t contentCmpThreads,
+                         size_t contentCmpThreadsPerDevice,
+                         bool contentCmpSampling, //compare samples of each file pair before reading the complete content
                          bool createDirLocks,
                          std::unique_ptr<LockHolder>& dirLocks, //out
                          const std::vector<FolderPairCfg>& cfgList,
@@ -12,8 +12,13 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include <tuple>
+#include <mutex>
 #include <unordered_set>
+#include <atomic>
+#include <thread>
 #include <zen/zstring.h>
+#include <zen/arena.h>
 #include <zen/fixed_list.h>
 #include <zen/stl_tools.h>
 #include "structures.h"
@@ -93,12 +98,17 @@ struct SelectParam<RIGHT_SIDE>
 struct FolderContainer
 {
     //------------------------------------------------------------------
-    typedef std::map<Zstring, FolderContainer, LessFilePath> FolderList;  //
-    typedef std::map<Zstring, FileDescriptor,  LessFilePath> FileList;    //key: file name
-    typedef std::map<Zstring, LinkDescriptor,  LessFilePath> SymlinkList; //
+    typedef std::map<Zstring, FolderContainer, LessFilePath, ArenaAllocator<std::pair<const Zstring, FolderContainer>>> FolderList;  //
+    typedef std::map<Zstring, FileDescriptor,  LessFilePath, ArenaAllocator<std::pair<const Zstring, FileDescriptor >>> FileList;    //key: file name
+    typedef std::map<Zstring, LinkDescriptor,  LessFilePath, ArenaAllocator<std::pair<const Zstring, LinkDescriptor >>> SymlinkList; //
     //------------------------------------------------------------------
 
-    FolderContainer() = default;
+    //map nodes are allocated from "arena" which must outlive this container: millions of items => avoid per-node malloc overhead
+    explicit FolderContainer(Arena& arena) :
+        folders (FolderList ::allocator_type(arena)),
+        files   (FileList   ::allocator_type(arena)),
+        symlinks(SymlinkList::allocator_type(arena)) {}
+
     FolderContainer           (const FolderContainer&) = delete; //catch accidental (and unnecessary) copying
     FolderContainer& operator=(const FolderContainer&) = delete; //
 
@@ -109,8 +119,11 @@ struct FolderContainer
     //convenience
     FolderContainer& addSubFolder(const Zstring& itemName)
     {
-        return folders[itemName]; //value default-construction is okay here
-        //return dirs.emplace(itemName, FolderContainer()).first->second;
+        auto it = folders.lower_bound(itemName);
+        if (it != folders.end() && !folders.key_comp()(itemName, it->first)) //already existing (e.g. during folder traverser "retry")
+            return it->second;
+
+        return folders.emplace_hint(it, std::piecewise_construct, std::forward_as_tuple(itemName), std::forward_as_tuple(folders.get_allocator().getArena()))->second;
     }
 
     void addSubFile(const Zstring& itemName, const FileDescriptor& fileData)
@@ -197,11 +210,24 @@ public:
 
     BaseFolderPair& getBase() { return base_; }
 
+    //allocate child objects from a different arena of the same BaseFolderPair, e.g. to build sub trees in parallel
+    void setChildArena(Arena& arena)
+    {
+        assert(subFiles.empty() && subLinks.empty() && subFolders.empty());
+        FileList   (arena).swap(subFiles);
+        SymlinkList(arena).swap(subLinks);
+        FolderList (arena).swap(subFolders);
+    }
+
     const Zstring& getPairRelativePathPf() const { return pairRelPathPf; } //postfixed or empty!
 
 protected:
     HierarchyObject(const Zstring& relPathPf,
-                    BaseFolderPair& baseFolder) :
+                    BaseFolderPair& baseFolder,
+                    Arena& arena) : //child objects are allocated from the arena of the base folder pair
+        subFiles  (arena),
+        subLinks  (arena),
+        subFolders(arena),
         pairRelPathPf(relPathPf),
         base_(baseFolder) {}
 
@@ -227,7 +253,16 @@ private:
 
 //------------------------------------------------------------------
 
-class BaseFolderPair : public HierarchyObject //synchronization base directory
+struct ArenaOwner
+{
+    Arena arena;
+    FixedList<Arena> subTreeArenas;
+};
+
+//all FilePair/SymlinkPair/FolderPair objects of the hierarchy are allocated from a single arena and released in bulk with the BaseFolderPair
+//private base class: the arena is constructed before and destroyed after the HierarchyObject
+//the arena is not thread-safe: build sub trees in parallel via one arena per thread, see HierarchyObject::setChildArena()
+class BaseFolderPair : private ArenaOwner, public HierarchyObject //synchronization base directory
 {
 public:
     BaseFolderPair(const AbstractPath& folderPathLeft,
@@ -238,7 +273,7 @@ public:
                    CompareVariant cmpVar,
                    int fileTimeTolerance,
                    unsigned int optTimeShiftHours) :
-        HierarchyObject(Zstring(), *this),
+        HierarchyObject(Zstring(), *this, arena),
         filter_(filter), cmpVar_(cmpVar), fileTimeTolerance_(fileTimeTolerance), optTimeShiftHours_(optTimeShiftHours),
         dirExistsLeft_ (dirExistsLeft),
         dirExistsRight_(dirExistsRight),
@@ -247,6 +282,8 @@ public:
 
     template <SelectedSide side> const AbstractPath& getAbstractPath() const;
 
+    Arena& createArena() { subTreeArenas.emplace_back(); return subTreeArenas.back(); } //see HierarchyObject::setChildArena()
+
     static void removeEmpty(BaseFolderPair& baseFolder) { baseFolder.removeEmptyRec(); } //physically remove all invalid entries (where both sides are empty) recursively
 
     template <SelectedSide side> bool isExisting() const; //status of directory existence at the time of comparison!
@@ -320,34 +357,203 @@ struct FSObjectVisitor
     virtual void visit(const FolderPair&  folder ) = 0;
 };
 
+template <class T> class ObjectMgr;
+
+//weak reference to an object derived from ObjectMgr<T>: slot index + generation => a stale id is detected even if its slot was reused
+template <class T>
+class ObjectHandleConst
+{
+public:
+    ObjectHandleConst() {}
+    ObjectHandleConst(std::nullptr_t) {}
+
+    explicit operator bool() const { return slot_ != 0; }
+
+    inline friend bool operator==(const ObjectHandleConst& lhs, const ObjectHandleConst& rhs) { return lhs.slot_ == rhs.slot_ && lhs.generation_ == rhs.generation_; }
+    inline friend bool operator!=(const ObjectHandleConst& lhs, const ObjectHandleConst& rhs) { return !(lhs == rhs); }
+
+    size_t hash() const { return std::hash<std::uint64_t>()(static_cast<std::uint64_t>(generation_) << 32 | slot_); }
+
+protected:
+    ObjectHandleConst(std::uint32_t slot, std::uint32_t generation) : slot_(slot), generation_(generation) {}
+
+private:
+    friend class ObjectMgr<T>;
+
+    std::uint32_t slot_ = 0; //one-based; 0 means nullptr
+    std::uint32_t generation_ = 0;
+};
+
+template <class T>
+class ObjectHandle : public ObjectHandleConst<T>
+{
+public:
+    ObjectHandle() {}
+    ObjectHandle(std::nullptr_t) {}
+
+private:
+    friend class ObjectMgr<T>;
+    ObjectHandle(std::uint32_t slot, std::uint32_t generation) : ObjectHandleConst<T>(slot, generation) {}
+};
+
+
 //inherit from this class to allow safe random access by id instead of unsafe raw pointer
 //allow for similar semantics like std::weak_ptr without having to use std::shared_ptr
 template <class T>
 class ObjectMgr
 {
 public:
-    typedef       ObjectMgr* ObjectId;
-    typedef const ObjectMgr* ObjectIdConst;
+    typedef ObjectHandle     <T> ObjectId;
+    typedef ObjectHandleConst<T> ObjectIdConst;
 
-    ObjectIdConst  getId() const { return this; }
-    /**/  ObjectId getId()       { return this; }
+    ObjectIdConst  getId() const { return ObjectId(slot_, generation_); }
+    /**/  ObjectId getId()       { return ObjectId(slot_, generation_); }
 
     static const T* retrieve(ObjectIdConst id) //returns nullptr if object is not valid anymore
     {
-        auto it = activeObjects().find(id);
-        return static_cast<const T*>(it == activeObjects().end() ? nullptr : *it);
+        if (!id)
+            return nullptr;
+        const Slot& slot = slotTable().refSlot(id.slot_);
+        //load "obj" first: if it belongs to an object inserted into the recycled slot, the generation increment of erase() is visible, too
+        const ObjectMgr* obj = slot.obj.load(std::memory_order_acquire);
+        if (slot.generation.load(std::memory_order_acquire) != id.generation_)
+            return nullptr;
+        return static_cast<const T*>(obj);
     }
     static T* retrieve(ObjectId id) { return const_cast<T*>(retrieve(static_cast<ObjectIdConst>(id))); }
 
 protected:
-    ObjectMgr () { activeObjects().insert(this); }
-    ~ObjectMgr() { activeObjects().erase (this); }
+    ObjectMgr () { slot_ = slotTable().insert(this, generation_); } //throw std::bad_alloc
+    ~ObjectMgr() { slotTable().erase(slot_); }
 
 private:
     ObjectMgr           (const ObjectMgr& rhs) = delete;
     ObjectMgr& operator=(const ObjectMgr& rhs) = delete; //it's not well-defined what copying an objects means regarding object-identity in this context
 
-    static std::unordered_set<const ObjectMgr*>& activeObjects() { static std::unordered_set<const ObjectMgr*> inst; return inst; } //external linkage (even in header file!)
+    struct Slot
+    {
+        std::atomic<std::uint32_t> generation{ 0 }; //incremented when the object is destroyed => invalidates all of its ids
+        std::atomic<const ObjectMgr*> obj{ nullptr }; //written by insert()/erase() while other threads may call retrieve()
+    };
+
+    /*
+    slots are stored in chunks which are never moved or freed => retrieve() needs no locking or hashing
+    - new slots are handed out by an atomic counter, chunks are created on demand via compare-and-swap
+    - slots of destroyed objects are recycled via free lists sharded by thread => concurrent construction of trees scales
+    */
+    class SlotTable
+    {
+    public:
+        ~SlotTable()
+        {
+            for (std::atomic<Slot*>& chunk : chunks)
+                delete[] chunk.load();
+        }
+
+        std::uint32_t insert(const ObjectMgr* obj, std::uint32_t& generation) //throw std::bad_alloc
+        {
+            std::uint32_t slotIdx = popFreeSlot();
+            if (slotIdx == 0)
+            {
+                slotIdx = slotsUsed++ + 1;
+                if (slotIdx > CHUNK_SIZE * CHUNK_COUNT)
+                {
+                    --slotsUsed;
+                    throw std::bad_alloc();
+                }
+            }
+            Slot& slot = refSlot(slotIdx, true /*createChunk*/); //throw std::bad_alloc
+            slot.obj.store(obj, std::memory_order_release); //after the generation increment of the slot's previous erase() (ordered by the free list mutex)
+            generation = slot.generation.load(std::memory_order_relaxed);
+            return slotIdx;
+        }
+
+        void erase(std::uint32_t slotIdx)
+        {
+            Slot& slot = refSlot(slotIdx);
+            slot.generation.fetch_add(1, std::memory_order_release); //wrap-around after 2^32 objects in the same slot is harmless in practice
+            slot.obj.store(nullptr, std::memory_order_release);
+
+            FreeList& fl = getFreeList();
+            std::lock_guard<std::mutex> dummy(fl.lockSlots);
+            fl.slots.push_back(slotIdx); //on std::bad_alloc: the slot is not recycled, but also never used again
+        }
+
+        Slot& refSlot(std::uint32_t slotIdx, bool createChunk = false) //throw std::bad_alloc
+        {
+            assert(slotIdx != 0);
+            const size_t chunkIdx = (slotIdx - 1) / CHUNK_SIZE;
+            Slot* chunk = chunks[chunkIdx].load(std::memory_order_acquire);
+            if (!chunk)
+            {
+                assert(createChunk);
+                Slot* newChunk = new Slot[CHUNK_SIZE]; //throw std::bad_alloc
+                if (chunks[chunkIdx].compare_exchange_strong(chunk, newChunk, std::memory_order_acq_rel))
+                    chunk = newChunk;
+                else
+                    delete[] newChunk; //another thread was faster: "chunk" now points to its chunk
+            }
+            return chunk[(slotIdx - 1) % CHUNK_SIZE];
+        }
+
+    private:
+        struct FreeList
+        {
+            std::mutex lockSlots;
+            std::vector<std::uint32_t> slots;
+        };
+
+        FreeList& getFreeList() { return freeLists[std::hash<std::thread::id>()(std::this_thread::get_id()) % FREE_LIST_COUNT]; }
+
+        std::uint32_t popFreeSlot() //returns 0 if there is no free slot
+        {
+            FreeList& ownList = getFreeList();
+            for (;;)
+            {
+                {
+                    std::lock_guard<std::mutex> dummy(ownList.lockSlots);
+                    if (!ownList.slots.empty())
+                    {
+                        const std::uint32_t slotIdx = ownList.slots.back();
+                        ownList.slots.pop_back();
+                        return slotIdx;
+                    }
+                }
+
+                //e.g. tree was destroyed by the main thread, but is rebuilt by worker threads: steal a batch of slots at once
+                std::vector<std::uint32_t> stolenSlots;
+                for (FreeList& fl : freeLists)
+                    if (&fl != &ownList)
+                    {
+                        std::lock_guard<std::mutex> dummy(fl.lockSlots); //never hold two locks at a time!
+                        const size_t stealCount = std::min(fl.slots.size(), static_cast<size_t>(STEAL_COUNT));
+                        stolenSlots.assign(fl.slots.end() - stealCount, fl.slots.end());
+                        fl.slots.resize(fl.slots.size() - stealCount);
+                        if (!stolenSlots.empty())
+                            break;
+                    }
+                if (stolenSlots.empty())
+                    return 0;
+
+                std::lock_guard<std::mutex> dummy(ownList.lockSlots);
+                append(ownList.slots, stolenSlots);
+            }
+        }
+
+        static const std::uint32_t CHUNK_SIZE  = 64 * 1024;
+        static const std::uint32_t CHUNK_COUNT = 64 * 1024 - 1; //slot index must fit into std::uint32_t
+        static const size_t FREE_LIST_COUNT = 16;
+        static const size_t STEAL_COUNT = 1024;
+
+        std::atomic<std::uint32_t> slotsUsed{ 0 }; //slots ever handed out, including free ones
+        std::atomic<Slot*> chunks[CHUNK_COUNT] = {}; //512 kB once per process
+        FreeList freeLists[FREE_LIST_COUNT];
+    };
+
+    static SlotTable& slotTable() { static SlotTable inst; return inst; } //external linkage (even in header file!)
+
+    std::uint32_t slot_ = 0;
+    std::uint32_t generation_ = 0;
 };
 
 //------------------------------------------------------------------
@@ -459,7 +665,7 @@ public:
                HierarchyObject& parentObj,
                CompareDirResult defaultCmpResult) :
         FileSystemObject(itemNameLeft, itemNameRight, parentObj, static_cast<CompareFilesResult>(defaultCmpResult)),
-        HierarchyObject(getPairRelativePath() + FILE_NAME_SEPARATOR, parentObj.getBase())  {}
+        HierarchyObject(getPairRelativePath() + FILE_NAME_SEPARATOR, parentObj.getBase(), *parentObj.subFolders.getArena()) {}
 
     SyncOperation getSyncOperation() const override;
 
@@ -504,6 +710,10 @@ public:
 
     CompareFilesResult getFileCategory() const;
 
+    //digest of the file content: only meaningful while both sides have the same content, e.g. after comparing by content or copying
+    void setContentHash(const Opt<std::uint64_t>& hash) { contentHash = hash; }
+    const Opt<std::uint64_t>& getContentHash() const { return contentHash; }
+
     SyncOperation testSyncOperation(SyncDirection testSyncDir) const override; //semantics: "what if"! assumes "active, no conflict, no recursion (directory)!
     SyncOperation getSyncOperation() const override;
 
@@ -528,6 +738,7 @@ private:
     FileDescriptor dataRight;
 
     ObjectId moveFileRef = nullptr; //optional, filled by redetermineSyncDirection()
+    Opt<std::uint64_t> contentHash; //XxHash64; see lib/db_file.h
 };
 
 //------------------------------------------------------------------
@@ -1065,4 +1276,14 @@ void SymlinkPair::flip()
 }
 }
 
+
+namespace std
+{
+template <class T>
+struct hash<zen::ObjectHandleConst<T>>
+{
+    size_t operator()(const zen::ObjectHandleConst<T>& id) const { return id.hash(); }
+};
+}
+
 #endif //FILE_HIERARCHY_H_257235289645296
@@ -5,6 +5,7 @@
 // **************************************************************************
 
 #include "abstract.h"
+#include <zen/xxhash64.h>
 
 using namespace zen;
 using AFS = AbstractFileSystem;
@@ -13,6 +14,7 @@ const Zchar* AFS::TEMP_FILE_ENDING = Zstr(".ffs_tmp");
 
 
 AFS::FileAttribAfterCopy AFS::copyFileAsStream(const Zstring& itemPathImplSource, const AbstractPath& apTarget, //throw FileError, ErrorTargetExisting, ErrorFileLocked
+                                               bool computeContentHash,
                                                const std::function<void(std::int64_t bytesDelta)>& onNotifyCopyStatus) const
 {
     auto streamIn = getInputStream(itemPathImplSource); //throw FileError, ErrorFileLocked
@@ -27,6 +29,8 @@ AFS::FileAttribAfterCopy AFS::copyFileAsStream(const Zstring& itemPathImplSource
     auto streamOut = getOutputStream(apTarget, &fileSizeExpected, &modificationTime); //throw FileError, ErrorTargetExisting
     if (onNotifyCopyStatus) onNotifyCopyStatus(0); //throw X!
 
+    XxHash64 hash;
+
     std::vector<char> buffer(std::min(streamIn ->optimalBlockSize(),
                                       streamOut->optimalBlockSize()));
     for (;;)
@@ -37,6 +41,9 @@ AFS::FileAttribAfterCopy AFS::copyFileAsStream(const Zstring& itemPathImplSource
         streamOut->write(&buffer[0], bytesRead); //throw FileError
         bytesWritten += bytesRead;
 
+        if (computeContentHash)
+            hash.update(&buffer[0], bytesRead);
+
         if (onNotifyCopyStatus)
             onNotifyCopyStatus(bytesRead); //throw X!
 
@@ -59,6 +66,8 @@ AFS::FileAttribAfterCopy AFS::copyFileAsStream(const Zstring& itemPathImplSource
     attr.modificationTime = modificationTime;
     attr.sourceFileId     = sourceFileId;
     attr.targetFileId     = targetFileId;
+    if (computeContentHash)
+        attr.contentHash = hash.digest();
     return attr;
 }
 
@@ -66,6 +75,7 @@ AFS::FileAttribAfterCopy AFS::copyFileAsStream(const Zstring& itemPathImplSource
 AFS::FileAttribAfterCopy AFS::copyFileTransactional(const AbstractPath& apSource, const AbstractPath& apTarget, //throw FileError, ErrorFileLocked
                                                     bool copyFilePermissions,
                                                     bool transactionalCopy,
+                                                    bool computeContentHash,
                                                     const std::function<void()>& onDeleteTargetFile,
                                                     const std::function<void(std::int64_t bytesDelta)>& onNotifyCopyStatus)
 {
@@ -73,14 +83,14 @@ AFS::FileAttribAfterCopy AFS::copyFileTransactional(const AbstractPath& apSource
     {
         //caveat: typeid returns static type for pointers, dynamic type for references!!!
         if (typeid(*apSource.afs) == typeid(*apTarget.afs))
-            return apSource.afs->copyFileForSameAfsType(apSource.itemPathImpl, apTargetTmp, copyFilePermissions, onNotifyCopyStatus); //throw FileError, ErrorTargetExisting, ErrorFileLocked
+            return apSource.afs->copyFileForSameAfsType(apSource.itemPathImpl, apTargetTmp, copyFilePermissions, computeContentHash, onNotifyCopyStatus); //throw FileError, ErrorTargetExisting, ErrorFileLocked
 
         //fall back to stream-based file copy:
         if (copyFilePermissions)
             throw FileError(replaceCpy(_("Cannot write permissions of %x."), L"%x", fmtPath(AFS::getDisplayPath(apTargetTmp))),
                             _("Operation not supported for different base folder types."));
 
-        return AFS::copyFileAsStream(apSource, apTargetTmp, onNotifyCopyStatus); //throw FileError, ErrorTargetExisting, ErrorFileLocked
+        return AFS::copyFileAsStream(apSource, apTargetTmp, computeContentHash, onNotifyCopyStatus); //throw FileError, ErrorTargetExisting, ErrorFileLocked
     };
 
     if (transactionalCopy)
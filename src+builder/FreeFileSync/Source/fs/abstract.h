@@ -91,6 +91,7 @@ struct AbstractFileSystem //THREAD-SAFETY: "const" member functions must model t
 
     //----------------------------------------------------------------------------------------------------------------
 
+    static std::int64_t getModTime(const AbstractPath& ap) { return ap.afs->getModTime(ap.itemPathImpl); } //throw FileError, follows symlinks
     static void setModTime       (const AbstractPath& ap, std::int64_t modificationTime) { ap.afs->setModTime       (ap.itemPathImpl, modificationTime); } //throw FileError, follows symlinks
     static void setModTimeSymlink(const AbstractPath& ap, std::int64_t modificationTime) { ap.afs->setModTimeSymlink(ap.itemPathImpl, modificationTime); } //throw FileError
 
@@ -114,6 +115,7 @@ struct AbstractFileSystem //THREAD-SAFETY: "const" member functions must model t
     {
         virtual ~InputStream() {}
         virtual size_t read(void* buffer, size_t bytesToRead) = 0; //throw FileError; returns "bytesToRead", unless end of file!
+        virtual void setPosition(std::uint64_t offset) = 0; //throw FileError; random access: next read() starts at "offset"
         virtual FileId        getFileId          () = 0; //throw FileError
         virtual std::int64_t  getModificationTime() = 0; //throw FileError
         virtual std::uint64_t getFileSize        () = 0; //throw FileError
@@ -175,6 +177,7 @@ struct AbstractFileSystem //THREAD-SAFETY: "const" member functions must model t
         struct DirInfo
         {
             const Zstring& itemName;
+            std::int64_t lastWriteTime; //number of seconds since Jan. 1st 1970 UTC
         };
 
         enum HandleLink
@@ -199,7 +202,8 @@ struct AbstractFileSystem //THREAD-SAFETY: "const" member functions must model t
     };
 
     //- client needs to handle duplicate file reports! (FilePlusTraverser fallback, retrying to read directory contents, ...)
-    static void traverseFolder(const AbstractPath& ap, TraverserCallback& sink) { ap.afs->traverseFolder(ap.itemPathImpl, sink); }
+    //- statQueueDepth: hint for the number of concurrent item attribute requests per directory; 0: one at a time
+    static void traverseFolder(const AbstractPath& ap, TraverserCallback& sink, size_t statQueueDepth = 0) { ap.afs->traverseFolder(ap.itemPathImpl, sink, statQueueDepth); }
     //----------------------------------------------------------------------------------------------------------------
 
     static bool supportPermissionCopy(const AbstractPath& apSource, const AbstractPath& apTarget); //throw FileError
@@ -210,13 +214,15 @@ struct AbstractFileSystem //THREAD-SAFETY: "const" member functions must model t
         std::int64_t modificationTime = 0; //time_t UTC compatible
         FileId sourceFileId;
         FileId targetFileId;
+        Opt<std::uint64_t> contentHash; //XxHash64 of the data written: only if requested and supported by the copy routine
     };
     //return current attributes at the time of copy
     //symlink handling: dereference source
     static FileAttribAfterCopy copyFileAsStream(const AbstractPath& apSource, const AbstractPath& apTarget, //throw FileError, ErrorTargetExisting, ErrorFileLocked
+                                                bool computeContentHash,
                                                 //accummulated delta != file size! consider ADS, sparse, compressed files
                                                 const std::function<void(std::int64_t bytesDelta)>& onNotifyCopyStatus) //may be nullptr; throw X!
-    { return apSource.afs->copyFileAsStream(apSource.itemPathImpl, apTarget, onNotifyCopyStatus); }
+    { return apSource.afs->copyFileAsStream(apSource.itemPathImpl, apTarget, computeContentHash, onNotifyCopyStatus); }
 
 
     //Note: it MAY happen that copyFileTransactional() leaves temp files behind, e.g. temporary network drop.
@@ -226,6 +232,7 @@ struct AbstractFileSystem //THREAD-SAFETY: "const" member functions must model t
     static FileAttribAfterCopy copyFileTransactional(const AbstractPath& apSource, const AbstractPath& apTarget, //throw FileError, ErrorFileLocked
                                                      bool copyFilePermissions,
                                                      bool transactionalCopy,
+                                                     bool computeContentHash, //=> FileAttribAfterCopy::contentHash, e.g. to verify the target without reading the source again
                                                      //if target is existing user needs to implement deletion: copyFile() NEVER overwrites target if already existing!
                                                      //if transactionalCopy == true, full read access on source had been proven at this point, so it's safe to delete it.
                                                      const std::function<void()>& onDeleteTargetFile,
@@ -265,6 +272,7 @@ protected: //grant derived classes access to AbstractPath:
     static Zstring                   getItemPathImpl(const AbstractPath& ap) { return ap.itemPathImpl; }
 
     FileAttribAfterCopy copyFileAsStream(const Zstring& itemPathImplSource, const AbstractPath& apTarget, //throw FileError, ErrorTargetExisting, ErrorFileLocked
+                                         bool computeContentHash,
                                          const std::function<void(std::int64_t bytesDelta)>& onNotifyCopyStatus) const; //may be nullptr; throw X!
 
 private:
@@ -303,6 +311,7 @@ private:
     virtual bool removeFile(const Zstring& itemPathImpl) const = 0; //throw FileError
 
     //----------------------------------------------------------------------------------------------------------------
+    virtual std::int64_t getModTime(const Zstring& itemPathImpl) const = 0; //throw FileError, follows symlinks
     virtual void setModTime       (const Zstring& itemPathImpl, std::int64_t modificationTime) const = 0; //throw FileError, follows symlinks
     virtual void setModTimeSymlink(const Zstring& itemPathImpl, std::int64_t modificationTime) const = 0; //throw FileError
 
@@ -316,11 +325,12 @@ private:
                                                               const std::uint64_t* streamSize,                 //optional
                                                               const std::int64_t* modificationTime) const = 0; //
     //----------------------------------------------------------------------------------------------------------------
-    virtual void traverseFolder(const Zstring& itemPathImpl, TraverserCallback& sink) const = 0; //noexcept
+    virtual void traverseFolder(const Zstring& itemPathImpl, TraverserCallback& sink, size_t statQueueDepth) const = 0; //noexcept
     //----------------------------------------------------------------------------------------------------------------
 
     //symlink handling: follow link!
     virtual FileAttribAfterCopy copyFileForSameAfsType(const Zstring& itemPathImplSource, const AbstractPath& apTarget, bool copyFilePermissions, //throw FileError, ErrorTargetExisting, ErrorFileLocked
+                                                       bool computeContentHash,
                                                        //accummulated delta != file size! consider ADS, sparse, compressed files
                                                        const std::function<void(std::int64_t bytesDelta)>& onNotifyCopyStatus) const = 0; //may be nullptr; throw X!
 
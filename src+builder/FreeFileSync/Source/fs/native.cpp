@@ -148,6 +148,7 @@ struct InputStreamNative : public AbstractFileSystem::InputStream
     InputStreamNative(const Zstring& filePath) : fi(filePath) {} //throw FileError, ErrorFileLocked
 
     size_t read(void* buffer, size_t bytesToRead) override { return fi.read(buffer, bytesToRead); } //throw FileError; returns "bytesToRead", unless end of file!
+    void setPosition(std::uint64_t offset) override { fi.setPosition(offset); } //throw FileError
     AFS::FileId   getFileId          () override; //throw FileError
     std::int64_t  getModificationTime() override; //throw FileError
     std::uint64_t getFileSize        () override; //throw FileError
@@ -335,6 +336,12 @@ private:
 
     //----------------------------------------------------------------------------------------------------------------
 
+    std::int64_t getModTime(const Zstring& itemPathImpl) const override //throw FileError, follows symlinks
+    {
+        initComForThread(); //throw FileError
+        return zen::getFileTime(itemPathImpl); //throw FileError
+    }
+
     void setModTime(const Zstring& itemPathImpl, std::int64_t modificationTime) const override //throw FileError, follows symlinks
     {
         initComForThread(); //throw FileError
@@ -376,29 +383,31 @@ private:
     }
 
     //----------------------------------------------------------------------------------------------------------------
-    void traverseFolder(const Zstring& itemPathImpl, TraverserCallback& sink) const override //noexcept
+    void traverseFolder(const Zstring& itemPathImpl, TraverserCallback& sink, size_t statQueueDepth) const override //noexcept
     {
 #ifdef ZEN_WIN
         if (!tryReportingDirError([&] { initComForThread(); /*throw FileError*/ }, sink))
             return;
 #endif
-        DirTraverser::execute(itemPathImpl, sink); //noexcept
+        DirTraverser::execute(itemPathImpl, sink, statQueueDepth); //noexcept
     }
     //----------------------------------------------------------------------------------------------------------------
 
     //symlink handling: follow link!
     FileAttribAfterCopy copyFileForSameAfsType(const Zstring& itemPathImplSource, const AbstractPath& apTarget, bool copyFilePermissions, //throw FileError, ErrorTargetExisting, ErrorFileLocked
+                                               bool computeContentHash,
                                                const std::function<void(std::int64_t bytesDelta)>& onNotifyCopyStatus) const override //may be nullptr; throw X!
     {
         initComForThread(); //throw FileError
 
         const InSyncAttributes attrNew = copyNewFile(itemPathImplSource, getItemPathImpl(apTarget), //throw FileError, ErrorTargetExisting, ErrorFileLocked
-                                                     copyFilePermissions, onNotifyCopyStatus); //may be nullptr; throw X!
+                                                     copyFilePermissions, computeContentHash, onNotifyCopyStatus); //may be nullptr; throw X!
         FileAttribAfterCopy attrOut;
         attrOut.fileSize         = attrNew.fileSize;
         attrOut.modificationTime = attrNew.modificationTime;
         attrOut.sourceFileId     = convertToAbstractFileId(attrNew.sourceFileId);
         attrOut.targetFileId     = convertToAbstractFileId(attrNew.targetFileId);
+        attrOut.contentHash      = attrNew.contentHash;
         return attrOut;
     }
 
@@ -24,6 +24,21 @@
 #include <cstddef> //offsetof
 #include <sys/stat.h>
 #include <dirent.h>
+#ifdef ZEN_LINUX
+    #include <atomic>
+    #include <fcntl.h>         //open, AT_SYMLINK_NOFOLLOW
+    #include <unistd.h>        //syscall
+    #include <sys/syscall.h>   //SYS_getdents64
+    #include <sys/sysmacros.h> //makedev
+    #if __has_include(<linux/io_uring.h>)
+        #include <cstring>         //memset
+        #include <sys/mman.h>      //mmap
+        #include <linux/io_uring.h>
+    #endif
+    #if defined STATX_BASIC_STATS && defined IO_URING_OP_SUPPORTED && defined __NR_io_uring_setup //IO_URING_OP_SUPPORTED: same kernel headers as IORING_OP_STATX (an enum value)
+        #define ZEN_LINUX_IO_URING_STATX
+    #endif
+#endif
 
 //implementation header for native.cpp, not for reuse!!!
 
@@ -45,16 +60,289 @@ AFS::FileId convertToAbstractFileId(const zen::FileId& fid)
 }
 
 
+#ifdef ZEN_LINUX
+struct ItemAttributes
+{
+    mode_t mode = 0;
+    std::int64_t lastWriteTime = 0;
+    std::uint64_t fileSize = 0; //only filled if "withSizeAndId"
+    zen::FileId fileId;         //
+};
+
+
+#ifdef STATX_BASIC_STATS
+inline
+unsigned int getStatxMask(bool withSizeAndId) { return STATX_TYPE | STATX_MTIME | (withSizeAndId ? STATX_SIZE | STATX_INO : 0); }
+
+
+inline
+ItemAttributes convertStatx(const struct ::statx& statxData, bool withSizeAndId)
+{
+    ItemAttributes attr;
+    attr.mode          = statxData.stx_mode;
+    attr.lastWriteTime = statxData.stx_mtime.tv_sec;
+    if (withSizeAndId)
+    {
+        const dev_t deviceId = makedev(statxData.stx_dev_major, statxData.stx_dev_minor);
+        attr.fileSize = statxData.stx_size;
+        attr.fileId   = deviceId != 0 && statxData.stx_ino != 0 ? zen::FileId(deviceId, statxData.stx_ino) : zen::FileId();
+    }
+    return attr;
+}
+#endif
+
+
+//get attributes relative to the parent directory's handle: no path resolution per item
+//only request what's needed: network file systems may have to fetch each attribute separately
+bool getItemAttributes(int dirFd, const Zstring& itemName, bool followSymlink, bool withSizeAndId, ItemAttributes& attr) //return false on error, errno is set
+{
+#ifdef STATX_BASIC_STATS //glibc 2.28+
+    static std::atomic<bool> statxAvailable{ true }; //kernel 4.11+
+    if (statxAvailable)
+    {
+        struct ::statx statxData = {};
+        if (::statx(dirFd, itemName.c_str(), AT_NO_AUTOMOUNT | (followSymlink ? 0 : AT_SYMLINK_NOFOLLOW), //AT_NO_AUTOMOUNT: same as stat()/lstat()
+                    getStatxMask(withSizeAndId), &statxData) == 0)
+        {
+            attr = convertStatx(statxData, withSizeAndId);
+            return true;
+        }
+        if (errno != ENOSYS)
+            return false;
+        statxAvailable = false;
+    }
+#endif
+    struct ::stat statData = {};
+    if (::fstatat(dirFd, itemName.c_str(), &statData, followSymlink ? 0 : AT_SYMLINK_NOFOLLOW) != 0)
+        return false;
+
+    attr.mode          = statData.st_mode;
+    attr.lastWriteTime = statData.st_mtime;
+    if (withSizeAndId)
+    {
+        attr.fileSize = makeUnsigned(statData.st_size);
+        attr.fileId   = extractFileId(statData);
+    }
+    return true;
+}
+
+#ifdef ZEN_LINUX_IO_URING_STATX
+/*
+io_uring (IORING_OP_STATX: kernel 5.6+): submit the statx() requests of a complete directory at once and reap completions as they arrive
+    => keeps high-latency devices busy (NFS, cold-cache HDDs) instead of waiting for each request in turn
+    - raw system calls: no dependency on liburing
+    - not thread-safe: one instance per thread, see getStatxRing()
+*/
+class StatxRing
+{
+public:
+    explicit StatxRing(size_t queueDepth) : queueDepth_(queueDepth) //throw SysError
+    {
+        io_uring_params params = {};
+        ringFd_ = static_cast<int>(::syscall(__NR_io_uring_setup, static_cast<unsigned int>(queueDepth), &params));
+        if (ringFd_ < 0)
+            throw SysError(formatSystemError(L"io_uring_setup", getLastError()));
+        ZEN_ON_SCOPE_FAIL(cleanUp());
+
+        //IORING_REGISTER_PROBE was added with IORING_OP_STATX: failure means "not supported"
+        std::vector<char> probeBuf(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+        auto& probe = *reinterpret_cast<io_uring_probe*>(&probeBuf[0]);
+        if (::syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_PROBE, &probe, 256) < 0)
+            throw SysError(formatSystemError(L"io_uring_register", getLastError()));
+        if (probe.last_op < IORING_OP_STATX || !(probe.ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED))
+            throw SysError(L"io_uring: IORING_OP_STATX not supported.");
+
+        sqEntries_  = params.sq_entries;
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        cqRingSize_ = params.cq_off.cqes  + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+            sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+
+        sqRing_ = mapRegion(sqRingSize_, IORING_OFF_SQ_RING); //throw SysError
+        cqRing_ = params.features & IORING_FEAT_SINGLE_MMAP ? sqRing_ : mapRegion(cqRingSize_, IORING_OFF_CQ_RING); //throw SysError
+        sqes_   = static_cast<io_uring_sqe*>(mapRegion(params.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES)); //throw SysError
+
+        auto sqField = [&](std::uint32_t offset) { return reinterpret_cast<unsigned int*>(static_cast<char*>(sqRing_) + offset); };
+        auto cqField = [&](std::uint32_t offset) { return reinterpret_cast<unsigned int*>(static_cast<char*>(cqRing_) + offset); };
+        sqHead_  = sqField(params.sq_off.head);
+        sqTail_  = sqField(params.sq_off.tail);
+        sqMask_  = sqField(params.sq_off.ring_mask);
+        sqArray_ = sqField(params.sq_off.array);
+        cqHead_  = cqField(params.cq_off.head);
+        cqTail_  = cqField(params.cq_off.tail);
+        cqMask_  = cqField(params.cq_off.ring_mask);
+        cqes_    = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(cqRing_) + params.cq_off.cqes);
+    }
+
+    ~StatxRing() { cleanUp(); }
+
+    size_t getQueueDepth() const { return queueDepth_; }
+
+    //requests may still be pending after a failed execute() => must not be reused
+    bool isBroken() const { return broken_; }
+
+    struct Request
+    {
+        const char* itemName = nullptr; //relative to "dirFd"
+        unsigned int mask = 0;
+        struct ::statx statxData = {}; //out
+        int errorCode = -1;            //out: 0 on success
+    };
+
+    //symlinks are not followed; requests are processed in arbitrary order
+    //the kernel writes to "requests" asynchronously => on error all pending requests are completed before throwing (unless isBroken())
+    void execute(int dirFd, std::vector<Request>& requests) //throw SysError
+    {
+        assert(!broken_);
+        size_t nextReq   = 0;
+        size_t completed = 0;
+        size_t inFlight  = 0; //cq_entries == 2 * sq_entries: no completion queue overflow as long as "inFlight <= sq_entries"
+
+        while (completed < requests.size())
+        {
+            //refill the submission queue
+            unsigned int sqTail = *sqTail_; //we're the only writer
+            for (; nextReq < requests.size() && inFlight < sqEntries_; ++nextReq, ++inFlight, ++sqTail)
+            {
+                const unsigned int idx = sqTail & *sqMask_;
+                io_uring_sqe& sqe = sqes_[idx];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode      = IORING_OP_STATX;
+                sqe.fd          = dirFd;
+                sqe.addr        = reinterpret_cast<std::uintptr_t>(requests[nextReq].itemName);
+                sqe.len         = requests[nextReq].mask;
+                sqe.off         = reinterpret_cast<std::uintptr_t>(&requests[nextReq].statxData);
+                sqe.statx_flags = AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT;
+                sqe.user_data   = nextReq;
+                sqArray_[idx] = idx;
+            }
+            __atomic_store_n(sqTail_, sqTail, __ATOMIC_RELEASE);
+
+            //submit whatever the kernel has not consumed yet and wait for at least one completion
+            const unsigned int toSubmit = sqTail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+            if (::syscall(__NR_io_uring_enter, ringFd_, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0)
+            {
+                const ErrorCode ec = getLastError();
+                if (ec != EINTR && ec != EAGAIN && ec != EBUSY) //EAGAIN, EBUSY: kernel is short on resources, but requests are in flight
+                {
+                    abandonRequests(inFlight); //noexcept
+                    throw SysError(formatSystemError(L"io_uring_enter", ec));
+                }
+            }
+
+            //reap completions
+            unsigned int cqHead = *cqHead_;
+            const unsigned int cqTail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+            for (; cqHead != cqTail; ++cqHead, ++completed, --inFlight)
+            {
+                const io_uring_cqe& cqe = cqes_[cqHead & *cqMask_];
+                requests[static_cast<size_t>(cqe.user_data)].errorCode = cqe.res < 0 ? -cqe.res : 0;
+            }
+            __atomic_store_n(cqHead_, cqHead, __ATOMIC_RELEASE);
+        }
+    }
+
+private:
+    StatxRing           (const StatxRing&) = delete;
+    StatxRing& operator=(const StatxRing&) = delete;
+
+    //withdraw the requests not yet consumed by the kernel and wait for all others: neither may touch the caller's buffers afterwards,
+    //nor may their completions be mistaken for those of the next execute()
+    void abandonRequests(size_t inFlight) //noexcept
+    {
+        const unsigned int sqHead = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        inFlight -= *sqTail_ - sqHead;
+        __atomic_store_n(sqTail_, sqHead, __ATOMIC_RELEASE); //no IORING_SETUP_SQPOLL: the kernel only reads the submission queue during io_uring_enter()
+
+        while (inFlight > 0)
+        {
+            if (::syscall(__NR_io_uring_enter, ringFd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0)
+            {
+                const ErrorCode ec = getLastError();
+                if (ec != EINTR && ec != EAGAIN && ec != EBUSY)
+                {
+                    broken_ = true;
+                    return;
+                }
+            }
+            const unsigned int cqTail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+            inFlight -= cqTail - *cqHead_;
+            __atomic_store_n(cqHead_, cqTail, __ATOMIC_RELEASE);
+        }
+    }
+
+    void* mapRegion(size_t size, off_t offset) //throw SysError
+    {
+        void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, offset);
+        if (ptr == MAP_FAILED)
+            throw SysError(formatSystemError(L"mmap", getLastError()));
+        mappings_.emplace_back(ptr, size);
+        return ptr;
+    }
+
+    void cleanUp()
+    {
+        for (const auto& mapping : mappings_)
+            ::munmap(mapping.first, mapping.second);
+        ::close(ringFd_);
+    }
+
+    const size_t queueDepth_;
+    bool broken_ = false;
+    int ringFd_ = -1;
+    unsigned int sqEntries_ = 0;
+    size_t sqRingSize_ = 0;
+    size_t cqRingSize_ = 0;
+    std::vector<std::pair<void*, size_t>> mappings_;
+
+    void* sqRing_ = nullptr;
+    void* cqRing_ = nullptr;
+    io_uring_sqe* sqes_ = nullptr;
+    unsigned int* sqHead_  = nullptr;
+    unsigned int* sqTail_  = nullptr;
+    unsigned int* sqMask_  = nullptr;
+    unsigned int* sqArray_ = nullptr;
+    unsigned int* cqHead_ = nullptr;
+    unsigned int* cqTail_ = nullptr;
+    unsigned int* cqMask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+
+//parallel folder traversal calls AFS::traverseFolder() per folder => keep one ring per thread instead of one per call
+StatxRing* getStatxRing(size_t queueDepth) //return nullptr if io_uring is not available
+{
+    static std::atomic<bool> ioUringAvailable{ true }; //false: kernel < 5.6, blocked by seccomp, sysctl kernel.io_uring_disabled, RLIMIT_MEMLOCK...
+    thread_local std::unique_ptr<StatxRing> threadRing;
+
+    if (queueDepth == 0 || !ioUringAvailable)
+        return nullptr;
+    queueDepth = std::min<size_t>(queueDepth, 4096); //kernel limit: IORING_MAX_ENTRIES
+
+    if (!threadRing || threadRing->getQueueDepth() != queueDepth || threadRing->isBroken())
+        try
+        {
+            threadRing.reset();
+            threadRing = std::make_unique<StatxRing>(queueDepth); //throw SysError
+        }
+        catch (SysError&) { ioUringAvailable = false; }
+
+    return threadRing.get();
+}
+#endif
+#endif
+
+
 class DirTraverser
 {
 public:
-    static void execute(const Zstring& baseDirectory, AFS::TraverserCallback& sink)
+    static void execute(const Zstring& baseDirectory, AFS::TraverserCallback& sink, size_t statQueueDepth)
     {
-        DirTraverser(baseDirectory, sink);
+        DirTraverser(baseDirectory, sink, statQueueDepth);
     }
 
 private:
-    DirTraverser(const Zstring& baseDirectory, AFS::TraverserCallback& sink)
+    DirTraverser(const Zstring& baseDirectory, AFS::TraverserCallback& sink, size_t statQueueDepth) : statQueueDepth_(statQueueDepth)
     {
 #ifdef MinFFS_PATCH
 		// MinFFS: MinGW does not have pathconf and _PC_NAME_MAX. So
@@ -64,6 +352,9 @@ private:
 		// anyway.
 		// https://msdn.microsoft.com/en-us/library/windows/desktop/aa365247(v=vs.85).aspx
 		const size_t nameMax = 10000;
+        buffer.resize(offsetof(struct ::dirent, d_name) + nameMax + 1);
+#elif defined ZEN_LINUX
+        buffer.resize(128 * 1024); //getdents64: read many directory entries per system call
 #else
         /* quote: "Since POSIX.1 does not specify the size of the d_name field, and other nonstandard fields may precede
                    that field within the dirent structure, portable applications that use readdir_r() should allocate
@@ -71,8 +362,8 @@ private:
                        len = offsetof(struct dirent, d_name) + pathconf(dirPath, _PC_NAME_MAX) + 1
                        entryp = malloc(len); */
         const size_t nameMax = std::max<long>(::pathconf(baseDirectory.c_str(), _PC_NAME_MAX), 10000); //::pathconf may return long(-1)
-#endif//MinFFS_PATCH
         buffer.resize(offsetof(struct ::dirent, d_name) + nameMax + 1);
+#endif//MinFFS_PATCH
 
         traverse(baseDirectory, sink);
     }
@@ -129,10 +420,16 @@ private:
 	    
 	    const Zstring& itempath = appendSeparator(dirPath) + shortName;
 	    
+	    std::int64_t lastWriteWinFileTime = (static_cast<std::int64_t>(fileAttr_.ftLastWriteTime.dwHighDateTime) << 32) + static_cast<std::int64_t>(fileAttr_.ftLastWriteTime.dwLowDateTime);
+	    // FILETIME structure contains a 64-bit value representing the number of 100-nanosecond intervals since January 1, 1601 (UTC).
+	    // https://msdn.microsoft.com/en-us/library/windows/desktop/ms724284(v=vs.85).aspx
+	    // convert to Linux epoch which is number of seconds since Jan. 1st 1970 UTC
+	    std::int64_t lastWriteTimeLinuxEpoc = (lastWriteWinFileTime / 10000000LL) - 11644473600LL;
+	    
 	    if (fileAttr_.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) //a directory
 	    {
 #ifdef MinFFS_PATCH
-		if (std::unique_ptr<AFS::TraverserCallback> trav = sink.onDir({ shortName.c_str() }))
+		if (std::unique_ptr<AFS::TraverserCallback> trav = sink.onDir({ shortName.c_str(), lastWriteTimeLinuxEpoc }))
 #else
 		if (std::unique_ptr<ABF::TraverserCallback> trav = sink.onDir({ shortName.c_str() }))
 #endif
@@ -152,11 +449,6 @@ private:
 		CloseHandle(fileHandle);
 		
 		std::uint64_t fileSize = (static_cast<std::uint64_t>(fileAttr_.nFileSizeHigh) << 32) + static_cast<std::uint64_t>(fileAttr_.nFileSizeLow);
-		std::int64_t lastWriteWinFileTime = (static_cast<std::int64_t>(fileAttr_.ftLastWriteTime.dwHighDateTime) << 32) + static_cast<std::int64_t>(fileAttr_.ftLastWriteTime.dwLowDateTime);
-		// FILETIME structure contains a 64-bit value representing the number of 100-nanosecond intervals since January 1, 1601 (UTC).
-		// https://msdn.microsoft.com/en-us/library/windows/desktop/ms724284(v=vs.85).aspx
-		// convert to Linux epoch which is number of seconds since Jan. 1st 1970 UTC
-		std::int64_t lastWriteTimeLinuxEpoc = (lastWriteWinFileTime / 10000000LL) - 11644473600LL;
 		
 #ifdef MinFFS_PATCH
 		AFS::TraverserCallback::FileInfo fi = {
@@ -180,6 +472,140 @@ private:
 	    */
 	}
 	return;
+#elif defined ZEN_LINUX
+        //no need to check for endless recursion: Linux has a fixed limit on the number of symbolic links in a path
+
+        const int dirFd = ::open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd == -1)
+            THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot open directory %x."), L"%x", fmtPath(dirPath)), L"open");
+        ZEN_ON_SCOPE_EXIT(::close(dirFd));
+
+        //read all entries before going into recursion => we use a single "buffer"!
+        std::vector<std::pair<Zstring, unsigned char>> items; //item name, d_type
+        for (;;)
+        {
+            const long bytesRead = ::syscall(SYS_getdents64, dirFd, &buffer[0], buffer.size());
+            if (bytesRead < 0)
+                THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot enumerate directory %x."), L"%x", fmtPath(dirPath)), L"getdents64");
+            //don't retry but restart dir traversal on error! http://blogs.msdn.com/b/oldnewthing/archive/2014/06/12/10533529.aspx
+
+            if (bytesRead == 0) //no more items
+                break;
+
+            for (long pos = 0; pos < bytesRead;)
+            {
+                const auto& dirEntry = *reinterpret_cast<const struct ::dirent64*>(&buffer[pos]); //same layout as the kernel's "linux_dirent64"
+                pos += dirEntry.d_reclen;
+
+                //don't return "." and ".."
+                const char* itemName = dirEntry.d_name;
+
+                if (itemName[0] == 0) throw FileError(replaceCpy(_("Cannot enumerate directory %x."), L"%x", fmtPath(dirPath)), L"getdents64: Data corruption; item is missing a name.");
+                if (itemName[0] == '.' &&
+                    (itemName[1] == 0 || (itemName[1] == '.' && itemName[2] == 0)))
+                    continue;
+
+                items.emplace_back(itemName, dirEntry.d_type);
+            }
+        }
+
+        //d_type is reliable on most file systems (else DT_UNKNOWN): directories and symlinks need no size and file id
+        auto needSizeAndId = [](unsigned char dType) { return dType != DT_DIR && dType != DT_LNK; };
+
+#ifdef ZEN_LINUX_IO_URING_STATX
+        //optional: get all item attributes in one batch; failed requests are retried synchronously below for a proper error message
+        std::vector<StatxRing::Request> prefetched;
+        if (!items.empty())
+            if (StatxRing* ring = getStatxRing(statQueueDepth_))
+            {
+                prefetched.resize(items.size());
+                for (size_t i = 0; i < items.size(); ++i)
+                {
+                    prefetched[i].itemName = items[i].first.c_str();
+                    prefetched[i].mask     = getStatxMask(needSizeAndId(items[i].second));
+                }
+                try
+                {
+                    ring->execute(dirFd, prefetched); //throw SysError
+                }
+                catch (SysError&) { prefetched.clear(); }
+            }
+#endif
+
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+            const Zstring& itemName = items[i].first;
+            auto getItemPath = [&] { return appendSeparator(dirPath) + itemName; }; //only needed for error messages and recursion
+
+            const bool withSizeAndId = needSizeAndId(items[i].second);
+
+            ItemAttributes attr;
+            bool havePrefetched = false;
+#ifdef ZEN_LINUX_IO_URING_STATX
+            if (i < prefetched.size() && prefetched[i].errorCode == 0)
+            {
+                attr = convertStatx(prefetched[i].statxData, withSizeAndId);
+                havePrefetched = true;
+            }
+#endif
+            if (!tryReportingItemError([&]
+        {
+            if ((!havePrefetched && !getItemAttributes(dirFd, itemName, false /*followSymlink*/, withSizeAndId, attr)) ||
+                (!withSizeAndId && !S_ISDIR(attr.mode) && !S_ISLNK(attr.mode) && //d_type is outdated: item was replaced in the meantime
+                 !getItemAttributes(dirFd, itemName, false /*followSymlink*/, true /*withSizeAndId*/, attr)))
+                    THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot read file attributes of %x."), L"%x", fmtPath(getItemPath())), L"statx");
+            }, sink, itemName))
+            continue; //ignore error: skip file
+
+            if (S_ISLNK(attr.mode)) //on Linux there is no distinction between file and directory symlinks!
+            {
+                const AFS::TraverserCallback::SymlinkInfo linkInfo = { itemName, attr.lastWriteTime };
+
+                switch (sink.onSymlink(linkInfo))
+                {
+                    case AFS::TraverserCallback::LINK_FOLLOW:
+                    {
+                        //try to resolve symlink (and report error on failure!!!)
+                        ItemAttributes attrTrg;
+
+                        bool validLink = tryReportingItemError([&]
+                        {
+                            if (!getItemAttributes(dirFd, itemName, true /*followSymlink*/, true /*withSizeAndId*/, attrTrg))
+                                THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot resolve symbolic link %x."), L"%x", fmtPath(getItemPath())), L"statx");
+                        }, sink, itemName);
+
+                        if (validLink)
+                        {
+                            if (S_ISDIR(attrTrg.mode)) //a directory
+                            {
+                                if (std::unique_ptr<AFS::TraverserCallback> trav = sink.onDir({ itemName, attrTrg.lastWriteTime }))
+                                    traverse(getItemPath(), *trav);
+                            }
+                            else //a file or named pipe, ect.
+                            {
+                                AFS::TraverserCallback::FileInfo fi = { itemName, attrTrg.fileSize, attrTrg.lastWriteTime, convertToAbstractFileId(attrTrg.fileId), &linkInfo };
+                                sink.onFile(fi);
+                            }
+                        }
+                        // else //broken symlink -> ignore: it's client's responsibility to handle error!
+                    }
+                    break;
+
+                    case AFS::TraverserCallback::LINK_SKIP:
+                        break;
+                }
+            }
+            else if (S_ISDIR(attr.mode)) //a directory
+            {
+                if (std::unique_ptr<AFS::TraverserCallback> trav = sink.onDir({ itemName, attr.lastWriteTime }))
+                    traverse(getItemPath(), *trav);
+            }
+            else //a file or named pipe, ect.
+            {
+                AFS::TraverserCallback::FileInfo fi = { itemName, attr.fileSize, attr.lastWriteTime, convertToAbstractFileId(attr.fileId), nullptr /*symlinkInfo*/ };
+                sink.onFile(fi);
+            }
+        }
 #else
         //no need to check for endless recursion: Linux has a fixed limit on the number of symbolic links in a path
 
@@ -237,7 +663,7 @@ private:
                         {
                             if (S_ISDIR(statDataTrg.st_mode)) //a directory
                             {
-                                if (std::unique_ptr<AFS::TraverserCallback> trav = sink.onDir({ itemName }))
+                                if (std::unique_ptr<AFS::TraverserCallback> trav = sink.onDir({ itemName, statDataTrg.st_mtime }))
                                     traverse(itemPath, *trav);
                             }
                             else //a file or named pipe, ect.
@@ -256,7 +682,7 @@ private:
             }
             else if (S_ISDIR(statData.st_mode)) //a directory
             {
-                if (std::unique_ptr<AFS::TraverserCallback> trav = sink.onDir({ itemName }))
+                if (std::unique_ptr<AFS::TraverserCallback> trav = sink.onDir({ itemName, statData.st_mtime }))
                     traverse(itemPath, *trav);
             }
             else //a file or named pipe, ect.
@@ -276,5 +702,6 @@ private:
     }
 
     std::vector<char> buffer;
+    const size_t statQueueDepth_; //Linux: > 0: prefetch item attributes via io_uring
 };
 }
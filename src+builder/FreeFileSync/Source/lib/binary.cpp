@@ -7,7 +7,14 @@
 #include "binary.h"
 #include <zen/tick_count.h>
 #include <vector>
+#include <deque>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <cstdint>
 #include <zen/file_io.h>
+#include <zen/thread.h>
+#include <zen/xxhash64.h>
 
 using namespace zen;
 using AFS = AbstractFileSystem;
@@ -54,25 +61,222 @@ public:
 
 private:
     static const size_t BUFFER_SIZE_MIN   =            8 * 1024; //slow FTP transfer!
-    static const size_t BUFFER_SIZE_MAX   =  1024 * 1024 * 1024;
+    static const size_t BUFFER_SIZE_MAX   =   16 * 1024 * 1024; //bounds memory regardless of timing: up to 6 blocks are in use per comparison (see ReadAheadStream)
+    //=> throughput does not improve beyond a few MB per read, a shorter callback interval is harmless
 
     size_t bufSize;
 };
 
 
+//page-aligned: memcmp() and the read ahead buffers of the OS work on whole pages
+class AlignedBuffer
+{
+public:
+    AlignedBuffer() {}
+    explicit AlignedBuffer(size_t size) : //throw std::bad_alloc
+        rawMem(new char[size + ALIGNMENT - 1]),
+        data_(rawMem.get() + (ALIGNMENT - reinterpret_cast<std::uintptr_t>(rawMem.get()) % ALIGNMENT) % ALIGNMENT),
+        size_(size) {}
+
+    //moved-from buffers must be empty: they are released to the pool, too!
+    AlignedBuffer(AlignedBuffer&& tmp) : rawMem(std::move(tmp.rawMem)), data_(tmp.data_), size_(tmp.size_) { tmp.data_ = nullptr; tmp.size_ = 0; }
+    AlignedBuffer& operator=(AlignedBuffer&& tmp) { AlignedBuffer(std::move(tmp)).swap(*this); return *this; }
+
+    char*  data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void swap(AlignedBuffer& other)
+    {
+        std::swap(rawMem, other.rawMem);
+        std::swap(data_,  other.data_);
+        std::swap(size_,  other.size_);
+    }
+
+    static const size_t ALIGNMENT = 4096;
+
+    std::unique_ptr<char[]> rawMem;
+    char* data_  = nullptr;
+    size_t size_ = 0;
+};
+
+
+//buffers are recycled across calls and threads: comparing many small files would otherwise spend more time allocating than comparing
+class BufferPool
+{
+public:
+    AlignedBuffer acquire(size_t minSize) //throw std::bad_alloc
+    {
+        {
+            std::lock_guard<std::mutex> dummy(lockBuffers);
+            for (auto it = idleBuffers.begin(); it != idleBuffers.end(); ++it)
+                if (it->size() >= minSize)
+                {
+                    AlignedBuffer buf = std::move(*it);
+                    idleBuffers.erase(it);
+                    bytesIdle -= buf.size();
+                    return buf;
+                }
+        }
+        return AlignedBuffer(minSize); //throw std::bad_alloc
+    }
+
+    void release(AlignedBuffer&& bufIn)
+    {
+        AlignedBuffer buf(std::move(bufIn)); //caller's buffer is empty afterwards in any case
+        std::lock_guard<std::mutex> dummy(lockBuffers);
+        if (buf.size() != 0 && bytesIdle + buf.size() <= MAX_IDLE_BYTES) //otherwise free memory right away
+        {
+            bytesIdle += buf.size();
+            idleBuffers.push_back(std::move(buf));
+        }
+    }
+
+private:
+    static const size_t MAX_IDLE_BYTES = 64 * 1024 * 1024;
+
+    std::mutex lockBuffers;
+    std::vector<AlignedBuffer> idleBuffers;
+    size_t bytesIdle = 0;
+};
+
+BufferPool globalBufferPool;
+
+
+//make sure "buffer" holds at least "minSize" bytes; old content is discarded
 inline
-void setMinSize(std::vector<char>& buffer, size_t minSize)
+void setMinSize(AlignedBuffer& buffer, size_t minSize) //throw std::bad_alloc
 {
-    if (buffer.size() < minSize) //this is similar to reserve(), but we need a "properly initialized" array here
-        buffer.resize(minSize);
+    if (buffer.size() < minSize)
+    {
+        globalBufferPool.release(std::move(buffer));
+        buffer = globalBufferPool.acquire(minSize); //throw std::bad_alloc
+    }
 }
 
 
 const std::int64_t TICKS_PER_SEC = ticksPerSec();
+
+
+//double-buffered read-ahead: the next block is read by a worker thread while the caller is still comparing the current one
+class ReadAheadStream
+{
+public:
+    ReadAheadStream(AFS::InputStream& stream) : stream_(stream), worker([this] { readBlocks(); }) {}
+
+    ~ReadAheadStream()
+    {
+        worker.interrupt();
+        worker.join(); //a pending read() is not interruptible, but completes eventually
+
+        for (Block& block : blocks)
+            globalBufferPool.release(std::move(block.data));
+        for (AlignedBuffer& buf : spareBuffers)
+            globalBufferPool.release(std::move(buf));
+    }
+
+    //context of caller:
+    void requestBlock(size_t blockSize)
+    {
+        {
+            std::lock_guard<std::mutex> dummy(lockBlocks);
+            requests.push_back(blockSize);
+        }
+        conditionBlocksChanged.notify_all();
+    }
+
+    //context of caller: returns number of bytes read for the oldest request; less than requested at end of stream
+    size_t getBlock(AlignedBuffer& buffer) //throw FileError
+    {
+        std::unique_lock<std::mutex> dummy(lockBlocks);
+        //no interruptibleWait(): caller is not necessarily an InterruptibleThread
+        conditionBlocksChanged.wait(dummy, [this] { return !blocks.empty() || readError; });
+
+        if (blocks.empty())
+            throw *readError;
+
+        Block block = std::move(blocks.front());
+        blocks.pop_front();
+
+        std::swap(buffer, block.data);
+        spareBuffers.push_back(std::move(block.data)); //recycle caller's old buffer
+        return block.length;
+    }
+
+private:
+    ReadAheadStream           (const ReadAheadStream&) = delete;
+    ReadAheadStream& operator=(const ReadAheadStream&) = delete;
+
+    struct Block
+    {
+        AlignedBuffer data;
+        size_t length = 0;
+    };
+
+    void readBlocks() //throw ThreadInterruption
+    {
+        for (;;)
+        {
+            Block block;
+            size_t blockSize = 0;
+            {
+                std::unique_lock<std::mutex> dummy(lockBlocks);
+                interruptibleWait(conditionBlocksChanged, dummy, [this] { return !requests.empty(); }); //throw ThreadInterruption
+
+                blockSize = requests.front();
+                requests.pop_front();
+
+                if (!spareBuffers.empty())
+                {
+                    block.data = std::move(spareBuffers.back());
+                    spareBuffers.pop_back();
+                }
+            }
+
+            try
+            {
+                try
+                {
+                    setMinSize(block.data, std::max<size_t>(blockSize, 1)); //throw std::bad_alloc
+                }
+                catch (const std::bad_alloc& e) { throw FileError(_("Out of memory."), utfCvrtTo<std::wstring>(e.what())); } //don't let exceptions escape the thread
+
+                block.length = stream_.read(block.data.data(), blockSize); //throw FileError
+            }
+            catch (const FileError& e)
+            {
+                {
+                    std::lock_guard<std::mutex> dummy(lockBlocks);
+                    readError = e;
+                    spareBuffers.push_back(std::move(block.data));
+                }
+                conditionBlocksChanged.notify_all();
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> dummy(lockBlocks);
+                blocks.push_back(std::move(block));
+            }
+            conditionBlocksChanged.notify_all();
+        }
+    }
+
+    AFS::InputStream& stream_;
+
+    std::mutex lockBlocks;
+    std::condition_variable conditionBlocksChanged;
+    std::deque<size_t> requests;
+    std::deque<Block> blocks;
+    std::vector<AlignedBuffer> spareBuffers;
+    Opt<FileError> readError;
+
+    InterruptibleThread worker; //construct last: accesses all members above!
+};
 }
 
 
-bool zen::filesHaveSameContent(const AbstractPath& filePath1, const AbstractPath& filePath2, const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus) //throw FileError
+bool zen::filesHaveSameContent(const AbstractPath& filePath1, const AbstractPath& filePath2, const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus, std::uint64_t* contentHash) //throw FileError
 {
     const std::unique_ptr<AFS::InputStream> inStream1 = AFS::getInputStream(filePath1); //throw FileError, (ErrorFileLocked)
     const std::unique_ptr<AFS::InputStream> inStream2 = AFS::getInputStream(filePath2); //
@@ -81,26 +285,63 @@ bool zen::filesHaveSameContent(const AbstractPath& filePath1, const AbstractPath
                                        inStream2->optimalBlockSize()));
 
     TickVal lastDelayViolation = getTicks();
-    std::vector<char> buf; //make this thread-local? => on noticeable perf advantage!
+    AlignedBuffer buf1;
+    AlignedBuffer buf2;
+    ZEN_ON_SCOPE_EXIT(globalBufferPool.release(std::move(buf1));
+                      globalBufferPool.release(std::move(buf2)));
+
+    //most files fit into the first block: read synchronously, starting read-ahead threads would cost more than it saves
+    std::unique_ptr<ReadAheadStream> readAhead1;
+    std::unique_ptr<ReadAheadStream> readAhead2;
+    size_t requestedBufSize = 0; //read-ahead: size of the block requested last
+
+    XxHash64 hash;
 
     for (;;)
     {
-        const size_t bufSize = dynamicBufSize.get(); //save for reliable eof check below!!!
-        setMinSize(buf, 2 * bufSize);
-        char* buf1 = &buf[0];
-        char* buf2 = &buf[bufSize];
+        size_t bufSize = dynamicBufSize.get(); //save for reliable eof check below!!!
 
         const TickVal startTime = getTicks();
 
-        const size_t length1 = inStream1->read(buf1, bufSize); //throw FileError
-        const size_t length2 = inStream2->read(buf2, bufSize); //returns actual number of bytes read
+        size_t length1 = 0;
+        size_t length2 = 0;
+        if (!readAhead1)
+        {
+            setMinSize(buf1, bufSize); //throw std::bad_alloc
+            setMinSize(buf2, bufSize); //
+
+            length1 = inStream1->read(buf1.data(), bufSize); //throw FileError
+            length2 = inStream2->read(buf2.data(), bufSize); //returns actual number of bytes read
+
+            if (length1 == bufSize && length2 == bufSize) //=> read both streams concurrently from now on
+            {
+                readAhead1 = std::make_unique<ReadAheadStream>(*inStream1);
+                readAhead2 = std::make_unique<ReadAheadStream>(*inStream2);
+                readAhead1->requestBlock(bufSize);
+                readAhead2->requestBlock(bufSize);
+                requestedBufSize = bufSize;
+            }
+        }
+        else
+        {
+            //request next block *before* waiting for the current one => double buffering
+            readAhead1->requestBlock(bufSize);
+            readAhead2->requestBlock(bufSize);
+            std::swap(bufSize, requestedBufSize); //current block was requested during the previous iteration
+
+            length1 = readAhead1->getBlock(buf1); //throw FileError
+            length2 = readAhead2->getBlock(buf2); //
+        }
         //send progress updates immediately after reading to reliably allow speed calculations for our clients!
         if (onUpdateStatus)
             onUpdateStatus(std::max(length1, length2));
 
-        if (length1 != length2 || ::memcmp(buf1, buf2, length1) != 0)
+        if (length1 != length2 || ::memcmp(buf1.data(), buf2.data(), length1) != 0)
             return false;
 
+        if (contentHash)
+            hash.update(buf1.data(), length1);
+
         //-------- dynamically set buffer size to keep callback interval between 100 - 500ms ---------------------
         if (TICKS_PER_SEC > 0)
         {
@@ -124,6 +365,83 @@ bool zen::filesHaveSameContent(const AbstractPath& filePath1, const AbstractPath
         //------------------------------------------------------------------------------------------------
 
         if (length1 != bufSize) //end of file
+        {
+            if (contentHash)
+                *contentHash = hash.digest();
             return true;
+        }
+    }
+}
+
+
+bool zen::fileSamplesMatch(const AbstractPath& filePath1, const AbstractPath& filePath2, std::uint64_t fileSizeCmp, const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus) //throw FileError
+{
+    const size_t SAMPLE_SIZE    = 64 * 1024;
+    const size_t STRIPE_COUNT   = 4; //samples between head and tail
+    const std::uint64_t FILE_SIZE_MIN = 16 * SAMPLE_SIZE; //smaller files: reading them completely costs hardly more
+
+    if (fileSizeCmp < FILE_SIZE_MIN)
+        return true;
+
+    const std::unique_ptr<AFS::InputStream> inStream1 = AFS::getInputStream(filePath1); //throw FileError, (ErrorFileLocked)
+    const std::unique_ptr<AFS::InputStream> inStream2 = AFS::getInputStream(filePath2); //
+
+    const std::uint64_t fileSize = inStream1->getFileSize(); //throw FileError
+    if (inStream2->getFileSize() != fileSize) //throw FileError; changed since comparison
+        return false;
+
+    if (fileSize < FILE_SIZE_MIN) //shrunk since comparison
+        return true;
+
+    //stripe positions depend on the file size only: a comparison can be reproduced
+    std::vector<std::uint64_t> offsets;
+    std::minstd_rand rng(static_cast<std::minstd_rand::result_type>(fileSize));
+    std::uniform_int_distribution<std::uint64_t> distrib(SAMPLE_SIZE, fileSize - 2 * SAMPLE_SIZE);
+    for (size_t i = 0; i < STRIPE_COUNT; ++i)
+        offsets.push_back(distrib(rng));
+    std::sort(offsets.begin(), offsets.end());
+
+    //head and tail first: headers and trailing metadata (e.g. tags of media files) are the parts most likely to differ
+    offsets.insert(offsets.begin(), { 0, fileSize - SAMPLE_SIZE });
+
+    AlignedBuffer buf1 = globalBufferPool.acquire(SAMPLE_SIZE); //throw std::bad_alloc
+    AlignedBuffer buf2 = globalBufferPool.acquire(SAMPLE_SIZE); //
+    ZEN_ON_SCOPE_EXIT(globalBufferPool.release(std::move(buf1));
+                      globalBufferPool.release(std::move(buf2)));
+
+    for (const std::uint64_t offset : offsets)
+    {
+        inStream1->setPosition(offset); //throw FileError
+        inStream2->setPosition(offset); //
+
+        const size_t length1 = inStream1->read(buf1.data(), SAMPLE_SIZE); //throw FileError
+        const size_t length2 = inStream2->read(buf2.data(), SAMPLE_SIZE); //
+
+        if (onUpdateStatus)
+            onUpdateStatus(std::max(length1, length2));
+
+        if (length1 != length2 || ::memcmp(buf1.data(), buf2.data(), length1) != 0)
+            return false;
+    }
+    return true;
+}
+
+
+std::uint64_t zen::getFileContentHash(const AbstractPath& filePath, const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus) //throw FileError
+{
+    auto streamIn = AFS::getInputStream(filePath); //throw FileError, ErrorFileLocked
+
+    XxHash64 hash;
+    std::vector<char> buffer(streamIn->optimalBlockSize());
+    for (;;)
+    {
+        const size_t bytesRead = streamIn->read(&buffer[0], buffer.size()); //throw FileError
+        hash.update(&buffer[0], bytesRead);
+
+        if (onUpdateStatus)
+            onUpdateStatus(bytesRead); //throw X!
+
+        if (bytesRead != buffer.size()) //end of file
+            return hash.digest();
     }
 }
@@ -16,7 +16,18 @@ namespace zen
 {
 bool filesHaveSameContent(const AbstractPath& filePath1, //throw FileError
                           const AbstractPath& filePath2,
-                          const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus); //may be nullptr
+                          const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus, //may be nullptr
+                          std::uint64_t* contentHash = nullptr); //optional: receives XxHash64 of the content if both files are equal
+
+//cheap pre-check for "compare by content": compare the first and last 64 kB and a few stripes in between
+//=> most files with different content are rejected without being read completely; "true" does NOT imply equal content!
+bool fileSamplesMatch(const AbstractPath& filePath1, //throw FileError
+                      const AbstractPath& filePath2,
+                      std::uint64_t fileSize, //as found by comparison: small files are not sampled and not even opened
+                      const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus); //may be nullptr
+
+std::uint64_t getFileContentHash(const AbstractPath& filePath, //throw FileError
+                                 const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus); //may be nullptr
 }
 
 #endif //BINARY_H_3941281398513241134
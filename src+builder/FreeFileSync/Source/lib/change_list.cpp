@@ -0,0 +1,89 @@
+// **************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under *
+// * GNU General Public License: http://www.gnu.org/licenses/gpl-3.0        *
+// * Copyright (C) Zenju (zenju AT gmx DOT de) - All Rights Reserved        *
+// **************************************************************************
+
+#include "change_list.h"
+#include <zen/serialize.h>
+
+using namespace zen;
+
+
+namespace
+{
+//-------------------------------------------------------------------------------------------------------------------------------
+const char FILE_FORMAT_DESCR[] = "FreeFileSync Change List";
+const int CHANGE_LIST_FORMAT_VER = 1;
+//-------------------------------------------------------------------------------------------------------------------------------
+
+using MemStreamOut = MemoryStreamOut<ByteArray>;
+using MemStreamIn  = MemoryStreamIn <ByteArray>;
+
+//-----------------------------------------------------------------------------------
+//| ensure 32/64 bit portability: use fixed size data types only e.g. std::uint32_t |
+//-----------------------------------------------------------------------------------
+
+void writePathList(MemStreamOut& output, const std::vector<Zstring>& paths)
+{
+    writeNumber<std::uint32_t>(output, static_cast<std::uint32_t>(paths.size()));
+    for (const Zstring& path : paths)
+        writeContainer(output, utfCvrtTo<Zbase<char>>(path));
+}
+
+
+std::vector<Zstring> readPathList(MemStreamIn& input) //throw UnexpectedEndOfStreamError
+{
+    std::vector<Zstring> paths;
+    size_t pathCount = readNumber<std::uint32_t>(input);
+    while (pathCount-- != 0)
+        paths.push_back(utfCvrtTo<Zstring>(readContainer<Zbase<char>>(input)));
+    return paths;
+}
+}
+
+
+void zen::saveChangeList(const ChangeList& changes, const Zstring& filePath) //throw FileError
+{
+    MemStreamOut out;
+
+    //write FreeFileSync file identifier
+    writeArray(out, FILE_FORMAT_DESCR, sizeof(FILE_FORMAT_DESCR));
+
+    //save file format version
+    writeNumber<std::int32_t>(out, CHANGE_LIST_FORMAT_VER);
+
+    writeNumber<std::int64_t>(out, changes.monitoringStartTime);
+    writePathList(out, changes.watchedFolderPaths);
+    writePathList(out, changes.changedItemPaths);
+
+    saveBinStream(filePath, out.ref(), nullptr); //throw FileError
+}
+
+
+ChangeList zen::loadChangeList(const Zstring& filePath) //throw FileError
+{
+    MemStreamIn in = loadBinStream<ByteArray>(filePath, nullptr); //throw FileError
+    try
+    {
+        //read FreeFileSync file identifier
+        char formatDescr[sizeof(FILE_FORMAT_DESCR)] = {};
+        readArray(in, formatDescr, sizeof(formatDescr)); //throw UnexpectedEndOfStreamError
+
+        if (!std::equal(FILE_FORMAT_DESCR, FILE_FORMAT_DESCR + sizeof(FILE_FORMAT_DESCR), formatDescr))
+            throw FileError(replaceCpy(_("Cannot read file %x."), L"%x", fmtPath(filePath)), L"unknown file format");
+
+        if (readNumber<std::int32_t>(in) != CHANGE_LIST_FORMAT_VER) //throw UnexpectedEndOfStreamError
+            throw FileError(replaceCpy(_("Cannot read file %x."), L"%x", fmtPath(filePath)), L"unknown file format version");
+
+        ChangeList changes;
+        changes.monitoringStartTime = readNumber<std::int64_t>(in);
+        changes.watchedFolderPaths  = readPathList(in);
+        changes.changedItemPaths    = readPathList(in);
+        return changes;
+    }
+    catch (UnexpectedEndOfStreamError&)
+    {
+        throw FileError(replaceCpy(_("Cannot read file %x."), L"%x", fmtPath(filePath)), L"unexpected end of stream");
+    }
+}
@@ -0,0 +1,34 @@
+// **************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under *
+// * GNU General Public License: http://www.gnu.org/licenses/gpl-3.0        *
+// * Copyright (C) Zenju (zenju AT gmx DOT de) - All Rights Reserved        *
+// **************************************************************************
+
+#ifndef CHANGE_LIST_H_4237508932475092834
+#define CHANGE_LIST_H_4237508932475092834
+
+#include <vector>
+#include <cstdint>
+#include <zen/file_error.h>
+
+
+namespace zen
+{
+/*
+Change list: items reported as changed by RealtimeSync's folder monitoring
+    - written by RealtimeSync before executing the command line, read by FreeFileSync batch mode: "-ChangeList <file path>"
+    - complete for the watched folders since "monitoringStartTime": the folder watches were active and did not lose changes
+    - a scan index (see scan_index.h) of a traversal started later than "monitoringStartTime" only needs to read folders containing changed items
+*/
+struct ChangeList
+{
+    std::int64_t monitoringStartTime = 0; //unit: [s] since epoch
+    std::vector<Zstring> watchedFolderPaths; //native paths
+    std::vector<Zstring> changedItemPaths;   //native paths: created, modified or deleted files, symlinks and folders
+};
+
+void saveChangeList(const ChangeList& changes, const Zstring& filePath); //throw FileError
+ChangeList loadChangeList(const Zstring& filePath); //throw FileError
+}
+
+#endif //CHANGE_LIST_H_4237508932475092834
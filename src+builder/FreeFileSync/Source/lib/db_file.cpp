@@ -6,6 +6,7 @@
 
 #include "db_file.h"
 #include <zen/guid.h>
+#include <zen/thread.h>
 #include <wx+/zlib_wrap.h>
 
 #ifdef ZEN_WIN
@@ -21,12 +22,25 @@ namespace
 //-------------------------------------------------------------------------------------------------------------------------------
 const char FILE_FORMAT_DESCR[] = "FreeFileSync";
 const int DB_FORMAT_CONTAINER = 9;
-const int DB_FORMAT_STREAM    = 2; //since 2015-05-02
+const int DB_FORMAT_STREAM    = 3; //since the release after v7.6 (see version/version.h): folder records with offset index => decode lazily;
+//                                     zlib chunks => (de-)compress in parallel; optional content hash per file. Version 2: since 2015-05-02
+
+const char JOURNAL_FORMAT_DESCR[] = "FreeFileSync Journal";
+const int DB_FORMAT_JOURNAL = 1;
 //-------------------------------------------------------------------------------------------------------------------------------
 
 typedef std::string UniqueId;
 typedef std::map<UniqueId, ByteArray> DbStreams; //list of streams ordered by session UUID
 
+struct JournalEntry
+{
+    JournalEntry(const std::string& deltaIdIn, const ByteArray& deltaIn) : deltaId(deltaIdIn), delta(deltaIn) {}
+
+    std::string deltaId;
+    ByteArray delta; //compressed list of changed folders: see generateDelta()
+};
+typedef std::map<UniqueId, std::vector<JournalEntry>> DbJournal; //deltas to apply to the session's stream, oldest first
+
 using MemStreamOut = MemoryStreamOut<ByteArray>;
 using MemStreamIn  = MemoryStreamIn <ByteArray>;
 
@@ -35,7 +49,7 @@ using MemStreamIn  = MemoryStreamIn <ByteArray>;
 //-----------------------------------------------------------------------------------
 
 template <SelectedSide side> inline
-AbstractPath getDatabaseFilePath(const BaseFolderPair& baseFolder, bool tempfile = false)
+AbstractPath getDatabaseFilePath(const BaseFolderPair& baseFolder, bool tempfile = false, bool journal = false)
 {
     //Linux and Windows builds are binary incompatible: different file id?, problem with case sensitivity? are UTC file times really compatible?
     //what about endianess!?
@@ -47,13 +61,48 @@ AbstractPath getDatabaseFilePath(const BaseFolderPair& baseFolder, bool tempfile
 #elif defined ZEN_LINUX || defined ZEN_MAC
     const Zstring dbName = Zstr(".sync"); //files beginning with dots are hidden e.g. in Nautilus
 #endif
-    const Zstring dbFileName = dbName + (tempfile ? Zstr(".tmp") : Zstr("")) + SYNC_DB_FILE_ENDING;
+    const Zstring dbFileName = dbName + (journal ? Zstr(".journal") : Zstr("")) + (tempfile ? Zstr(".tmp") : Zstr("")) + SYNC_DB_FILE_ENDING;
 
     return AFS::appendRelPath(baseFolder.getAbstractPath<side>(), dbFileName);
 }
 
 //#######################################################################################################################################
 
+void saveDbFile(const ByteArray& fileContent, const AbstractPath& dbPath, const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus) //throw FileError
+{
+    assert(!AFS::somethingExists(dbPath)); //orphan tmp files should have been cleaned up at this point!
+
+    //save memory stream to file (as a transaction!)
+    {
+        MemoryStreamIn<ByteArray> memStreamIn(fileContent);
+        const std::uint64_t streamSize = fileContent.size();
+        const std::unique_ptr<AFS::OutputStream> fileStreamOut = AFS::getOutputStream(dbPath, &streamSize, nullptr /*modificationTime*/); //throw FileError, ErrorTargetExisting
+        if (onUpdateStatus) onUpdateStatus(0);
+        copyStream(memStreamIn, *fileStreamOut, fileStreamOut->optimalBlockSize(), onUpdateStatus); //throw FileError
+        fileStreamOut->finalize([&] { if (onUpdateStatus) onUpdateStatus(0); }); //throw FileError
+        //commit and close stream
+    }
+
+#ifdef ZEN_WIN
+    if (Opt<Zstring> nativeFilePath = AFS::getNativeItemPath(dbPath))
+        ::SetFileAttributes(applyLongPathPrefix(*nativeFilePath).c_str(), FILE_ATTRIBUTE_HIDDEN); //(try to) hide database file
+#endif
+}
+
+
+ByteArray loadDbFile(const AbstractPath& dbPath, const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus) //throw FileError
+{
+    //load memory stream from file
+    MemoryStreamOut<ByteArray> memStreamOut;
+    {
+        const std::unique_ptr<AFS::InputStream> fileStreamIn = AFS::getInputStream(dbPath); //throw FileError, ErrorFileLocked
+        if (onUpdateStatus) onUpdateStatus(0);
+        copyStream(*fileStreamIn, memStreamOut, fileStreamIn->optimalBlockSize(), onUpdateStatus); //throw FileError
+    } //close file handle
+    return memStreamOut.ref();
+}
+
+
 void saveStreams(const DbStreams& streamList, const AbstractPath& dbPath, const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus) //throw FileError
 {
     //perf? instead of writing to a file stream directly, collect data into memory first, then write to file block-wise
@@ -74,23 +123,7 @@ void saveStreams(const DbStreams& streamList, const AbstractPath& dbPath, const
         writeContainer<ByteArray>  (memStreamOut, stream.second);
     }
 
-    assert(!AFS::somethingExists(dbPath)); //orphan tmp files should have been cleaned up at this point!
-
-    //save memory stream to file (as a transaction!)
-    {
-        MemoryStreamIn<ByteArray> memStreamIn(memStreamOut.ref());
-        const std::uint64_t streamSize = memStreamOut.ref().size();
-        const std::unique_ptr<AFS::OutputStream> fileStreamOut = AFS::getOutputStream(dbPath, &streamSize, nullptr /*modificationTime*/); //throw FileError, ErrorTargetExisting
-        if (onUpdateStatus) onUpdateStatus(0);
-        copyStream(memStreamIn, *fileStreamOut, fileStreamOut->optimalBlockSize(), onUpdateStatus); //throw FileError
-        fileStreamOut->finalize([&] { if (onUpdateStatus) onUpdateStatus(0); }); //throw FileError
-        //commit and close stream
-    }
-
-#ifdef ZEN_WIN
-    if (Opt<Zstring> nativeFilePath = AFS::getNativeItemPath(dbPath))
-        ::SetFileAttributes(applyLongPathPrefix(*nativeFilePath).c_str(), FILE_ATTRIBUTE_HIDDEN); //(try to) hide database file
-#endif
+    saveDbFile(memStreamOut.ref(), dbPath, onUpdateStatus); //throw FileError
 }
 
 
@@ -98,15 +131,7 @@ DbStreams loadStreams(const AbstractPath& dbPath, const std::function<void(std::
 {
     try
     {
-        //load memory stream from file
-        MemoryStreamOut<ByteArray> memStreamOut;
-        {
-            const std::unique_ptr<AFS::InputStream> fileStreamIn = AFS::getInputStream(dbPath); //throw FileError, ErrorFileLocked
-            if (onUpdateStatus) onUpdateStatus(0);
-            copyStream(*fileStreamIn, memStreamOut, fileStreamIn->optimalBlockSize(), onUpdateStatus); //throw FileError
-        } //close file handle
-
-        MemStreamIn streamIn(memStreamOut.ref());
+        MemStreamIn streamIn(loadDbFile(dbPath, onUpdateStatus)); //throw FileError
 
         //read FreeFileSync file identifier
         char formatDescr[sizeof(FILE_FORMAT_DESCR)] = {};
@@ -151,8 +176,133 @@ DbStreams loadStreams(const AbstractPath& dbPath, const std::function<void(std::
     }
 }
 
+//---------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+journal of the database streams: small syncs only record the folders they changed instead of rewriting the complete database
+    - written to both sides as a transaction of its own: a delta is only valid if both journals contain it
+    - compaction: once the journal grows too big, it is merged into a new database stream
+*/
+void saveJournal(const DbJournal& journal, const AbstractPath& journalPath, const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus) //throw FileError
+{
+    MemStreamOut memStreamOut;
+
+    writeArray(memStreamOut, JOURNAL_FORMAT_DESCR, sizeof(JOURNAL_FORMAT_DESCR));
+    writeNumber<std::int32_t>(memStreamOut, DB_FORMAT_JOURNAL);
+
+    writeNumber<std::uint32_t>(memStreamOut, static_cast<std::uint32_t>(journal.size())); //one list of deltas for each session
+    for (const auto& item : journal)
+    {
+        writeContainer<std::string>(memStreamOut, item.first);
+
+        writeNumber<std::uint32_t>(memStreamOut, static_cast<std::uint32_t>(item.second.size()));
+        for (const JournalEntry& entry : item.second)
+        {
+            writeContainer<std::string>(memStreamOut, entry.deltaId);
+            writeContainer<ByteArray>  (memStreamOut, entry.delta);
+        }
+    }
+
+    saveDbFile(memStreamOut.ref(), journalPath, onUpdateStatus); //throw FileError
+}
+
+
+DbJournal loadJournal(const AbstractPath& journalPath, const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus) //throw FileError
+{
+    try
+    {
+        MemStreamIn streamIn(loadDbFile(journalPath, onUpdateStatus)); //throw FileError
+
+        char formatDescr[sizeof(JOURNAL_FORMAT_DESCR)] = {};
+        readArray(streamIn, formatDescr, sizeof(formatDescr)); //throw UnexpectedEndOfStreamError
+
+        if (!std::equal(JOURNAL_FORMAT_DESCR, JOURNAL_FORMAT_DESCR + sizeof(JOURNAL_FORMAT_DESCR), formatDescr) ||
+            readNumber<std::int32_t>(streamIn) != DB_FORMAT_JOURNAL) //throw UnexpectedEndOfStreamError
+            throw FileError(replaceCpy(_("Database file %x is incompatible."), L"%x", fmtPath(AFS::getDisplayPath(journalPath))));
+
+        DbJournal output;
+
+        size_t sessionCount = readNumber<std::uint32_t>(streamIn);
+        while (sessionCount-- != 0)
+        {
+            std::vector<JournalEntry>& entries = output[readContainer<std::string>(streamIn)];
+
+            size_t deltaCount = readNumber<std::uint32_t>(streamIn);
+            while (deltaCount-- != 0)
+            {
+                const std::string deltaId = readContainer<std::string>(streamIn);
+                entries.emplace_back(deltaId, readContainer<ByteArray>(streamIn));
+            }
+        }
+        return output;
+    }
+    catch (FileError&)
+    {
+        if (!AFS::somethingExists(journalPath)) //no journal: database stream is complete
+            return DbJournal();
+        throw;
+    }
+    catch (UnexpectedEndOfStreamError&)
+    {
+        throw FileError(_("Database file is corrupt:") + L"\n" + fmtPath(AFS::getDisplayPath(journalPath)));
+    }
+    catch (const std::bad_alloc& e)
+    {
+        throw FileError(_("Database file is corrupt:") + L"\n" + fmtPath(AFS::getDisplayPath(journalPath)),
+                        _("Out of memory.") + L" " + utfCvrtTo<std::wstring>(e.what()));
+    }
+}
+
+
+//an interrupted save may have updated one side's journal only => use deltas written to both sides
+std::vector<JournalEntry> getCommittedDeltas(const DbJournal& journalL, const DbJournal& journalR, const UniqueId& sessionID)
+{
+    std::vector<JournalEntry> output;
+
+    auto itL = journalL.find(sessionID);
+    auto itR = journalR.find(sessionID);
+    if (itL != journalL.end() &&
+        itR != journalR.end())
+        for (size_t i = 0; i < itL->second.size() && i < itR->second.size(); ++i)
+        {
+            if (itL->second[i].deltaId != itR->second[i].deltaId)
+                break;
+            output.push_back(itL->second[i]);
+        }
+    return output;
+}
+
+
+std::uint64_t getJournalSize(const std::vector<JournalEntry>& entries)
+{
+    std::uint64_t bytes = 0;
+    for (const JournalEntry& entry : entries)
+        bytes += entry.delta.size();
+    return bytes;
+}
+
 //#######################################################################################################################################
 
+void writeUtf8(MemStreamOut& output, const Zstring& str) { writeContainer(output, utfCvrtTo<Zbase<char>>(str)); }
+
+Zstring readUtf8(MemStreamIn& input) { return utfCvrtTo<Zstring>(readContainer<Zbase<char>>(input)); } //throw UnexpectedEndOfStreamError
+
+
+void writeContentHash(MemStreamOut& output, const Opt<std::uint64_t>& contentHash)
+{
+    writeNumber<std::int8_t>(output, contentHash ? 1 : 0);
+    if (contentHash)
+        writeNumber<std::uint64_t>(output, *contentHash);
+}
+
+Opt<std::uint64_t> readContentHash(MemStreamIn& input) //throw UnexpectedEndOfStreamError
+{
+    if (readNumber<std::int8_t>(input) == 0)
+        return NoValue();
+    return readNumber<std::uint64_t>(input);
+}
+
+
 class StreamGenerator //for db-file back-wards compatibility we stick with two output streams until further
 {
 public:
@@ -165,7 +315,7 @@ public:
         StreamGenerator generator;
 
         //PERF_START
-        generator.recurse(dbFolder);
+        const RecordPos rootPos = generator.recurse(dbFolder);
         //PERF_STOP
 
         auto compStream = [](const ByteArray& stream, const std::wstring& displayFilePath) -> ByteArray //throw FileError
@@ -184,7 +334,7 @@ public:
                   7    12.54     3633
                   8    12.51     9032
                   9    12.50    19698 (maximal compression) */
-                return compress(stream, 3); //throw ZlibInternalError
+                return compressParallel(stream, 3); //throw ZlibInternalError
             }
             catch (ZlibInternalError&)
             {
@@ -192,9 +342,17 @@ public:
             }
         };
 
-        const ByteArray tmpL = compStream(generator.outputLeft .ref(), displayFilePathL);
-        const ByteArray tmpR = compStream(generator.outputRight.ref(), displayFilePathR);
-        const ByteArray tmpB = compStream(generator.outputBoth .ref(), displayFilePathL + L"/" + displayFilePathR);
+        //the three streams are independent => compress concurrently
+        auto ftL = runAsyncCompute([&] { return compStream(generator.outputLeft .ref(), displayFilePathL); });
+        auto ftR = runAsyncCompute([&] { return compStream(generator.outputRight.ref(), displayFilePathR); });
+        auto ftB = runAsyncCompute([&] { return compStream(generator.outputBoth .ref(), displayFilePathL + L"/" + displayFilePathR); });
+        ftL.wait(); //
+        ftR.wait(); //all tasks reference this stack frame: wait for completion before rethrowing an error!
+        ftB.wait(); //
+
+        const ByteArray tmpL = ftL.get(); //
+        const ByteArray tmpR = ftR.get(); //throw FileError
+        const ByteArray tmpB = ftB.get(); //
 
         MemStreamOut outL;
         MemStreamOut outR;
@@ -206,6 +364,12 @@ public:
         writeNumber<std::int8_t>(outL, true); //this side contains first part of "outputBoth"
         writeNumber<std::int8_t>(outR, false);
 
+        //position of the base folder's record: "both" is redundant, but keeps the stream format symmetric
+        writeNumber<std::uint64_t>(outL, rootPos.both);
+        writeNumber<std::uint64_t>(outR, rootPos.both);
+        writeNumber<std::uint64_t>(outL, rootPos.left);
+        writeNumber<std::uint64_t>(outR, rootPos.right);
+
         const size_t size1stPart = tmpB.size() / 2;
         const size_t size2ndPart = tmpB.size() - size1stPart;
 
@@ -224,21 +388,42 @@ public:
     }
 
 private:
-    void recurse(const InSyncFolder& container)
+    struct RecordPos
     {
-        writeNumber<std::uint32_t>(outputBoth, static_cast<std::uint32_t>(container.files.size()));
-        for (const auto& dbFile : container.files)
+        std::uint64_t both;
+        std::uint64_t left;
+        std::uint64_t right;
+    };
+
+    //one record per folder in each of the three streams: records of the sub folders are written first (post-order)
+    //=> the parent's record stores their positions: any folder can be decoded without reading its siblings
+    RecordPos recurse(const InSyncFolder& container)
+    {
+        std::vector<RecordPos> subFolderPos;
+        subFolderPos.reserve(container.refSubFolders().size());
+
+        for (const auto& dbFolder : container.refSubFolders())
+            subFolderPos.push_back(recurse(dbFolder.second));
+
+        const RecordPos pos = { outputBoth .ref().size(),
+                                outputLeft .ref().size(),
+                                outputRight.ref().size()
+                              };
+
+        writeNumber<std::uint32_t>(outputBoth, static_cast<std::uint32_t>(container.refSubFiles().size()));
+        for (const auto& dbFile : container.refSubFiles())
         {
             writeUtf8(outputBoth, dbFile.first);
             writeNumber<std::int32_t >(outputBoth, dbFile.second.cmpVar);
             writeNumber<std::uint64_t>(outputBoth, dbFile.second.fileSize);
+            writeContentHash(outputBoth, dbFile.second.contentHash);
 
             writeFile(outputLeft,  dbFile.second.left);
             writeFile(outputRight, dbFile.second.right);
         }
 
-        writeNumber<std::uint32_t>(outputBoth, static_cast<std::uint32_t>(container.symlinks.size()));
-        for (const auto& dbSymlink : container.symlinks)
+        writeNumber<std::uint32_t>(outputBoth, static_cast<std::uint32_t>(container.refSubLinks().size()));
+        for (const auto& dbSymlink : container.refSubLinks())
         {
             writeUtf8(outputBoth, dbSymlink.first);
             writeNumber<std::int32_t>(outputBoth, dbSymlink.second.cmpVar);
@@ -247,18 +432,21 @@ private:
             writeLink(outputRight, dbSymlink.second.right);
         }
 
-        writeNumber<std::uint32_t>(outputBoth, static_cast<std::uint32_t>(container.folders.size()));
-        for (const auto& dbFolder : container.folders)
+        writeNumber<std::uint32_t>(outputBoth, static_cast<std::uint32_t>(container.refSubFolders().size()));
+        auto itPos = subFolderPos.begin();
+        for (const auto& dbFolder : container.refSubFolders())
         {
             writeUtf8(outputBoth, dbFolder.first);
             writeNumber<std::int32_t>(outputBoth, dbFolder.second.status);
 
-            recurse(dbFolder.second);
+            writeNumber<std::uint64_t>(outputBoth, itPos->both);
+            writeNumber<std::uint64_t>(outputBoth, itPos->left);
+            writeNumber<std::uint64_t>(outputBoth, itPos->right);
+            ++itPos;
         }
+        return pos;
     }
 
-    static void writeUtf8(MemStreamOut& output, const Zstring& str) { writeContainer(output, utfCvrtTo<Zbase<char>>(str)); }
-
     static void writeFile(MemStreamOut& output, const InSyncDescrFile& descr)
     {
         writeNumber<std:: int64_t>(output, descr.lastWriteTimeRaw);
@@ -277,6 +465,122 @@ private:
 };
 
 
+//database streams shared by all folders not yet decoded
+struct DbStreamSource
+{
+    ByteArray bufferL;
+    ByteArray bufferR;
+    ByteArray bufferB;
+    std::wstring displayFilePathL; //used for diagnostics only
+    std::wstring displayFilePathR; //
+};
+
+
+InSyncDescrLink readLink(MemStreamIn& input) //throw UnexpectedEndOfStreamError
+{
+    const auto lastWriteTimeRaw = readNumber<std::int64_t>(input);
+    return InSyncDescrLink(lastWriteTimeRaw);
+}}
+
+
+struct zen::InSyncFolder::PendingRecord
+{
+    PendingRecord(const std::shared_ptr<const DbStreamSource>& sourceIn, std::uint64_t posBothIn, std::uint64_t posLeftIn, std::uint64_t posRightIn) :
+        source(sourceIn), posBoth(posBothIn), posLeft(posLeftIn), posRight(posRightIn) {}
+
+    static void attach(InSyncFolder& dbFolder, const PendingRecord& record) { dbFolder.pendingRecord = std::make_shared<const PendingRecord>(record); }
+
+    //stream version 3: decode a single folder record; sub folders are decoded on demand
+    void decode(FolderList& folders, FileList& files, SymlinkList& symlinks) const //throw FileError
+    {
+        try
+        {
+            MemStreamIn inputBoth (source->bufferB, static_cast<size_t>(posBoth)); //
+            MemStreamIn inputLeft (source->bufferL, static_cast<size_t>(posLeft)); //no buffer copies: ByteArray is ref-counted
+            MemStreamIn inputRight(source->bufferR, static_cast<size_t>(posRight)); //
+
+            size_t fileCount = readNumber<std::uint32_t>(inputBoth);
+            while (fileCount-- != 0)
+            {
+                const Zstring itemName = readUtf8(inputBoth);
+                const auto cmpVar = static_cast<CompareVariant>(readNumber<std::int32_t>(inputBoth));
+                const std::uint64_t fileSize = readNumber<std::uint64_t>(inputBoth);
+                const Opt<std::uint64_t> contentHash = readContentHash(inputBoth);
+                const InSyncDescrFile dataL = readFile(inputLeft);
+                const InSyncDescrFile dataR = readFile(inputRight);
+                files.emplace(itemName, InSyncFile(dataL, dataR, cmpVar, fileSize, contentHash));
+            }
+
+            size_t linkCount = readNumber<std::uint32_t>(inputBoth);
+            while (linkCount-- != 0)
+            {
+                const Zstring itemName = readUtf8(inputBoth);
+                const auto cmpVar = static_cast<CompareVariant>(readNumber<std::int32_t>(inputBoth));
+                InSyncDescrLink dataL = readLink(inputLeft);
+                InSyncDescrLink dataR = readLink(inputRight);
+                symlinks.emplace(itemName, InSyncSymlink(dataL, dataR, cmpVar));
+            }
+
+            size_t dirCount = readNumber<std::uint32_t>(inputBoth);
+            while (dirCount-- != 0)
+            {
+                const Zstring itemName = readUtf8(inputBoth);
+                const auto status = static_cast<InSyncFolder::InSyncStatus>(readNumber<std::int32_t>(inputBoth));
+
+                const std::uint64_t subPosBoth  = readNumber<std::uint64_t>(inputBoth);
+                const std::uint64_t subPosLeft  = readNumber<std::uint64_t>(inputBoth);
+                const std::uint64_t subPosRight = readNumber<std::uint64_t>(inputBoth);
+
+                InSyncFolder& dbFolder = folders.emplace(itemName, InSyncFolder(status)).first->second;
+                attach(dbFolder, PendingRecord(source, subPosBoth, subPosLeft, subPosRight));
+            }
+        }
+        catch (const UnexpectedEndOfStreamError&)
+        {
+            throw FileError(_("Database file is corrupt:") + L"\n" + fmtPath(source->displayFilePathL) + L"\n" + fmtPath(source->displayFilePathR));
+        }
+        catch (const std::bad_alloc& e)
+        {
+            throw FileError(_("Database file is corrupt:") + L"\n" + fmtPath(source->displayFilePathL) + L"\n" + fmtPath(source->displayFilePathR),
+                            _("Out of memory.") + L" " + utfCvrtTo<std::wstring>(e.what()));
+        }
+    }
+
+private:
+    static InSyncDescrFile readFile(MemStreamIn& input) //throw UnexpectedEndOfStreamError
+    {
+        //attention: order of function argument evaluation is undefined! So do it one after the other...
+        const auto lastWriteTimeRaw = readNumber<std::int64_t>(input);
+        const auto fileId = readContainer<AFS::FileId>(input);
+        return InSyncDescrFile(lastWriteTimeRaw, fileId);
+    }
+
+    const std::shared_ptr<const DbStreamSource> source;
+    const std::uint64_t posBoth;  //positions of the folder's record within the decompressed streams
+    const std::uint64_t posLeft;  //
+    const std::uint64_t posRight; //
+};
+
+
+void zen::InSyncFolder::decodePendingRecord() const //throw FileError
+{
+    //decode into temporaries: on error the record stays pending and the folder is not left partially decoded
+    FolderList  foldersTmp;
+    FileList    filesTmp;
+    SymlinkList symlinksTmp;
+    pendingRecord->decode(foldersTmp, filesTmp, symlinksTmp); //throw FileError
+
+    folders .swap(foldersTmp);
+    files   .swap(filesTmp);
+    symlinks.swap(symlinksTmp);
+    pendingRecord.reset();
+}
+
+
+namespace
+{
+
+
 class StreamParser
 {
 public:
@@ -285,11 +589,13 @@ public:
                                                  const std::wstring& displayFilePathL, //used for diagnostics only
                                                  const std::wstring& displayFilePathR)
     {
-        auto decompStream = [](const ByteArray& stream, const std::wstring& displayFilePath) -> ByteArray //throw FileError
+        auto decompStream = [](const ByteArray& stream, int streamVersion, const std::wstring& displayFilePath) -> ByteArray //throw FileError
         {
             try
             {
-                return decompress(stream); //throw ZlibInternalError
+                return streamVersion == DB_FORMAT_STREAM ?
+                       decompressParallel(stream) : //throw ZlibInternalError
+                       decompress        (stream);  //
             }
             catch (ZlibInternalError&)
             {
@@ -310,6 +616,7 @@ public:
 
             warn_static("remove check for stream version 1 after migration! 2015-05-02")
             if (streamVersionL != 1 &&
+                streamVersionL != 2 &&
                 streamVersionL != DB_FORMAT_STREAM)
                 throw FileError(replaceCpy(_("Database file %x is incompatible."), L"%x", fmtPath(displayFilePathL)), L"unknown stream format");
 
@@ -319,6 +626,18 @@ public:
             if (has1stPartL == has1stPartR)
                 throw FileError(_("Database file is corrupt:") + L"\n" + fmtPath(displayFilePathL) + L"\n" + fmtPath(displayFilePathR), L"second part missing");
 
+            std::uint64_t rootPosBoth  = 0;
+            std::uint64_t rootPosLeft  = 0;
+            std::uint64_t rootPosRight = 0;
+            if (streamVersionL == DB_FORMAT_STREAM)
+            {
+                rootPosBoth = readNumber<std::uint64_t>(inL);
+                if (readNumber<std::uint64_t>(inR) != rootPosBoth)
+                    throw FileError(_("Database file is corrupt:") + L"\n" + fmtPath(displayFilePathL) + L"\n" + fmtPath(displayFilePathR), L"different base folder records");
+                rootPosLeft  = readNumber<std::uint64_t>(inL);
+                rootPosRight = readNumber<std::uint64_t>(inR);
+            }
+
             MemStreamIn& in1stPart = has1stPartL ? inL : inR;
             MemStreamIn& in2ndPart = has1stPartL ? inR : inL;
 
@@ -333,12 +652,37 @@ public:
             const ByteArray tmpL = readContainer<ByteArray>(inL);
             const ByteArray tmpR = readContainer<ByteArray>(inR);
 
+            //the three streams are independent => decompress concurrently
+            auto ftL = runAsyncCompute([&] { return decompStream(tmpL, streamVersionL, displayFilePathL); });
+            auto ftR = runAsyncCompute([&] { return decompStream(tmpR, streamVersionL, displayFilePathR); });
+            auto ftB = runAsyncCompute([&] { return decompStream(tmpB, streamVersionL, displayFilePathL + L"/" + displayFilePathR); });
+            ftL.wait(); //
+            ftR.wait(); //all tasks reference this stack frame: wait for completion before rethrowing an error!
+            ftB.wait(); //
+
             auto output = std::make_shared<InSyncFolder>(InSyncFolder::DIR_STATUS_IN_SYNC);
-            StreamParser parser(streamVersionL,
-                                decompStream(tmpL, displayFilePathL),
-                                decompStream(tmpR, displayFilePathR),
-                                decompStream(tmpB, displayFilePathL + L"/" + displayFilePathR));
-            parser.recurse(*output); //throw UnexpectedEndOfStreamError
+
+            if (streamVersionL == DB_FORMAT_STREAM)
+            {
+                auto source = std::make_shared<DbStreamSource>();
+                source->bufferL = ftL.get(); //
+                source->bufferR = ftR.get(); //throw FileError
+                source->bufferB = ftB.get(); //
+                source->displayFilePathL = displayFilePathL;
+                source->displayFilePathR = displayFilePathR;
+
+                //child items are decoded on first access
+                InSyncFolder::PendingRecord::attach(*output, InSyncFolder::PendingRecord(source, rootPosBoth, rootPosLeft, rootPosRight));
+            }
+            else
+            {
+                const ByteArray bufferL = ftL.get(); //
+                const ByteArray bufferR = ftR.get(); //throw FileError
+                const ByteArray bufferB = ftB.get(); //
+
+                StreamParser parser(streamVersionL, bufferL, bufferR, bufferB);
+                parser.recurse(*output); //throw UnexpectedEndOfStreamError
+            }
             return output;
         }
         catch (const UnexpectedEndOfStreamError&)
@@ -353,6 +697,7 @@ public:
     }
 
 private:
+    //stream versions 1 and 2: hierarchy is stored depth-first without positions => decode everything at once
     StreamParser(int streamVersion,
                  const ByteArray& bufferL,
                  const ByteArray& bufferR,
@@ -372,7 +717,7 @@ private:
             const std::uint64_t fileSize = readNumber<std::uint64_t>(inputBoth);
             const InSyncDescrFile dataL = readFile(inputLeft);
             const InSyncDescrFile dataR = readFile(inputRight);
-            container.addFile(itemName, dataL, dataR, cmpVar, fileSize);
+            container.addFile(itemName, dataL, dataR, cmpVar, fileSize, NoValue());
         }
 
         size_t linkCount = readNumber<std::uint32_t>(inputBoth);
@@ -396,8 +741,6 @@ private:
         }
     }
 
-    static Zstring readUtf8(MemStreamIn& input) { return utfCvrtTo<Zstring>(readContainer<Zbase<char>>(input)); } //throw UnexpectedEndOfStreamError
-
     InSyncDescrFile readFile(MemStreamIn& input) const
     {
         //attention: order of function argument evaluation is undefined! So do it one after the other...
@@ -422,18 +765,210 @@ private:
         return InSyncDescrFile(lastWriteTimeRaw, fileId);
     }
 
-    static InSyncDescrLink readLink(MemStreamIn& input)
-    {
-        const auto lastWriteTimeRaw = readNumber<std::int64_t>(input);
-        return InSyncDescrLink(lastWriteTimeRaw);
-    }
-
     const int streamVersion_;
     MemStreamIn inputLeft;  //data related to one side only
     MemStreamIn inputRight; //
     MemStreamIn inputBoth;  //data concerning both sides
 };
 
+
+//decode all child items not yet decoded, e.g. before serializing the hierarchy again
+void decodeRecursively(const InSyncFolder& dbFolder) //throw FileError
+{
+    for (const auto& dbSubFolder : dbFolder.refSubFolders())
+        decodeRecursively(dbSubFolder.second);
+}
+
+
+//---------------------------------------------------------------------------------------------------------------------------------------
+
+InSyncFolder* findDbFolder(InSyncFolder& dbRoot, const Zstring& relPathPf) //throw FileError
+{
+    InSyncFolder* dbFolder = &dbRoot;
+    for (const Zstring& itemName : split(relPathPf, FILE_NAME_SEPARATOR))
+        if (!itemName.empty())
+        {
+            auto it = dbFolder->refSubFolders().find(itemName);
+            if (it == dbFolder->refSubFolders().end())
+                return nullptr;
+            dbFolder = &it->second;
+        }
+    return dbFolder;
+}
+
+
+//journal delta: complete list of direct child items for each changed folder => can be applied without knowing the previous state of the folder
+ByteArray generateDelta(InSyncFolder& dbRoot, const std::set<Zstring>& changedFolders, //relative paths with trailing separator; throw FileError
+                        const std::wstring& displayFilePathL, //used for diagnostics only
+                        const std::wstring& displayFilePathR)
+{
+    std::vector<std::pair<Zstring, const InSyncFolder*>> deltaFolders;
+    for (const Zstring& relPathPf : changedFolders) //parent folders first
+        if (const InSyncFolder* dbFolder = findDbFolder(dbRoot, relPathPf)) //throw FileError
+            deltaFolders.emplace_back(relPathPf, dbFolder);
+
+    MemStreamOut output;
+    writeNumber<std::uint32_t>(output, static_cast<std::uint32_t>(deltaFolders.size()));
+
+    for (const auto& item : deltaFolders)
+    {
+        const InSyncFolder& dbFolder = *item.second;
+        writeUtf8(output, item.first);
+
+        writeNumber<std::uint32_t>(output, static_cast<std::uint32_t>(dbFolder.refSubFiles().size()));
+        for (const auto& dbFile : dbFolder.refSubFiles())
+        {
+            writeUtf8(output, dbFile.first);
+            writeNumber<std::int32_t >(output, dbFile.second.cmpVar);
+            writeNumber<std::uint64_t>(output, dbFile.second.fileSize);
+            writeContentHash          (output, dbFile.second.contentHash);
+            writeNumber<std:: int64_t>(output, dbFile.second.left .lastWriteTimeRaw);
+            writeContainer            (output, dbFile.second.left .fileId);
+            writeNumber<std:: int64_t>(output, dbFile.second.right.lastWriteTimeRaw);
+            writeContainer            (output, dbFile.second.right.fileId);
+        }
+
+        writeNumber<std::uint32_t>(output, static_cast<std::uint32_t>(dbFolder.refSubLinks().size()));
+        for (const auto& dbSymlink : dbFolder.refSubLinks())
+        {
+            writeUtf8(output, dbSymlink.first);
+            writeNumber<std::int32_t>(output, dbSymlink.second.cmpVar);
+            writeNumber<std::int64_t>(output, dbSymlink.second.left .lastWriteTimeRaw);
+            writeNumber<std::int64_t>(output, dbSymlink.second.right.lastWriteTimeRaw);
+        }
+
+        writeNumber<std::uint32_t>(output, static_cast<std::uint32_t>(dbFolder.refSubFolders().size()));
+        for (const auto& dbSubFolder : dbFolder.refSubFolders())
+        {
+            writeUtf8(output, dbSubFolder.first);
+            writeNumber<std::int32_t>(output, dbSubFolder.second.status);
+        }
+    }
+
+    try
+    {
+        return compress(output.ref(), 3); //throw ZlibInternalError
+    }
+    catch (ZlibInternalError&)
+    {
+        throw FileError(replaceCpy(_("Cannot write file %x."), L"%x", fmtPath(displayFilePathL + L"/" + displayFilePathR)), L"zlib internal error");
+    }
+}
+
+
+void applyDelta(InSyncFolder& dbRoot, const ByteArray& delta, //throw FileError
+                const std::wstring& displayFilePathL, //used for diagnostics only
+                const std::wstring& displayFilePathR)
+{
+    const std::wstring errorMsg = _("Database file is corrupt:") + L"\n" + fmtPath(displayFilePathL) + L"\n" + fmtPath(displayFilePathR);
+    try
+    {
+        MemStreamIn input(decompress(delta)); //throw ZlibInternalError
+
+        size_t folderCount = readNumber<std::uint32_t>(input); //throw UnexpectedEndOfStreamError
+        while (folderCount-- != 0)
+        {
+            const Zstring relPathPf = readUtf8(input);
+
+            InSyncFolder* dbFolder = findDbFolder(dbRoot, relPathPf); //throw FileError
+            if (!dbFolder)
+                throw FileError(errorMsg, L"journal does not match database");
+
+            InSyncFolder::FileList files;
+            size_t fileCount = readNumber<std::uint32_t>(input);
+            while (fileCount-- != 0)
+            {
+                //attention: order of function argument evaluation is undefined! So do it one after the other...
+                const Zstring itemName = readUtf8(input);
+                const auto cmpVar = static_cast<CompareVariant>(readNumber<std::int32_t>(input));
+                const std::uint64_t fileSize = readNumber<std::uint64_t>(input);
+                const Opt<std::uint64_t> contentHash = readContentHash(input);
+                const auto lastWriteTimeL = readNumber<std::int64_t>(input);
+                const auto fileIdL        = readContainer<AFS::FileId>(input);
+                const auto lastWriteTimeR = readNumber<std::int64_t>(input);
+                const auto fileIdR        = readContainer<AFS::FileId>(input);
+                files.emplace(itemName, InSyncFile(InSyncDescrFile(lastWriteTimeL, fileIdL), InSyncDescrFile(lastWriteTimeR, fileIdR), cmpVar, fileSize, contentHash));
+            }
+
+            InSyncFolder::SymlinkList symlinks;
+            size_t linkCount = readNumber<std::uint32_t>(input);
+            while (linkCount-- != 0)
+            {
+                const Zstring itemName = readUtf8(input);
+                const auto cmpVar = static_cast<CompareVariant>(readNumber<std::int32_t>(input));
+                const InSyncDescrLink dataL = readLink(input);
+                const InSyncDescrLink dataR = readLink(input);
+                symlinks.emplace(itemName, InSyncSymlink(dataL, dataR, cmpVar));
+            }
+
+            //keep the (not yet decoded) child items of sub folders that still exist
+            InSyncFolder::FolderList& dbSubFolders = dbFolder->refSubFolders();
+            InSyncFolder::FolderList subFolders;
+            size_t dirCount = readNumber<std::uint32_t>(input);
+            while (dirCount-- != 0)
+            {
+                const Zstring itemName = readUtf8(input);
+                const auto status = static_cast<InSyncFolder::InSyncStatus>(readNumber<std::int32_t>(input));
+
+                auto it = dbSubFolders.find(itemName);
+                InSyncFolder& dbSubFolder = it != dbSubFolders.end() ?
+                                            subFolders.emplace(itemName, std::move(it->second)).first->second : //take over new name: might differ in case
+                                            subFolders.emplace(itemName, InSyncFolder(status)).first->second;
+                dbSubFolder.status = status;
+            }
+
+            dbFolder->refSubFiles().swap(files);
+            dbFolder->refSubLinks().swap(symlinks);
+            dbSubFolders.swap(subFolders);
+        }
+    }
+    catch (ZlibInternalError&)
+    {
+        throw FileError(replaceCpy(_("Cannot read file %x."), L"%x", fmtPath(displayFilePathL + L"/" + displayFilePathR)), L"zlib internal error");
+    }
+    catch (const UnexpectedEndOfStreamError&)
+    {
+        throw FileError(errorMsg);
+    }
+    catch (const std::bad_alloc& e)
+    {
+        throw FileError(errorMsg, _("Out of memory.") + L" " + utfCvrtTo<std::wstring>(e.what()));
+    }
+}
+
+
+//the journal is merged into the database stream once it makes up a sizable fraction of what needs to be read anyway
+const std::uint64_t JOURNAL_COMPACTION_RATIO = 4; //compact if journal size > database stream size / ratio
+
+
+//unchanged file: requires a file id, otherwise a different file with the same size and time could take its place
+bool sameFileDescr(const InSyncDescrFile& lhs, const InSyncDescrFile& rhs)
+{
+    return lhs.lastWriteTimeRaw == rhs.lastWriteTimeRaw &&
+           !lhs.fileId.empty() && lhs.fileId == rhs.fileId;
+}
+
+
+bool sameDbEntry(const InSyncFile& lhs, const InSyncFile& rhs)
+{
+    return lhs.left .lastWriteTimeRaw == rhs.left .lastWriteTimeRaw &&
+           lhs.left .fileId           == rhs.left .fileId           &&
+           lhs.right.lastWriteTimeRaw == rhs.right.lastWriteTimeRaw &&
+           lhs.right.fileId           == rhs.right.fileId           &&
+           lhs.cmpVar   == rhs.cmpVar &&
+           lhs.fileSize == rhs.fileSize &&
+           static_cast<bool>(lhs.contentHash) == static_cast<bool>(rhs.contentHash) &&
+           (!lhs.contentHash || *lhs.contentHash == *rhs.contentHash);
+}
+
+
+bool sameDbEntry(const InSyncSymlink& lhs, const InSyncSymlink& rhs)
+{
+    return lhs.left .lastWriteTimeRaw == rhs.left .lastWriteTimeRaw &&
+           lhs.right.lastWriteTimeRaw == rhs.right.lastWriteTimeRaw &&
+           lhs.cmpVar == rhs.cmpVar;
+}
+
 //#######################################################################################################################################
 
 class UpdateLastSynchronousState
@@ -445,26 +980,28 @@ class UpdateLastSynchronousState
         => update all database entries!
     */
 public:
-    static void execute(const BaseFolderPair& baseFolder, InSyncFolder& dbFolder)
+    static void execute(const BaseFolderPair& baseFolder, InSyncFolder& dbFolder, //throw FileError
+                        std::set<Zstring>& changedFolders) //relative paths with trailing separator of folders with modified child items
     {
-        UpdateLastSynchronousState updater(baseFolder.getCompVariant(), baseFolder.getFilter());
+        UpdateLastSynchronousState updater(baseFolder.getCompVariant(), baseFolder.getFilter(), changedFolders);
         updater.recurse(baseFolder, dbFolder);
     }
 
 private:
-    UpdateLastSynchronousState(CompareVariant activeCmpVar, const HardFilter& filter) :
+    UpdateLastSynchronousState(CompareVariant activeCmpVar, const HardFilter& filter, std::set<Zstring>& changedFolders) :
         filter_(filter),
-        activeCmpVar_(activeCmpVar) {}
+        activeCmpVar_(activeCmpVar),
+        changedFolders_(changedFolders) {}
 
     void recurse(const HierarchyObject& hierObj, InSyncFolder& dbFolder)
     {
-        process(hierObj.refSubFiles  (), hierObj.getPairRelativePathPf(), dbFolder.files);
-        process(hierObj.refSubLinks  (), hierObj.getPairRelativePathPf(), dbFolder.symlinks);
-        process(hierObj.refSubFolders(), hierObj.getPairRelativePathPf(), dbFolder.folders);
+        process(hierObj.refSubFiles  (), hierObj.getPairRelativePathPf(), dbFolder.refSubFiles  ());
+        process(hierObj.refSubLinks  (), hierObj.getPairRelativePathPf(), dbFolder.refSubLinks  ());
+        process(hierObj.refSubFolders(), hierObj.getPairRelativePathPf(), dbFolder.refSubFolders());
     }
 
     template <class M, class V>
-    static V& updateItem(M& map, const Zstring& key, const V& value)
+    static V& updateItem(M& map, const Zstring& key, const V& value, bool& changed)
     {
         auto rv = map.emplace(key, value);
         if (!rv.second)
@@ -473,11 +1010,18 @@ private:
             if (rv.first->first != key) //=> conceptually case-sensitivity should be part of "value", not "key"
             {
                 map.erase(rv.first);
+                changed = true;
                 return map.emplace(key, value).first->second;
             }
 #endif
-            rv.first->second = value;
+            if (!sameDbEntry(rv.first->second, value))
+            {
+                rv.first->second = value;
+                changed = true;
+            }
         }
+        else
+            changed = true;
         return rv.first->second;
 
         //www.cplusplus.com claims that hint position for map<>::insert(iterator position, const value_type& val) changed with C++11 -> standard is unclear in [map.modifiers]
@@ -507,6 +1051,7 @@ private:
     void process(const HierarchyObject::FileList& currentFiles, const Zstring& parentRelPathPf, InSyncFolder::FileList& dbFiles)
     {
         std::unordered_set<const InSyncFile*> toPreserve; //referencing fixed-in-memory std::map elements
+        bool changed = false;
 
         for (const FilePair& file : currentFiles)
             if (!file.isEmpty())
@@ -519,14 +1064,27 @@ private:
                     //this should be taken for granted:
                     assert(file.getFileSize<LEFT_SIDE>() == file.getFileSize<RIGHT_SIDE>());
 
+                    InSyncFile newDbFile(InSyncDescrFile(file.getLastWriteTime<LEFT_SIDE >(),
+                                                         file.getFileId       <LEFT_SIDE >()),
+                                         InSyncDescrFile(file.getLastWriteTime<RIGHT_SIDE>(),
+                                                         file.getFileId       <RIGHT_SIDE>()),
+                                         activeCmpVar_,
+                                         file.getFileSize<LEFT_SIDE>(),
+                                         file.getContentHash());
+
+                    //content not read during this run: the hash of the previous sync is still valid if neither side has changed since
+                    if (!newDbFile.contentHash)
+                    {
+                        auto it = dbFiles.find(file.getPairItemName());
+                        if (it != dbFiles.end() && it->second.contentHash &&
+                            it->second.fileSize == newDbFile.fileSize &&
+                            sameFileDescr(it->second.left,  newDbFile.left) &&
+                            sameFileDescr(it->second.right, newDbFile.right))
+                            newDbFile.contentHash = it->second.contentHash;
+                    }
+
                     //create or update new "in-sync" state
-                    InSyncFile& dbFile = updateItem(dbFiles, file.getPairItemName(),
-                                                    InSyncFile(InSyncDescrFile(file.getLastWriteTime<LEFT_SIDE >(),
-                                                                               file.getFileId       <LEFT_SIDE >()),
-                                                               InSyncDescrFile(file.getLastWriteTime<RIGHT_SIDE>(),
-                                                                               file.getFileId       <RIGHT_SIDE>()),
-                                                               activeCmpVar_,
-                                                               file.getFileSize<LEFT_SIDE>()));
+                    InSyncFile& dbFile = updateItem(dbFiles, file.getPairItemName(), newDbFile, changed);
                     toPreserve.insert(&dbFile);
                 }
                 else //not in sync: preserve last synchronous state
@@ -538,6 +1096,7 @@ private:
             }
 
         //delete removed items (= "in-sync") from database
+        const size_t dbFileCount = dbFiles.size();
         erase_if(dbFiles, [&](const InSyncFolder::FileList::value_type& v) -> bool
         {
             if (toPreserve.find(&v.second) != toPreserve.end())
@@ -547,11 +1106,15 @@ private:
             return filter_.passFileFilter(itemRelPath);
             //note: items subject to traveral errors are also excluded by this file filter here! see comparison.cpp, modified file filter for read errors
         });
+
+        if (changed || dbFiles.size() != dbFileCount)
+            changedFolders_.insert(parentRelPathPf);
     }
 
     void process(const HierarchyObject::SymlinkList& currentSymlinks, const Zstring& parentRelPathPf, InSyncFolder::SymlinkList& dbSymlinks)
     {
         std::unordered_set<const InSyncSymlink*> toPreserve;
+        bool changed = false;
 
         for (const SymlinkPair& symlink : currentSymlinks)
             if (!symlink.isEmpty())
@@ -564,7 +1127,7 @@ private:
                     InSyncSymlink& dbSymlink = updateItem(dbSymlinks, symlink.getPairItemName(),
                                                           InSyncSymlink(InSyncDescrLink(symlink.getLastWriteTime<LEFT_SIDE>()),
                                                                         InSyncDescrLink(symlink.getLastWriteTime<RIGHT_SIDE>()),
-                                                                        activeCmpVar_));
+                                                                        activeCmpVar_), changed);
                     toPreserve.insert(&dbSymlink);
                 }
                 else //not in sync: preserve last synchronous state
@@ -576,6 +1139,7 @@ private:
             }
 
         //delete removed items (= "in-sync") from database
+        const size_t dbSymlinkCount = dbSymlinks.size();
         erase_if(dbSymlinks, [&](const InSyncFolder::SymlinkList::value_type& v) -> bool
         {
             if (toPreserve.find(&v.second) != toPreserve.end())
@@ -584,11 +1148,15 @@ private:
             const Zstring& itemRelPath = parentRelPathPf + v.first;
             return filter_.passFileFilter(itemRelPath);
         });
+
+        if (changed || dbSymlinks.size() != dbSymlinkCount)
+            changedFolders_.insert(parentRelPathPf);
     }
 
     void process(const HierarchyObject::FolderList& currentFolders, const Zstring& parentRelPathPf, InSyncFolder::FolderList& dbFolders)
     {
         std::unordered_set<const InSyncFolder*> toPreserve;
+        bool changed = false;
 
         for (const FolderPair& folder : currentFolders)
             if (!folder.isEmpty())
@@ -602,6 +1170,8 @@ private:
                         const Zstring& key = folder.getPairItemName();
                         auto insertResult = dbFolders.emplace(key, InSyncFolder(InSyncFolder::DIR_STATUS_IN_SYNC)); //get or create
                         auto it = insertResult.first;
+                        if (insertResult.second)
+                            changed = true;
 
 #if defined ZEN_WIN || defined ZEN_MAC //caveat: key might need to be updated, too, if there is a change in short name case!!!
                         const bool alreadyExisting = !insertResult.second;
@@ -610,10 +1180,15 @@ private:
                             auto oldValue = std::move(it->second);
                             dbFolders.erase(it); //don't fiddle with decrementing "it"! - you might lose while optimizing pointlessly
                             it = dbFolders.emplace(key, std::move(oldValue)).first;
+                            changed = true;
                         }
 #endif
                         InSyncFolder& dbFolder = it->second;
-                        dbFolder.status = InSyncFolder::DIR_STATUS_IN_SYNC; //update immediate directory entry
+                        if (dbFolder.status != InSyncFolder::DIR_STATUS_IN_SYNC)
+                        {
+                            dbFolder.status = InSyncFolder::DIR_STATUS_IN_SYNC; //update immediate directory entry
+                            changed = true;
+                        }
                         toPreserve.insert(&dbFolder);
                         recurse(folder, dbFolder);
                     }
@@ -626,7 +1201,10 @@ private:
                         //Example: directories on left and right differ in case while sub-files are equal
                     {
                         //reuse last "in-sync" if available or insert strawman entry (do not try to update and thereby remove child elements!!!)
-                        InSyncFolder& dbFolder = dbFolders.emplace(folder.getPairItemName(), InSyncFolder(InSyncFolder::DIR_STATUS_STRAW_MAN)).first->second;
+                        auto insertResult = dbFolders.emplace(folder.getPairItemName(), InSyncFolder(InSyncFolder::DIR_STATUS_STRAW_MAN));
+                        if (insertResult.second)
+                            changed = true;
+                        InSyncFolder& dbFolder = insertResult.first->second;
                         toPreserve.insert(&dbFolder);
                         recurse(folder, dbFolder); //unconditional recursion without filter check! => no problem since "childItemMightMatch" is optional!!!
                     }
@@ -647,6 +1225,7 @@ private:
                 }
 
         //delete removed items (= "in-sync") from database
+        const size_t dbFolderCount = dbFolders.size();
         erase_if(dbFolders, [&](InSyncFolder::FolderList::value_type& v) -> bool
         {
             if (toPreserve.find(&v.second) != toPreserve.end())
@@ -662,15 +1241,20 @@ private:
                 dbSetEmptyState(v.second, appendSeparator(itemRelPath)); //child items might match, e.g. *.txt include filter!
             return passFilter;
         });
+
+        if (changed || dbFolders.size() != dbFolderCount)
+            changedFolders_.insert(parentRelPathPf);
     }
 
     //delete all entries for removed folder (= "in-sync") from database
     void dbSetEmptyState(InSyncFolder& dbFolder, const Zstring& parentRelPathPf)
     {
-        erase_if(dbFolder.files,    [&](const InSyncFolder::FileList   ::value_type& v) { return filter_.passFileFilter(parentRelPathPf + v.first); });
-        erase_if(dbFolder.symlinks, [&](const InSyncFolder::SymlinkList::value_type& v) { return filter_.passFileFilter(parentRelPathPf + v.first); });
+        const size_t dbItemCount = dbFolder.refSubFiles().size() + dbFolder.refSubLinks().size() + dbFolder.refSubFolders().size();
+
+        erase_if(dbFolder.refSubFiles(), [&](const InSyncFolder::FileList   ::value_type& v) { return filter_.passFileFilter(parentRelPathPf + v.first); });
+        erase_if(dbFolder.refSubLinks(), [&](const InSyncFolder::SymlinkList::value_type& v) { return filter_.passFileFilter(parentRelPathPf + v.first); });
 
-        erase_if(dbFolder.folders, [&](InSyncFolder::FolderList::value_type& v)
+        erase_if(dbFolder.refSubFolders(), [&](InSyncFolder::FolderList::value_type& v)
         {
             const Zstring& itemRelPath = parentRelPathPf + v.first;
 
@@ -680,10 +1264,14 @@ private:
                 dbSetEmptyState(v.second, appendSeparator(itemRelPath));
             return passFilter;
         });
+
+        if (dbFolder.refSubFiles().size() + dbFolder.refSubLinks().size() + dbFolder.refSubFolders().size() != dbItemCount)
+            changedFolders_.insert(parentRelPathPf);
     }
 
     const HardFilter& filter_; //filter used while scanning directory: generates view on actual files!
     const CompareVariant activeCmpVar_;
+    std::set<Zstring>& changedFolders_;
 };
 }
 
@@ -715,10 +1303,18 @@ std::shared_ptr<InSyncFolder> zen::loadLastSynchronousState(const BaseFolderPair
         auto itRight = streamsRight.find(streamLeft.first);
         if (itRight != streamsRight.end())
         {
-            return StreamParser::execute(streamLeft.second, //throw FileError
-                                         itRight->second,
-                                         AFS::getDisplayPath(dbPathLeft),
-                                         AFS::getDisplayPath(dbPathRight));
+            std::shared_ptr<InSyncFolder> lastSyncState = StreamParser::execute(streamLeft.second, //throw FileError
+                                                                                itRight->second,
+                                                                                AFS::getDisplayPath(dbPathLeft),
+                                                                                AFS::getDisplayPath(dbPathRight));
+            //apply changes of syncs not yet merged into the database stream
+            const DbJournal journalLeft  = loadJournal(getDatabaseFilePath<LEFT_SIDE >(baseFolder, false, true), onUpdateStatus); //throw FileError
+            const DbJournal journalRight = loadJournal(getDatabaseFilePath<RIGHT_SIDE>(baseFolder, false, true), onUpdateStatus); //
+
+            for (const JournalEntry& entry : getCommittedDeltas(journalLeft, journalRight, streamLeft.first))
+                applyDelta(*lastSyncState, entry.delta, AFS::getDisplayPath(dbPathLeft), AFS::getDisplayPath(dbPathRight)); //throw FileError
+
+            return lastSyncState;
         }
     }
     throw FileErrorDatabaseNotExisting(_("Initial synchronization:") + L" \n" +
@@ -735,9 +1331,17 @@ void zen::saveLastSynchronousState(const BaseFolderPair& baseFolder, const std::
     const AbstractPath dbPathLeftTmp  = getDatabaseFilePath<LEFT_SIDE >(baseFolder, true);
     const AbstractPath dbPathRightTmp = getDatabaseFilePath<RIGHT_SIDE>(baseFolder, true);
 
+    const AbstractPath journalPathLeft  = getDatabaseFilePath<LEFT_SIDE >(baseFolder, false, true);
+    const AbstractPath journalPathRight = getDatabaseFilePath<RIGHT_SIDE>(baseFolder, false, true);
+
+    const AbstractPath journalPathLeftTmp  = getDatabaseFilePath<LEFT_SIDE >(baseFolder, true, true);
+    const AbstractPath journalPathRightTmp = getDatabaseFilePath<RIGHT_SIDE>(baseFolder, true, true);
+
     //delete old tmp file, if necessary -> throws if deletion fails!
     AFS::removeFile(dbPathLeftTmp);  //
     AFS::removeFile(dbPathRightTmp); //throw FileError
+    AFS::removeFile(journalPathLeftTmp);  //
+    AFS::removeFile(journalPathRightTmp); //
 
     //(try to) load old database files...
     DbStreams streamsLeft; //list of session ID + DirInfo-stream
@@ -753,6 +1357,24 @@ void zen::saveLastSynchronousState(const BaseFolderPair& baseFolder, const std::
     catch (FileError&) {}
     //if error occurs: just overwrite old file! User is already informed about issues right after comparing!
 
+    DbJournal journalLeft;
+    DbJournal journalRight;
+    bool journalCorrupt = false; //=> the streams alone are outdated: overwrite both database and journal files!
+    try { journalLeft  = loadJournal(journalPathLeft,  onUpdateStatus); }
+    catch (FileError&) { journalCorrupt = true; }
+    try { journalRight = loadJournal(journalPathRight, onUpdateStatus); }
+    catch (FileError&) { journalCorrupt = true; }
+
+    auto saveJournalTransactional = [&](const DbJournal& journal, const AbstractPath& journalPath, const AbstractPath& journalPathTmp) //throw FileError
+    {
+        if (!journal.empty())
+            saveJournal(journal, journalPathTmp, onUpdateStatus); //throw FileError
+
+        AFS::removeFile(journalPath); //throw FileError
+        if (!journal.empty())
+            AFS::renameItem(journalPathTmp, journalPath); //throw FileError, (ErrorTargetExisting, ErrorDifferentVolume)
+    };
+
     //find associated session: there can be at most one session within intersection of left and right ids
     auto itStreamLeftOld  = streamsLeft .cend();
     auto itStreamRightOld = streamsRight.cend();
@@ -768,20 +1390,64 @@ void zen::saveLastSynchronousState(const BaseFolderPair& baseFolder, const std::
     }
 
     //load last synchrounous state
-    std::shared_ptr<InSyncFolder> lastSyncState = std::make_shared<InSyncFolder>(InSyncFolder::DIR_STATUS_IN_SYNC);
+    std::shared_ptr<InSyncFolder> lastSyncState;
+    std::set<Zstring> changedFolders;
+    std::vector<JournalEntry> sessionJournal;
+    bool compactJournal = false;
+
     if (itStreamLeftOld  != streamsLeft .end() &&
-        itStreamRightOld != streamsRight.end())
+        itStreamRightOld != streamsRight.end() && !journalCorrupt)
         try
         {
-            lastSyncState = StreamParser::execute(itStreamLeftOld ->second, //throw FileError
-                                                  itStreamRightOld->second,
-                                                  AFS::getDisplayPath(dbPathLeft),
-                                                  AFS::getDisplayPath(dbPathRight));
+            std::shared_ptr<InSyncFolder> dbState = StreamParser::execute(itStreamLeftOld ->second, //throw FileError
+                                                                          itStreamRightOld->second,
+                                                                          AFS::getDisplayPath(dbPathLeft),
+                                                                          AFS::getDisplayPath(dbPathRight));
+            sessionJournal = getCommittedDeltas(journalLeft, journalRight, itStreamLeftOld->first);
+            for (const JournalEntry& entry : sessionJournal)
+                applyDelta(*dbState, entry.delta, AFS::getDisplayPath(dbPathLeft), AFS::getDisplayPath(dbPathRight)); //throw FileError
+
+            //update last synchrounous state
+            UpdateLastSynchronousState::execute(baseFolder, *dbState, changedFolders); //throw FileError
+
+            if (!changedFolders.empty())
+            {
+                sessionJournal.emplace_back(zen::generateGUID(), generateDelta(*dbState, changedFolders, //throw FileError
+                                                                               AFS::getDisplayPath(dbPathLeft),
+                                                                               AFS::getDisplayPath(dbPathRight)));
+
+                compactJournal = getJournalSize(sessionJournal) > (itStreamLeftOld->second.size() + itStreamRightOld->second.size()) / JOURNAL_COMPACTION_RATIO;
+                if (compactJournal)
+                    decodeRecursively(*dbState); //throw FileError; the complete hierarchy is serialized again
+            }
+            lastSyncState = dbState;
+        }
+        catch (FileError&) //if error occurs: just overwrite old file! User is already informed about issues right after comparing!
+        {
+            changedFolders.clear();
+            sessionJournal.clear();
+            compactJournal = false;
         }
-        catch (FileError&) {} //if error occurs: just overwrite old file! User is already informed about issues right after comparing!
 
-    //update last synchrounous state
-    UpdateLastSynchronousState::execute(baseFolder, *lastSyncState);
+    if (lastSyncState && !compactJournal)
+    {
+        if (changedFolders.empty())
+            return; //some users monitor the *.ffs_db file with RTS => don't touch the file if it isnt't strictly needed
+
+        //record changed folders only: database streams remain unchanged
+        journalLeft [itStreamLeftOld ->first] = sessionJournal;
+        journalRight[itStreamRightOld->first] = sessionJournal;
+
+        saveJournalTransactional(journalLeft,  journalPathLeft,  journalPathLeftTmp);  //throw FileError
+        saveJournalTransactional(journalRight, journalPathRight, journalPathRightTmp); //
+        return;
+    }
+
+    if (!lastSyncState)
+    {
+        lastSyncState = std::make_shared<InSyncFolder>(InSyncFolder::DIR_STATUS_IN_SYNC);
+        UpdateLastSynchronousState::execute(baseFolder, *lastSyncState, changedFolders); //nothrow: no database folders to decode
+    }
 
     //serialize again
     ByteArray updatedStreamLeft;
@@ -794,7 +1460,10 @@ void zen::saveLastSynchronousState(const BaseFolderPair& baseFolder, const std::
 
     //check if there is some work to do at all
     if (itStreamLeftOld  != streamsLeft .end() && updatedStreamLeft  == itStreamLeftOld ->second &&
-        itStreamRightOld != streamsRight.end() && updatedStreamRight == itStreamRightOld->second)
+        itStreamRightOld != streamsRight.end() && updatedStreamRight == itStreamRightOld->second &&
+        journalLeft .find(itStreamLeftOld ->first) == journalLeft .end() && //no deltas to discard
+        journalRight.find(itStreamRightOld->first) == journalRight.end() && //
+        !journalCorrupt)
         return; //some users monitor the *.ffs_db file with RTS => don't touch the file if it isnt't strictly needed
 
     //erase old session data
@@ -820,4 +1489,16 @@ void zen::saveLastSynchronousState(const BaseFolderPair& baseFolder, const std::
 
     AFS::removeFile(dbPathRight);                 //
     AFS::renameItem(dbPathRightTmp, dbPathRight); //
+
+    //discard deltas merged into the new stream and those of sessions no longer existing
+    auto purgeJournal = [](DbJournal& journal, const DbStreams& streams) -> bool
+    {
+        const size_t sessionCount = journal.size();
+        erase_if(journal, [&](const DbJournal::value_type& v) { return streams.find(v.first) == streams.end(); });
+        return journal.size() != sessionCount;
+    };
+    if (purgeJournal(journalLeft, streamsLeft) || journalCorrupt)
+        saveJournalTransactional(journalLeft, journalPathLeft, journalPathLeftTmp); //throw FileError
+    if (purgeJournal(journalRight, streamsRight) || journalCorrupt)
+        saveJournalTransactional(journalRight, journalPathRight, journalPathRightTmp); //
 }
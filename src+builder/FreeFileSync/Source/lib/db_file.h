@@ -36,11 +36,13 @@ struct InSyncDescrLink
 //artificial hierarchy of last synchronous state:
 struct InSyncFile
 {
-    InSyncFile(const InSyncDescrFile& l, const InSyncDescrFile& r, CompareVariant cv, std::uint64_t fileSizeIn) : left(l), right(r), cmpVar(cv), fileSize(fileSizeIn) {}
+    InSyncFile(const InSyncDescrFile& l, const InSyncDescrFile& r, CompareVariant cv, std::uint64_t fileSizeIn, const Opt<std::uint64_t>& contentHashIn) :
+        left(l), right(r), cmpVar(cv), fileSize(fileSizeIn), contentHash(contentHashIn) {}
     InSyncDescrFile left;
     InSyncDescrFile right;
     CompareVariant cmpVar; //the one active while finding "file in sync"
     std::uint64_t fileSize; //file size must be identical on both sides!
+    Opt<std::uint64_t> contentHash; //optional: XxHash64 of the file content (identical on both sides), if it was read while comparing or copying
 };
 
 struct InSyncSymlink
@@ -70,25 +72,42 @@ struct InSyncFolder
     typedef std::map<Zstring, InSyncSymlink, LessFilePath> SymlinkList; //
     //------------------------------------------------------------------
 
-    FolderList  folders;
-    FileList    files;
-    SymlinkList symlinks; //non-followed symlinks
+    //child items of a folder loaded from a database file are decoded on first access only
+    //=> folders not visited while determining sync directions are never decoded
+    const FolderList&  refSubFolders() const { decodeChildren(); return folders;  } //throw FileError
+    /**/  FolderList&  refSubFolders()       { decodeChildren(); return folders;  } //
+    const FileList&    refSubFiles  () const { decodeChildren(); return files;    } //
+    /**/  FileList&    refSubFiles  ()       { decodeChildren(); return files;    } //
+    const SymlinkList& refSubLinks  () const { decodeChildren(); return symlinks; } //
+    /**/  SymlinkList& refSubLinks  ()       { decodeChildren(); return symlinks; } //
 
     //convenience
     InSyncFolder& addFolder(const Zstring& shortName, InSyncStatus st)
     {
-        return folders.emplace(shortName, InSyncFolder(st)).first->second;
+        return refSubFolders().emplace(shortName, InSyncFolder(st)).first->second;
     }
 
-    void addFile(const Zstring& shortName, const InSyncDescrFile& dataL, const InSyncDescrFile& dataR, CompareVariant cmpVar, std::uint64_t fileSize)
+    void addFile(const Zstring& shortName, const InSyncDescrFile& dataL, const InSyncDescrFile& dataR, CompareVariant cmpVar, std::uint64_t fileSize, const Opt<std::uint64_t>& contentHash)
     {
-        files.emplace(shortName, InSyncFile(dataL, dataR, cmpVar, fileSize));
+        refSubFiles().emplace(shortName, InSyncFile(dataL, dataR, cmpVar, fileSize, contentHash));
     }
 
     void addSymlink(const Zstring& shortName, const InSyncDescrLink& dataL, const InSyncDescrLink& dataR, CompareVariant cmpVar)
     {
-        symlinks.emplace(shortName, InSyncSymlink(dataL, dataR, cmpVar));
+        refSubLinks().emplace(shortName, InSyncSymlink(dataL, dataR, cmpVar));
     }
+
+    struct PendingRecord; //position of the folder's record within the database streams: see db_file.cpp
+
+private:
+    void decodeChildren() const { if (pendingRecord) decodePendingRecord(); } //throw FileError
+    void decodePendingRecord() const; //
+
+    mutable FolderList  folders;
+    mutable FileList    files;
+    mutable SymlinkList symlinks; //non-followed symlinks
+
+    mutable std::shared_ptr<const PendingRecord> pendingRecord; //set while child items are not yet decoded
 };
 
 
@@ -37,6 +37,9 @@ FolderStatus getFolderStatusNonBlocking(const std::set<AbstractPath, AFS::LessAb
 
     std::list<std::pair<AbstractPath, std::future<bool>>> futureInfo;
 
+    AsyncCancellation cancellation;
+    ZEN_ON_SCOPE_EXIT(cancellation.cancel()); //skip checks not yet started after time out or exception
+
     for (const AbstractPath& folderPath : folderPaths)
         if (!AFS::isNullPath(folderPath)) //skip empty dirs
             futureInfo.emplace_back(folderPath, runAsync([folderPath, allowUserInteraction] //AbstractPath is thread-safe like an int! :)
@@ -46,7 +49,7 @@ FolderStatus getFolderStatusNonBlocking(const std::set<AbstractPath, AFS::LessAb
 
             //2. check dir existence
             return AFS::folderExistsThrowing(folderPath); //throw FileError
-        }));
+        }, &cancellation));
 
     //don't wait (almost) endlessly like Win32 would on non-existing network shares:
     std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now() + std::chrono::seconds(20); //consider CD-ROM insert or hard disk spin up time from sleep
@@ -6,6 +6,7 @@
 
 #include "hard_filter.h"
 #include <set>
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 #include <typeinfo>
@@ -209,21 +210,180 @@ bool matchesMaskBegin(const Zchar* str, const Zchar* mask)
 }
 
 
-template <class PathEndMatcher> inline
-bool matchesMask(const Zstring& name, const std::vector<Zstring>& masks)
-{
-    return std::any_of(masks.begin(), masks.end(), [&](const Zstring& mask) { return matchesMask<PathEndMatcher>(name.c_str(), mask.c_str()); });
-}
-
-
 inline
 bool matchesMaskBegin(const Zstring& name, const std::vector<Zstring>& masks)
 {
     return std::any_of(masks.begin(), masks.end(), [&](const Zstring& mask) { return matchesMaskBegin(name.c_str(), mask.c_str()); });
 }
+
+/*
+Compiled mask list: matching cost depends on path length rather than number of masks times path length
+    - "abc", "abc*":  trie of literal prefixes, walked from the beginning of the path
+    - "*abc":         trie of reversed literal suffixes, walked backwards from each possible match end: e.g. "*.tmp", "*\abc"
+    - anything else:  matched one by one
+*/
+class MaskIndex
+{
+public:
+    explicit MaskIndex(const std::vector<Zstring>& masks)
+    {
+        for (const Zstring& mask : masks)
+        {
+            auto isWildcard = [](Zchar c) { return c == Zstr('*') || c == Zstr('?'); };
+
+            const Zchar* const maskFirst = mask.c_str();
+            const Zchar* const maskLast  = maskFirst + mask.size();
+            const Zchar* litFirst = std::find_if(maskFirst, maskLast, [](Zchar c) { return c != Zstr('*'); });
+            const Zchar* litLast  = maskLast;
+            while (litLast != litFirst && litLast[-1] == Zstr('*'))
+                --litLast;
+
+            if (std::any_of(litFirst, litLast, isWildcard))
+                otherMasks.push_back(mask);
+            else if (litFirst == maskFirst) //"abc", "abc*"
+            {
+                TrieNode& node = prefixTrie[prefixTrie.insert(litFirst, litLast)];
+                (litLast == maskLast ? node.maskEnd : node.maskStar) = true;
+            }
+            else if (litLast == maskLast) //"*abc"; "*" matches like an empty suffix
+            {
+                std::vector<Zchar> suffixRev(litFirst, litLast);
+                std::reverse(suffixRev.begin(), suffixRev.end());
+                suffixTrie[suffixTrie.insert(suffixRev.begin(), suffixRev.end())].maskEnd = true;
+            }
+            else //"*abc*"
+                otherMasks.push_back(mask);
+        }
+    }
+
+    template <class PathEndMatcher>
+    bool matches(const Zstring& path) const
+    {
+        return matchesPrefix<PathEndMatcher>(path.c_str()) ||
+               matchesSuffix<PathEndMatcher>(path.c_str()) ||
+               std::any_of(otherMasks.begin(), otherMasks.end(), [&](const Zstring& mask) { return matchesMask<PathEndMatcher>(path.c_str(), mask.c_str()); });
+    }
+
+private:
+    struct TrieNode
+    {
+        std::vector<std::pair<Zchar, size_t>> children; //sorted by char
+        bool maskEnd  = false; //a mask ends here
+        bool maskStar = false; //a mask ends here with '*'
+    };
+
+    class Trie
+    {
+    public:
+        Trie() : nodes(1) {}
+
+        template <class Iterator>
+        size_t insert(Iterator first, Iterator last) //return node index
+        {
+            size_t nodeIdx = 0;
+            for (auto it = first; it != last; ++it)
+            {
+                auto& children = nodes[nodeIdx].children;
+                auto itChild = std::lower_bound(children.begin(), children.end(), *it, [](const std::pair<Zchar, size_t>& lhs, Zchar rhs) { return lhs.first < rhs; });
+                if (itChild != children.end() && itChild->first == *it)
+                    nodeIdx = itChild->second;
+                else
+                {
+                    children.emplace(itChild, *it, nodes.size()); //before nodes.emplace_back(): invalidates "children"
+                    nodeIdx = nodes.size();
+                    nodes.emplace_back();
+                }
+            }
+            return nodeIdx;
+        }
+
+        size_t getChild(size_t nodeIdx, Zchar c) const //return 0 if not existing: root is nobody's child
+        {
+            const auto& children = nodes[nodeIdx].children;
+            auto itChild = std::lower_bound(children.begin(), children.end(), c, [](const std::pair<Zchar, size_t>& lhs, Zchar rhs) { return lhs.first < rhs; });
+            return itChild != children.end() && itChild->first == c ? itChild->second : 0;
+        }
+
+        bool empty() const { return nodes.size() == 1 && !nodes[0].maskEnd && !nodes[0].maskStar; }
+
+        const TrieNode& operator[](size_t nodeIdx) const { return nodes[nodeIdx]; }
+        /**/  TrieNode& operator[](size_t nodeIdx)       { return nodes[nodeIdx]; }
+
+    private:
+        std::vector<TrieNode> nodes; //root at index 0
+    };
+
+    template <class PathEndMatcher>
+    bool matchesPrefix(const Zchar* path) const
+    {
+        if (prefixTrie.empty())
+            return false;
+
+        for (size_t nodeIdx = 0;; ++path)
+        {
+            const TrieNode& node = prefixTrie[nodeIdx];
+            if ((node.maskEnd  && PathEndMatcher::matchesMaskEnd (path)) ||
+                (node.maskStar && PathEndMatcher::matchesMaskStar(path)))
+                return true;
+
+            if (*path == 0)
+                return false;
+            nodeIdx = prefixTrie.getChild(nodeIdx, *path);
+            if (nodeIdx == 0)
+                return false;
+        }
+    }
+
+    template <class PathEndMatcher>
+    bool matchesSuffix(const Zchar* path) const
+    {
+        if (suffixTrie.empty())
+            return false;
+
+        for (const Zchar* matchEnd = path;; ++matchEnd)
+        {
+            if (PathEndMatcher::matchesMaskEnd(matchEnd))
+            {
+                //walk backwards: the leading '*' matches any string including an empty one
+                size_t nodeIdx = 0;
+                for (const Zchar* it = matchEnd;;)
+                {
+                    if (suffixTrie[nodeIdx].maskEnd)
+                        return true;
+                    if (it == path)
+                        break;
+                    nodeIdx = suffixTrie.getChild(nodeIdx, *--it);
+                    if (nodeIdx == 0)
+                        break;
+                }
+            }
+            if (*matchEnd == 0)
+                return false;
+        }
+    }
+
+    Trie prefixTrie;
+    Trie suffixTrie;
+    std::vector<Zstring> otherMasks;
+};
 }
 
 
+struct NameFilter::CompiledMasks
+{
+    explicit CompiledMasks(const NameFilter& filter) :
+        includeFileFolder(filter.includeMasksFileFolder),
+        includeFolder    (filter.includeMasksFolder),
+        excludeFileFolder(filter.excludeMasksFileFolder),
+        excludeFolder    (filter.excludeMasksFolder) {}
+
+    const MaskIndex includeFileFolder;
+    const MaskIndex includeFolder;
+    const MaskIndex excludeFileFolder;
+    const MaskIndex excludeFolder;
+};
+
+
 std::vector<Zstring> zen::splitByDelimiter(const Zstring& filterString)
 {
     //delimiters may be ';' or '\n'
@@ -254,6 +414,8 @@ NameFilter::NameFilter(const Zstring& includePhrase, const Zstring& excludePhras
     removeDuplicates(includeMasksFolder);
     removeDuplicates(excludeMasksFileFolder);
     removeDuplicates(excludeMasksFolder);
+
+    compiledMasks = std::make_shared<const CompiledMasks>(*this);
 }
 
 
@@ -263,6 +425,8 @@ void NameFilter::addExclusion(const Zstring& excludePhrase)
 
     removeDuplicates(excludeMasksFileFolder);
     removeDuplicates(excludeMasksFolder);
+
+    compiledMasks = std::make_shared<const CompiledMasks>(*this);
 }
 
 
@@ -274,12 +438,12 @@ bool NameFilter::passFileFilter(const Zstring& relFilePath) const
     const Zstring& pathFmt = relFilePath; //nothing to do here
 #endif
 
-    if (matchesMask<AnyMatch         >(pathFmt, excludeMasksFileFolder) || //either full match on file or partial match on any parent folder
-        matchesMask<ParentFolderMatch>(pathFmt, excludeMasksFolder))       //partial match on any parent folder only
+    if (compiledMasks->excludeFileFolder.matches<AnyMatch         >(pathFmt) || //either full match on file or partial match on any parent folder
+        compiledMasks->excludeFolder    .matches<ParentFolderMatch>(pathFmt))   //partial match on any parent folder only
         return false;
 
-    return matchesMask<AnyMatch         >(pathFmt, includeMasksFileFolder) ||
-           matchesMask<ParentFolderMatch>(pathFmt, includeMasksFolder);
+    return compiledMasks->includeFileFolder.matches<AnyMatch         >(pathFmt) ||
+           compiledMasks->includeFolder    .matches<ParentFolderMatch>(pathFmt);
 }
 
 
@@ -293,8 +457,8 @@ bool NameFilter::passDirFilter(const Zstring& relDirPath, bool* childItemMightMa
     const Zstring& pathFmt = relDirPath; //nothing to do here
 #endif
 
-    if (matchesMask<AnyMatch>(pathFmt, excludeMasksFileFolder) ||
-        matchesMask<AnyMatch>(pathFmt, excludeMasksFolder))
+    if (compiledMasks->excludeFileFolder.matches<AnyMatch>(pathFmt) ||
+        compiledMasks->excludeFolder    .matches<AnyMatch>(pathFmt))
     {
         if (childItemMightMatch)
             *childItemMightMatch = false; //perf: no need to traverse deeper; subfolders/subfiles would be excluded by filter anyway!
@@ -312,8 +476,8 @@ bool NameFilter::passDirFilter(const Zstring& relDirPath, bool* childItemMightMa
         return false;
     }
 
-    if (!matchesMask<AnyMatch>(pathFmt, includeMasksFileFolder) &&
-        !matchesMask<AnyMatch>(pathFmt, includeMasksFolder))
+    if (!compiledMasks->includeFileFolder.matches<AnyMatch>(pathFmt) &&
+        !compiledMasks->includeFolder    .matches<AnyMatch>(pathFmt))
     {
         if (childItemMightMatch)
         {
@@ -329,6 +493,48 @@ bool NameFilter::passDirFilter(const Zstring& relDirPath, bool* childItemMightMa
 }
 
 
+std::shared_ptr<const NameFilter> NameFilter::getSubFolderNameFilter(const Zstring& relDirPath) const
+{
+#if defined ZEN_WIN || defined ZEN_MAC //Windows does NOT distinguish between upper/lower-case
+    const Zstring& pathFmt = makeUpperCopy(relDirPath);
+#elif defined ZEN_LINUX //Linux DOES distinguish between upper/lower-case
+    const Zstring& pathFmt = relDirPath; //nothing to do here
+#endif
+    const Zstring& childPathBegin = pathFmt + FILE_NAME_SEPARATOR;
+
+    //a mask matching a child item must also match the beginning of its path: all other masks could only match the folder or one of its parents,
+    //but then the folder would have been included (nothing to check below) or excluded (not traversed)
+    auto getLiveMasks = [&](const std::vector<Zstring>& masks)
+    {
+        std::vector<Zstring> liveMasks;
+        std::copy_if(masks.begin(), masks.end(), std::back_inserter(liveMasks), [&](const Zstring& mask) { return matchesMaskBegin(childPathBegin.c_str(), mask.c_str()); });
+        return liveMasks;
+    };
+
+    auto subFilter = std::make_shared<NameFilter>(Zstring(), Zstring());
+
+    if (compiledMasks->includeFileFolder.matches<AnyMatch>(pathFmt) ||
+        compiledMasks->includeFolder    .matches<AnyMatch>(pathFmt))
+        subFilter->includeMasksFileFolder.push_back(asterisk); //all child items pass the include filter
+    else
+    {
+        subFilter->includeMasksFileFolder = getLiveMasks(includeMasksFileFolder);
+        subFilter->includeMasksFolder     = getLiveMasks(includeMasksFolder);
+    }
+    subFilter->excludeMasksFileFolder = getLiveMasks(excludeMasksFileFolder);
+    subFilter->excludeMasksFolder     = getLiveMasks(excludeMasksFolder);
+
+    if (subFilter->includeMasksFileFolder         == includeMasksFileFolder &&
+        subFilter->includeMasksFolder.size()     == includeMasksFolder.size() && //live masks are a subset
+        subFilter->excludeMasksFileFolder.size() == excludeMasksFileFolder.size() &&
+        subFilter->excludeMasksFolder.size()     == excludeMasksFolder.size())
+        return nullptr;
+
+    subFilter->compiledMasks = std::make_shared<const CompiledMasks>(*subFilter);
+    return subFilter;
+}
+
+
 bool NameFilter::isNull(const Zstring& includePhrase, const Zstring& excludePhrase)
 {
     const Zstring include = trimCpy(includePhrase);
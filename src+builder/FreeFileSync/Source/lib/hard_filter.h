@@ -45,6 +45,10 @@ public:
 
     virtual FilterRef copyFilterAddingExclusion(const Zstring& excludePhrase) const = 0;
 
+    //equivalent filter for all items below a folder, considering only the masks that can still match there: nullptr if not more specific than this one
+    //precondition: passDirFilter() returned true or set childItemMightMatch
+    virtual FilterRef getSubFolderFilter(const Zstring& relDirPath) const = 0;
+
 private:
     friend bool operator<(const HardFilter& lhs, const HardFilter& rhs);
 
@@ -67,6 +71,7 @@ public:
     bool passDirFilter(const Zstring& relDirPath, bool* childItemMightMatch) const override;
     bool isNull() const override { return true; }
     FilterRef copyFilterAddingExclusion(const Zstring& excludePhrase) const override;
+    FilterRef getSubFolderFilter(const Zstring& relDirPath) const override { return nullptr; }
 
 private:
     bool cmpLessSameType(const HardFilter& other) const override;
@@ -86,6 +91,9 @@ public:
     bool isNull() const override;
     static bool isNull(const Zstring& includePhrase, const Zstring& excludePhrase); //*fast* check without expensive NameFilter construction!
     FilterRef copyFilterAddingExclusion(const Zstring& excludePhrase) const override;
+    FilterRef getSubFolderFilter(const Zstring& relDirPath) const override;
+
+    std::shared_ptr<const NameFilter> getSubFolderNameFilter(const Zstring& relDirPath) const; //nullptr if unchanged
 
 private:
     bool cmpLessSameType(const HardFilter& other) const override;
@@ -94,6 +102,9 @@ private:
     std::vector<Zstring> includeMasksFolder;     //upper case (windows) + unique items by construction
     std::vector<Zstring> excludeMasksFileFolder; //
     std::vector<Zstring> excludeMasksFolder;     //
+
+    struct CompiledMasks; //the masks above indexed for fast matching: immutable and shared among copies
+    std::shared_ptr<const CompiledMasks> compiledMasks; //always bound
 };
 
 
@@ -106,6 +117,7 @@ public:
     bool passDirFilter(const Zstring& relDirPath, bool* childItemMightMatch) const override;
     bool isNull() const override;
     FilterRef copyFilterAddingExclusion(const Zstring& excludePhrase) const override;
+    FilterRef getSubFolderFilter(const Zstring& relDirPath) const override;
 
 private:
     bool cmpLessSameType(const HardFilter& other) const override;
@@ -194,6 +206,40 @@ HardFilter::FilterRef CombinedFilter::copyFilterAddingExclusion(const Zstring& e
 }
 
 
+inline
+HardFilter::FilterRef NameFilter::getSubFolderFilter(const Zstring& relDirPath) const
+{
+    std::shared_ptr<const NameFilter> subFilter = getSubFolderNameFilter(relDirPath);
+    if (subFilter && subFilter->isNull()) //e.g. folder is included and no exclusion applies below
+        return std::make_shared<NullFilter>();
+    return subFilter;
+}
+
+
+inline
+HardFilter::FilterRef CombinedFilter::getSubFolderFilter(const Zstring& relDirPath) const
+{
+    std::shared_ptr<const NameFilter> subFirst  = first_ .getSubFolderNameFilter(relDirPath);
+    std::shared_ptr<const NameFilter> subSecond = second_.getSubFolderNameFilter(relDirPath);
+    if (!subFirst && !subSecond)
+        return nullptr;
+
+    const NameFilter& first  = subFirst  ? *subFirst  : first_;
+    const NameFilter& second = subSecond ? *subSecond : second_;
+
+    if (first.isNull())
+    {
+        if (second.isNull())
+            return std::make_shared<NullFilter>();
+        return std::make_shared<NameFilter>(second);
+    }
+    if (second.isNull())
+        return std::make_shared<NameFilter>(first);
+
+    return std::make_shared<CombinedFilter>(first, second);
+}
+
+
 inline
 bool CombinedFilter::cmpLessSameType(const HardFilter& other) const
 {
@@ -10,8 +10,11 @@
 #include <zen/scope_guard.h>
 #include <zen/fixed_list.h>
 #include <zen/tick_count.h>
+#include <zen/optional.h>
+#include <deque>
 #include "db_file.h"
 #include "lock_holder.h"
+#include "scan_index.h"
 
 using namespace zen;
 
@@ -269,6 +272,126 @@ private:
 
 //-------------------------------------------------------------------------------------------------
 
+/*
+Work-stealing traversal of a single base folder:
+    - every sub folder reported by DirCallback::onDir() becomes a task, traversed non-recursively by a single worker
+    - each task writes into its own FolderContainer fragment allocated from the worker's own arena => no locking needed while traversing
+    - workers take their own newest tasks first (depth-first, like the recursive traverser) and steal the oldest tasks of other workers when idle
+    - fragments are stitched into the placeholders created by the parent task after all workers have finished
+*/
+struct FolderScanTask
+{
+    FolderScanTask(const Zstring& relPath, const HardFilter::FilterRef& filter, FolderContainer& target, int level, const Opt<std::int64_t>& folderWriteTime) :
+        relPath_(relPath), filter_(filter), target_(target), level_(level), folderWriteTime_(folderWriteTime) {}
+
+    const Zstring relPath_; //empty for base folder
+    const HardFilter::FilterRef filter_; //for the items of this folder, see HardFilter::getSubFolderFilter()
+    FolderContainer& target_; //placeholder inside the parent task's fragment: do not access before stitching!
+    const int level_;
+    const Opt<std::int64_t> folderWriteTime_; //scan index: modification time of the folder before it is read; unknown if not available
+
+    std::unique_ptr<FolderContainer> fragment; //created by the worker running the task
+    std::map<Zstring, std::wstring, LessFilePath> failedFolderReads;
+    std::map<Zstring, std::wstring, LessFilePath> failedItemReads;
+};
+
+
+class FolderTaskQueue
+{
+public:
+    FolderTaskQueue(size_t workerCount) : workerTasks(workerCount) {}
+
+    //context of worker thread:
+    void addTask(size_t workerIdx, const Zstring& relPath, const HardFilter::FilterRef& filter, FolderContainer& target, int level, const Opt<std::int64_t>& folderWriteTime)
+    {
+        {
+            std::lock_guard<std::mutex> dummy(lockTasks);
+            //traverser "retry" reports the same sub folder again => already scheduled
+            if (!scheduledTargets.insert(&target).second)
+                return;
+
+            tasks.emplace_back(relPath, filter, target, level, folderWriteTime);
+            workerTasks[workerIdx].push_back(&tasks.back());
+            ++tasksPending;
+        }
+        conditionTaskChanged.notify_all(); //instead of notify_one(); workaround bug: https://svn.boost.org/trac/boost/ticket/7796
+    }
+
+    //context of worker thread: blocks until a task is available; nullptr if all tasks have been processed
+    FolderScanTask* getNextTask(size_t workerIdx) //throw ThreadInterruption
+    {
+        std::unique_lock<std::mutex> dummy(lockTasks);
+        interruptibleWait(conditionTaskChanged, dummy, [&] { return tasksPending == 0 || haveQueuedTasks(); }); //throw ThreadInterruption
+
+        std::deque<FolderScanTask*>& ownTasks = workerTasks[workerIdx];
+        if (!ownTasks.empty())
+        {
+            FolderScanTask* task = ownTasks.back();
+            ownTasks.pop_back();
+            return task;
+        }
+
+        for (size_t i = 1; i < workerTasks.size(); ++i)
+        {
+            std::deque<FolderScanTask*>& otherTasks = workerTasks[(workerIdx + i) % workerTasks.size()];
+            if (!otherTasks.empty())
+            {
+                FolderScanTask* task = otherTasks.front(); //steal the oldest task: most likely the biggest sub tree
+                otherTasks.pop_front();
+                return task;
+            }
+        }
+        assert(tasksPending == 0);
+        return nullptr;
+    }
+
+    //context of worker thread:
+    void reportTaskDone()
+    {
+        {
+            std::lock_guard<std::mutex> dummy(lockTasks);
+            assert(tasksPending > 0);
+            --tasksPending;
+        }
+        conditionTaskChanged.notify_all();
+    }
+
+    //context of main worker thread after all other workers have finished!
+    void stitchResults(DirectoryValue& output)
+    {
+        for (FolderScanTask& task : tasks)
+        {
+            assert(task.fragment);
+            //swapping maps keeps all nodes valid => placeholders of child tasks may be stitched in any order
+            //all arenas are owned by "output" => nodes may be mixed freely
+            task.target_.folders .swap(task.fragment->folders);
+            task.target_.files   .swap(task.fragment->files);
+            task.target_.symlinks.swap(task.fragment->symlinks);
+
+            append(output.failedFolderReads, task.failedFolderReads);
+            append(output.failedItemReads,   task.failedItemReads);
+        }
+        tasks.clear();
+        scheduledTargets.clear();
+    }
+
+private:
+    bool haveQueuedTasks() const //call while locked!
+    {
+        return std::any_of(workerTasks.begin(), workerTasks.end(), [](const std::deque<FolderScanTask*>& wt) { return !wt.empty(); });
+    }
+
+    std::mutex lockTasks;
+    std::condition_variable conditionTaskChanged;
+
+    FixedList<FolderScanTask> tasks; //all tasks of this traversal: FixedList does not invalidate references after emplace_back()
+    std::vector<std::deque<FolderScanTask*>> workerTasks; //one queue per worker
+    std::set<const FolderContainer*> scheduledTargets;
+    size_t tasksPending = 0; //queued or currently being traversed
+};
+
+//-------------------------------------------------------------------------------------------------
+
 struct TraverserConfig
 {
 public:
@@ -297,6 +420,12 @@ public:
     AsyncCallback& acb_;
     const int threadID_;
     TickVal lastReportTime;
+
+    FolderTaskQueue* taskQueue_ = nullptr; //optional: schedule sub folders for traversal by any idle worker instead of recursing
+    size_t workerIdx_ = 0;                 //
+
+    ScanIndexFolder* listing_ = nullptr; //optional: record unfiltered items of a single folder for the scan index (requires "taskQueue_")
+    bool listingComplete_ = true;        //"false" if some items could not be recorded
 };
 
 
@@ -305,10 +434,12 @@ class DirCallback : public AFS::TraverserCallback
 public:
     DirCallback(TraverserConfig& config,
                 const Zstring& parentRelPathPf, //postfixed with FILE_NAME_SEPARATOR!
+                const HardFilter::FilterRef& filter, //for the items of this folder: narrowed down while descending
                 FolderContainer& output,
                 int level) :
         cfg(config),
         parentRelPathPf_(parentRelPathPf),
+        filter_(filter),
         output_(output),
         level_(level) {}
 
@@ -322,6 +453,7 @@ public:
 private:
     TraverserConfig& cfg;
     const Zstring parentRelPathPf_;
+    const HardFilter::FilterRef filter_; //always bound!
     FolderContainer& output_;
     const int level_;
 };
@@ -338,13 +470,17 @@ void DirCallback::onFile(const FileInfo& fi) //throw ThreadInterruption
 
     const Zstring fileRelPath = parentRelPathPf_ + fi.itemName;
 
+    if (cfg.listing_) //record before filtering: scan index does not depend on filter settings
+        cfg.listing_->files.emplace(fi.itemName, ScanIndexFolder::File(fi.lastWriteTime, fi.fileSize, fi.id,
+                                                                       fi.symlinkInfo != nullptr, fi.symlinkInfo ? fi.symlinkInfo->lastWriteTime : 0));
+
     //update status information no matter whether item is excluded or not!
     if (cfg.acb_.mayReportCurrentFile(cfg.threadID_, cfg.lastReportTime))
         cfg.acb_.reportCurrentFile(AFS::getDisplayPath(AFS::appendRelPath(cfg.baseFolderPath_, fileRelPath)));
 
     //------------------------------------------------------------------------------------
     //apply filter before processing (use relative name!)
-    if (!cfg.filter_->passFileFilter(fileRelPath))
+    if (!filter_->passFileFilter(fileRelPath))
         return;
 
     //    std::string fileId = details.fileSize >=  1024 * 1024U ? util::retrieveFileID(filepath) : std::string();
@@ -370,6 +506,9 @@ std::unique_ptr<AFS::TraverserCallback> DirCallback::onDir(const DirInfo& di) //
 
     const Zstring& folderRelPath = parentRelPathPf_ + di.itemName;
 
+    if (cfg.listing_) //record before filtering: scan index does not depend on filter settings
+        cfg.listing_->folders.insert(di.itemName);
+
     //update status information no matter whether item is excluded or not!
     if (cfg.acb_.mayReportCurrentFile(cfg.threadID_, cfg.lastReportTime))
         cfg.acb_.reportCurrentFile(AFS::getDisplayPath(AFS::appendRelPath(cfg.baseFolderPath_, folderRelPath)));
@@ -377,7 +516,7 @@ std::unique_ptr<AFS::TraverserCallback> DirCallback::onDir(const DirInfo& di) //
     //------------------------------------------------------------------------------------
     //apply filter before processing (use relative name!)
     bool childItemMightMatch = true;
-    const bool passFilter = cfg.filter_->passDirFilter(folderRelPath, &childItemMightMatch);
+    const bool passFilter = filter_->passDirFilter(folderRelPath, &childItemMightMatch);
     if (!passFilter && !childItemMightMatch)
         return nullptr; //do NOT traverse subdirs
     //else: attention! ensure directory filtering is applied later to exclude actually filtered directories
@@ -394,7 +533,18 @@ std::unique_ptr<AFS::TraverserCallback> DirCallback::onDir(const DirInfo& di) //
         }, *this, di.itemName))
     return nullptr;
 
-    return std::make_unique<DirCallback>(cfg, folderRelPath + FILE_NAME_SEPARATOR, subFolder, level_ + 1); //releaseDirTraverser() is guaranteed to be called in any case
+    //only evaluate the masks that can still match below this folder
+    HardFilter::FilterRef subFilter = filter_->getSubFolderFilter(folderRelPath);
+    if (!subFilter)
+        subFilter = filter_;
+
+    if (cfg.taskQueue_) //work-stealing traversal: "subFolder" is only a placeholder until FolderTaskQueue::stitchResults()
+    {
+        cfg.taskQueue_->addTask(cfg.workerIdx_, folderRelPath, subFilter, subFolder, level_ + 1, di.lastWriteTime);
+        return nullptr;
+    }
+
+    return std::make_unique<DirCallback>(cfg, folderRelPath + FILE_NAME_SEPARATOR, subFilter, subFolder, level_ + 1); //releaseDirTraverser() is guaranteed to be called in any case
 }
 
 
@@ -414,7 +564,10 @@ DirCallback::HandleLink DirCallback::onSymlink(const SymlinkInfo& si) //throw Th
             return LINK_SKIP;
 
         case SYMLINK_DIRECT:
-            if (cfg.filter_->passFileFilter(linkRelPath)) //always use file filter: Link type may not be "stable" on Linux!
+            if (cfg.listing_) //record before filtering: scan index does not depend on filter settings
+                cfg.listing_->symlinks.emplace(si.itemName, si.lastWriteTime);
+
+            if (filter_->passFileFilter(linkRelPath)) //always use file filter: Link type may not be "stable" on Linux!
             {
                 output_.addSubLink(si.itemName, LinkDescriptor(si.lastWriteTime));
                 cfg.acb_.incItemsScanned(); //add 1 element to the progress indicator
@@ -424,12 +577,15 @@ DirCallback::HandleLink DirCallback::onSymlink(const SymlinkInfo& si) //throw Th
         case SYMLINK_FOLLOW:
             //filter symlinks before trying to follow them: handle user-excluded broken symlinks!
             //since we don't know yet what type the symlink will resolve to, only do this when both variants agree:
-            if (!cfg.filter_->passFileFilter(linkRelPath))
+            if (!filter_->passFileFilter(linkRelPath))
             {
                 bool childItemMightMatch = true;
-                if (!cfg.filter_->passDirFilter(linkRelPath, &childItemMightMatch))
+                if (!filter_->passDirFilter(linkRelPath, &childItemMightMatch))
                     if (!childItemMightMatch)
+                    {
+                        cfg.listingComplete_ = false; //link target remains unknown => listing is useless for a different filter
                         return LINK_SKIP;
+                    }
             }
             return LINK_FOLLOW;
     }
@@ -472,6 +628,29 @@ DirCallback::HandleError DirCallback::reportItemError(const std::wstring& msg, s
 
 //------------------------------------------------------------------------------------------
 
+//relative paths of items reported as changed; "no value" if the change list does not cover all changes within the base folder
+Opt<std::set<Zstring, LessFilePath>> getChangedItems(const ChangeList& changes, const AbstractPath& baseFolderPath, SymLinkHandling handleSymlinks)
+{
+    const Opt<Zstring> baseFolderPathNative = AFS::getNativeItemPath(baseFolderPath);
+    if (!baseFolderPathNative || handleSymlinks == SYMLINK_FOLLOW) //followed symlinks may point outside of the watched folders
+        return NoValue();
+
+    const Zstring basePathPf = appendSeparator(*baseFolderPathNative);
+
+    if (std::none_of(changes.watchedFolderPaths.begin(), changes.watchedFolderPaths.end(),
+    [&](const Zstring& watchedPath) { return pathStartsWith(basePathPf, appendSeparator(watchedPath)); }))
+        return NoValue();
+
+    std::set<Zstring, LessFilePath> changedItems;
+    for (const Zstring& itemPath : changes.changedItemPaths)
+        if (pathStartsWith(basePathPf, appendSeparator(itemPath))) //base folder (or one of its parents) was replaced
+            return NoValue();
+        else if (pathStartsWith(itemPath, basePathPf))
+            changedItems.emplace(itemPath.begin() + basePathPf.size(), itemPath.end());
+    return changedItems;
+}
+
+
 class WorkerThread
 {
 public:
@@ -480,9 +659,17 @@ public:
                  const AbstractPath& baseFolderPath,   //always bound!
                  const HardFilter::FilterRef& filter, //
                  SymLinkHandling handleSymlinks,
+                 size_t threadsPerFolder,
+                 size_t statQueueDepth,
+                 bool useScanIndex,
+                 const ChangeList* changeList,
                  DirectoryValue& dirOutput) :
         acb_(acb),
-        outputContainer(dirOutput.folderCont),
+        dirOutput_(dirOutput),
+        threadsPerFolder_(threadsPerFolder),
+        statQueueDepth_(statQueueDepth),
+        useScanIndex_(useScanIndex),
+        changeList_(changeList),
         travCfg(threadID,
                 baseFolderPath,
                 filter,
@@ -503,14 +690,191 @@ public:
         if (acb_->mayReportCurrentFile(travCfg.threadID_, travCfg.lastReportTime))
             acb_->reportCurrentFile(AFS::getDisplayPath(travCfg.baseFolderPath_)); //just in case first directory access is blocking
 
-        DirCallback cb(travCfg, Zstring(), outputContainer, 0);
+        if (threadsPerFolder_ > 1 || useScanIndex_) //scan index needs one task per folder
+            return traverseWorkStealing(); //throw ThreadInterruption
 
-        AFS::traverseFolder(travCfg.baseFolderPath_, cb); //throw X
+        DirCallback cb(travCfg, Zstring(), travCfg.filter_, dirOutput_.folderCont, 0);
+
+        AFS::traverseFolder(travCfg.baseFolderPath_, cb, statQueueDepth_); //throw X
     }
 
 private:
+    void traverseWorkStealing() //throw ThreadInterruption
+    {
+        bool traversalComplete = false;
+        if (useScanIndex_)
+        {
+            scanIndex_ = std::make_unique<ScanIndex>(travCfg.baseFolderPath_, travCfg.handleSymlinks_);
+
+            if (changeList_)
+                if (Opt<std::set<Zstring, LessFilePath>> changedItems = getChangedItems(*changeList_, travCfg.baseFolderPath_, travCfg.handleSymlinks_))
+                    scanIndex_->setChangedItems(changeList_->monitoringStartTime, std::move(*changedItems));
+        }
+
+        ZEN_ON_SCOPE_EXIT( //runs after helpers are joined; also if interrupted => next traversal resumes
+            if (scanIndex_)
+            try
+            {
+                scanIndex_->save(traversalComplete); //throw FileError
+            }
+            catch (FileError&) {} //the index is only an optimization
+            );
+
+        Opt<std::int64_t> baseFolderWriteTime;
+        if (scanIndex_)
+        {
+            baseFolderWriteTime = scanIndex_->getTrustedFolderWriteTime(Zstring());
+            if (!baseFolderWriteTime)
+                try
+                {
+                    baseFolderWriteTime = AFS::getModTime(travCfg.baseFolderPath_); //throw FileError
+                }
+                catch (FileError&) {} //let the traverser report the error
+        }
+
+        std::vector<Arena*> workerArenas; //Arena is not thread-safe
+        for (size_t workerIdx = 0; workerIdx < threadsPerFolder_; ++workerIdx)
+        {
+            dirOutput_.workerArenas.emplace_back();
+            workerArenas.push_back(&dirOutput_.workerArenas.back());
+        }
+
+        FolderTaskQueue taskQueue(threadsPerFolder_);
+        taskQueue.addTask(0, Zstring(), travCfg.filter_, dirOutput_.folderCont, 0, baseFolderWriteTime);
+
+        std::vector<InterruptibleThread> helpers;
+        helpers.reserve(threadsPerFolder_);
+
+        ZEN_ON_SCOPE_EXIT( //not only on failure: helpers are not joinable anymore after success
+            for (InterruptibleThread& ht : helpers)
+            if (ht.joinable())
+                ht.interrupt(); //interrupt all at once first, then join
+            for (InterruptibleThread& ht : helpers)
+                if (ht.joinable())
+                    ht.join();
+                );
+
+        //this thread is worker 0; helpers report status with the same thread ID
+        for (size_t workerIdx = 1; workerIdx < threadsPerFolder_; ++workerIdx)
+            helpers.emplace_back([this, &taskQueue, workerIdx, &workerArenas]
+        {
+#ifdef ZEN_WIN
+            setCurrentThreadName("Folder Traverser");
+#endif
+            acb_->incActiveWorker();
+            ZEN_ON_SCOPE_EXIT(acb_->decActiveWorker());
+
+            runTaskLoop(taskQueue, workerIdx, *workerArenas[workerIdx]); //throw ThreadInterruption
+        });
+
+        runTaskLoop(taskQueue, 0, *workerArenas[0]); //throw ThreadInterruption
+
+        for (InterruptibleThread& ht : helpers)
+            ht.join();
+
+        taskQueue.stitchResults(dirOutput_);
+        traversalComplete = true;
+    }
+
+    //context of worker thread:
+    void runTaskLoop(FolderTaskQueue& taskQueue, size_t workerIdx, Arena& arena) //throw ThreadInterruption
+    {
+        TickVal lastReportTime; //one per worker, not per task: avoid needless status updates
+
+        while (FolderScanTask* task = taskQueue.getNextTask(workerIdx)) //throw ThreadInterruption
+        {
+            task->fragment = std::make_unique<FolderContainer>(arena);
+
+            TraverserConfig taskCfg(travCfg.threadID_,
+                                    travCfg.baseFolderPath_,
+                                    travCfg.filter_,
+                                    travCfg.handleSymlinks_,
+                                    task->failedFolderReads,
+                                    task->failedItemReads,
+                                    travCfg.acb_);
+            taskCfg.lastReportTime = lastReportTime;
+            taskCfg.taskQueue_ = &taskQueue;
+            taskCfg.workerIdx_ = workerIdx;
+
+            DirCallback cb(taskCfg, task->relPath_.empty() ? Zstring() : task->relPath_ + FILE_NAME_SEPARATOR, task->filter_, *task->fragment, task->level_);
+
+            if (!scanIndex_)
+                AFS::traverseFolder(AFS::appendRelPath(travCfg.baseFolderPath_, task->relPath_), cb, statQueueDepth_); //throw X
+            else
+            {
+                ScanIndexFolder listing;
+                if (!task->folderWriteTime_ ||
+                    !scanIndex_->takeUnchangedFolder(task->relPath_, *task->folderWriteTime_, listing) ||
+                    !replayListing(listing, task->relPath_, cb)) //throw ThreadInterruption
+                {
+                    listing = ScanIndexFolder();
+                    taskCfg.listing_ = &listing;
+                    AFS::traverseFolder(AFS::appendRelPath(travCfg.baseFolderPath_, task->relPath_), cb, statQueueDepth_); //throw X
+                }
+
+                if (task->folderWriteTime_ && taskCfg.listingComplete_ && task->failedFolderReads.empty() && task->failedItemReads.empty())
+                {
+                    listing.folderWriteTime = *task->folderWriteTime_;
+                    scanIndex_->addFolder(task->relPath_, std::move(listing));
+                }
+            }
+
+            lastReportTime = taskCfg.lastReportTime;
+            taskQueue.reportTaskDone();
+        }
+    }
+
+    //context of worker thread: report items of an unchanged folder as if it had been traversed
+    bool replayListing(const ScanIndexFolder& listing, const Zstring& relPath, DirCallback& cb) //throw ThreadInterruption
+    {
+        //not covered by a change list: the folder's modification time does not change if a file is modified in place
+        if (!scanIndex_->getTrustedFolderWriteTime(relPath))
+            for (const auto& item : listing.files)
+                try
+                {
+                    const Zstring fileRelPath = relPath.empty() ? item.first : relPath + FILE_NAME_SEPARATOR + item.first;
+                    if (AFS::getModTime(AFS::appendRelPath(travCfg.baseFolderPath_, fileRelPath)) != item.second.lastWriteTime) //throw FileError; follows symlinks
+                        return false;
+                }
+                catch (FileError&) { return false; } //let the traverser report the error
+
+        //sub folders need to be checked by their own tasks, which requires their *current* modification times
+        std::vector<std::pair<Zstring, std::int64_t>> subFolders;
+        for (const Zstring& itemName : listing.folders)
+        {
+            const Zstring subRelPath = relPath.empty() ? itemName : relPath + FILE_NAME_SEPARATOR + itemName;
+
+            if (Opt<std::int64_t> trustedWriteTime = scanIndex_->getTrustedFolderWriteTime(subRelPath)) //no need to access the folder at all
+                subFolders.emplace_back(itemName, *trustedWriteTime);
+            else
+                try
+                {
+                    subFolders.emplace_back(itemName, AFS::getModTime(AFS::appendRelPath(travCfg.baseFolderPath_, subRelPath))); //throw FileError
+                }
+                catch (FileError&) { return false; } //let the traverser report the error
+        }
+
+        for (const auto& item : listing.files)
+        {
+            const AFS::TraverserCallback::SymlinkInfo linkInfo = { item.first, item.second.symlinkWriteTime };
+            cb.onFile({ item.first, item.second.fileSize, item.second.lastWriteTime, item.second.id, item.second.isFollowedSymlink ? &linkInfo : nullptr }); //throw ThreadInterruption
+        }
+
+        for (const auto& item : listing.symlinks)
+            cb.onSymlink({ item.first, item.second }); //throw ThreadInterruption
+
+        for (const auto& item : subFolders)
+            cb.onDir({ item.first, item.second }); //throw ThreadInterruption; schedules a task (or reports an error)
+        return true;
+    }
+
     std::shared_ptr<AsyncCallback> acb_;
-    FolderContainer& outputContainer;
+    DirectoryValue& dirOutput_;
+    const size_t threadsPerFolder_;
+    const size_t statQueueDepth_;
+    const bool useScanIndex_;
+    const ChangeList* const changeList_; //optional
+    std::unique_ptr<ScanIndex> scanIndex_;
     TraverserConfig travCfg;
 };
 }
@@ -519,7 +883,11 @@ private:
 void zen::fillBuffer(const std::set<DirectoryKey>& keysToRead, //in
                      std::map<DirectoryKey, DirectoryValue>& buf, //out
                      FillBufferCallback& callback,
-                     size_t updateIntervalMs)
+                     size_t updateIntervalMs,
+                     size_t threadsPerFolder,
+                     const std::map<AbstractPath, size_t, AFS::LessAbstractPath>& statQueueDepths,
+                     bool useScanIndex,
+                     const ChangeList* changeList)
 {
     buf.clear();
 
@@ -542,11 +910,16 @@ void zen::fillBuffer(const std::set<DirectoryKey>& keysToRead, //in
         DirectoryValue& dirOutput = buf[key];
 
         const int threadId = static_cast<int>(worker.size());
+        auto itDepth = statQueueDepths.find(key.folderPath_);
         worker.emplace_back(WorkerThread(threadId,
                                          acb,
                                          key.folderPath_, //AbstractPath is thread-safe like an int! :)
                                          key.filter_,
                                          key.handleSymlinks_,
+                                         std::max<size_t>(threadsPerFolder, 1),
+                                         itDepth != statQueueDepths.end() ? itDepth->second : 0,
+                                         useScanIndex,
+                                         changeList,
                                          dirOutput));
     }
 
@@ -10,6 +10,7 @@
 #include <map>
 #include <set>
 #include "hard_filter.h"
+#include "change_list.h"
 #include "../structures.h"
 #include "../file_hierarchy.h"
 
@@ -48,6 +49,11 @@ bool operator<(const DirectoryKey& lhs, const DirectoryKey& rhs)
 
 struct DirectoryValue
 {
+    DirectoryValue() : folderCont(arena) {}
+
+    Arena arena;                   //nodes of "folderCont" are allocated from the arenas: declare first => destroy last
+    FixedList<Arena> workerArenas; //work-stealing traversal: one arena per worker thread
+
     FolderContainer folderCont;
     //relative names (or empty string for root) for directories that could not be read (completely), e.g. access denied, or temporal network drop
     std::map<Zstring, std::wstring, LessFilePath> failedFolderReads; //with corresponding error message
@@ -72,10 +78,18 @@ struct FillBufferCallback
 
 //attention: ensure directory filtering is applied later to exclude filtered directories which have been kept as parent folders
 
+//threadsPerFolder > 1: sub folders found while traversing a base folder are scheduled as tasks for a pool of work-stealing threads
+//statQueueDepths: number of concurrent item attribute requests per directory by base folder, see AbstractFileSystem::traverseFolder(); missing: 0
+//useScanIndex: reuse items of folders not modified since the previous traversal, see scan_index.h
+//changeList: optional; scan index only needs to read folders containing changed items, see change_list.h
 void fillBuffer(const std::set<DirectoryKey>& keysToRead, //in
                 std::map<DirectoryKey, DirectoryValue>& buf, //out
                 FillBufferCallback& callback,
-                size_t updateIntervalMs); //unit: [ms]
+                size_t updateIntervalMs, //unit: [ms]
+                size_t threadsPerFolder,
+                const std::map<AbstractPath, size_t, AFS::LessAbstractPath>& statQueueDepths,
+                bool useScanIndex,
+                const ChangeList* changeList);
 }
 
 #endif //PARALLEL_SCAN_H_924588904275284572857
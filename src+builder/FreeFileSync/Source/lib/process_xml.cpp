@@ -897,6 +897,26 @@ void readConfig(const XmlIn& in, XmlGlobalSettings& config)
     inShared["VerifyCopiedFiles"        ].attribute("Enabled", config.verifyFileCopy);
     inShared["LastSyncsLogSizeMax"      ].attribute("Bytes"  , config.lastSyncsLogFileSizeMax);
 
+    //optional: not part of older configurations
+    if (XmlIn inTraverser = inShared["FolderTraverser"])
+        inTraverser.attribute("ThreadsPerFolder", config.traverserThreadsPerFolder);
+    if (XmlIn inStatQueue = inShared["TraverserStatQueue"])
+    {
+        inStatQueue.attribute("Depth", config.traverserStatQueueDepth);
+        inStatQueue["PerFolder"](config.traverserStatQueueDepthPerFolder);
+    }
+    if (XmlIn inScanIndex = inShared["ScanIndex"])
+        inScanIndex.attribute("Enabled", config.useScanIndex);
+    if (XmlIn inContentCmp = inShared["ContentComparison"])
+    {
+        inContentCmp.attribute("Threads",          config.contentCmpThreads);
+        inContentCmp.attribute("ThreadsPerDevice", config.contentCmpThreadsPerDevice);
+    }
+    if (XmlIn inContentSampling = inShared["ContentSampling"])
+        inContentSampling.attribute("Enabled", config.contentCmpSampling);
+    if (XmlIn inFileCopy = inShared["ParallelFileCopy"])
+        inFileCopy.attribute("Threads", config.fileCopyThreads);
+
     XmlIn inOpt = inShared["OptionalDialogs"];
     inOpt["WarnUnresolvedConflicts"    ].attribute("Enabled", config.optDialogs.warningUnresolvedConflicts);
     inOpt["WarnNotEnoughDiskSpace"     ].attribute("Enabled", config.optDialogs.warningNotEnoughDiskSpace);
@@ -1281,6 +1301,14 @@ void writeConfig(const XmlGlobalSettings& config, XmlOut& out)
     outShared["LockDirectoriesDuringSync"].attribute("Enabled", config.createLockFile);
     outShared["VerifyCopiedFiles"        ].attribute("Enabled", config.verifyFileCopy);
     outShared["LastSyncsLogSizeMax"      ].attribute("Bytes"  , config.lastSyncsLogFileSizeMax);
+    outShared["FolderTraverser"          ].attribute("ThreadsPerFolder", config.traverserThreadsPerFolder);
+    outShared["TraverserStatQueue"       ].attribute("Depth", config.traverserStatQueueDepth);
+    outShared["TraverserStatQueue"       ]["PerFolder"](config.traverserStatQueueDepthPerFolder);
+    outShared["ScanIndex"                ].attribute("Enabled", config.useScanIndex);
+    outShared["ContentComparison"        ].attribute("Threads",          config.contentCmpThreads);
+    outShared["ContentComparison"        ].attribute("ThreadsPerDevice", config.contentCmpThreadsPerDevice);
+    outShared["ContentSampling"          ].attribute("Enabled",          config.contentCmpSampling);
+    outShared["ParallelFileCopy"         ].attribute("Threads",          config.fileCopyThreads);
 
     XmlOut outOpt = outShared["OptionalDialogs"];
     outOpt["WarnUnresolvedConflicts"    ].attribute("Enabled", config.optDialogs.warningUnresolvedConflicts);
@@ -142,6 +142,14 @@ struct XmlGlobalSettings
     bool createLockFile = true;
     bool verifyFileCopy = false;
     size_t lastSyncsLogFileSizeMax = 100000; //maximum size for LastSyncs.log: use a human-readable number
+    size_t traverserThreadsPerFolder = 1; //> 1: work-stealing traversal of sub folders within each base folder (high-latency file systems)
+    size_t traverserStatQueueDepth = 0; //Linux: > 0: read item attributes of each directory in batches via io_uring (high-latency file systems)
+    std::vector<std::pair<Zstring, size_t>> traverserStatQueueDepthPerFolder; //folder path phrase, queue depth: overrides "traverserStatQueueDepth"
+    bool useScanIndex = false; //reuse items of folders not modified since last comparison: content changes of files without a parent folder change are missed!
+    size_t contentCmpThreads          = 1; //number of file pairs compared in parallel for "compare by content"
+    size_t contentCmpThreadsPerDevice = 1; //limit per base folder (approximating a physical device)
+    bool contentCmpSampling = false; //compare head, tail and a few stripes first: rejects most differing files early, but costs extra seeks for equal ones
+    size_t fileCopyThreads = 1; //number of files created/overwritten in parallel during synchronization
 
     OptionalDialogs optDialogs;
 
@@ -0,0 +1,304 @@
+// **************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under *
+// * GNU General Public License: http://www.gnu.org/licenses/gpl-3.0        *
+// * Copyright (C) Zenju (zenju AT gmx DOT de) - All Rights Reserved        *
+// **************************************************************************
+
+#include "scan_index.h"
+#include <ctime>
+#include <zen/file_access.h>
+#include <zen/serialize.h>
+#include <zen/stl_tools.h>
+#include <wx+/zlib_wrap.h>
+#include "ffs_paths.h"
+
+#ifdef ZEN_WIN
+    #include <zen/long_path_prefix.h>
+#elif defined ZEN_LINUX || defined ZEN_MAC
+    #include <cstdio> //rename
+#endif
+
+using namespace zen;
+
+
+namespace
+{
+//-------------------------------------------------------------------------------------------------------------------------------
+const char FILE_FORMAT_DESCR[] = "FreeFileSync Scan Index";
+const int INDEX_FORMAT_VER = 1;
+//-------------------------------------------------------------------------------------------------------------------------------
+
+const std::int64_t RACY_CLEAN_TOLERANCE = 2; //unit: [s]; respect 2 second FAT/FAT32 precision
+
+using MemStreamOut = MemoryStreamOut<ByteArray>;
+using MemStreamIn  = MemoryStreamIn <ByteArray>;
+
+//-----------------------------------------------------------------------------------
+//| ensure 32/64 bit portability: use fixed size data types only e.g. std::uint32_t |
+//-----------------------------------------------------------------------------------
+
+Zstring getIndexFilePath(const std::string& baseFolderPathUtf8, SymLinkHandling handleSymlinks)
+{
+    //one index per base folder and symlink handling: folder path is verified after loading => hash collisions are harmless
+    const std::string indexId = baseFolderPathUtf8 + '|' + numberTo<std::string>(static_cast<int>(handleSymlinks));
+    const size_t indexHash = hashBytes(reinterpret_cast<const unsigned char*>(indexId.c_str()), indexId.size());
+
+    return getConfigDir() + Zstr("ScanIndex") + FILE_NAME_SEPARATOR + numberTo<Zstring>(indexHash) + Zstr(".ffs_index");
+}
+
+
+//unlike zen::renameFile(): replace an existing target atomically => the old file is available until the new one takes its place
+void replaceFile(const Zstring& pathSource, const Zstring& pathTarget) //throw FileError
+{
+    const std::wstring errorMsg = replaceCpy(replaceCpy(_("Cannot move file %x to %y."), L"%x", L"\n" + fmtPath(pathSource)), L"%y", L"\n" + fmtPath(pathTarget));
+#ifdef ZEN_WIN
+    if (!::MoveFileEx(applyLongPathPrefix(pathSource).c_str(), //__in      LPCTSTR lpExistingFileName,
+                      applyLongPathPrefix(pathTarget).c_str(), //__in_opt  LPCTSTR lpNewFileName,
+                      MOVEFILE_REPLACE_EXISTING))              //__in      DWORD dwFlags
+        THROW_LAST_FILE_ERROR(errorMsg, L"MoveFileEx");
+
+#elif defined ZEN_LINUX || defined ZEN_MAC
+    if (::rename(pathSource.c_str(), pathTarget.c_str()) != 0) //always overwrites atomically
+        THROW_LAST_FILE_ERROR(errorMsg, L"rename");
+#endif
+}
+
+
+void writeUtf8(MemStreamOut& output, const Zstring& str) { writeContainer(output, utfCvrtTo<Zbase<char>>(str)); }
+
+Zstring readUtf8(MemStreamIn& input) { return utfCvrtTo<Zstring>(readContainer<Zbase<char>>(input)); } //throw UnexpectedEndOfStreamError
+
+
+void writeFolder(MemStreamOut& output, const ScanIndexFolder& folder)
+{
+    writeNumber<std::int64_t>(output, folder.folderWriteTime);
+
+    writeNumber<std::uint32_t>(output, static_cast<std::uint32_t>(folder.files.size()));
+    for (const auto& item : folder.files)
+    {
+        writeUtf8(output, item.first);
+        writeNumber<std:: int64_t>(output, item.second.lastWriteTime);
+        writeNumber<std::uint64_t>(output, item.second.fileSize);
+        writeContainer(output, item.second.id);
+        writeNumber<std::int8_t>(output, item.second.isFollowedSymlink);
+        if (item.second.isFollowedSymlink)
+            writeNumber<std::int64_t>(output, item.second.symlinkWriteTime);
+    }
+
+    writeNumber<std::uint32_t>(output, static_cast<std::uint32_t>(folder.symlinks.size()));
+    for (const auto& item : folder.symlinks)
+    {
+        writeUtf8(output, item.first);
+        writeNumber<std::int64_t>(output, item.second);
+    }
+
+    writeNumber<std::uint32_t>(output, static_cast<std::uint32_t>(folder.folders.size()));
+    for (const Zstring& itemName : folder.folders)
+        writeUtf8(output, itemName);
+}
+
+
+ScanIndexFolder readFolder(MemStreamIn& input) //throw UnexpectedEndOfStreamError
+{
+    ScanIndexFolder folder;
+    folder.folderWriteTime = readNumber<std::int64_t>(input);
+
+    //attention: order of function argument evaluation is undefined! So do it one after the other...
+    size_t fileCount = readNumber<std::uint32_t>(input);
+    while (fileCount-- != 0)
+    {
+        const Zstring itemName = readUtf8(input);
+        const auto lastWriteTime = readNumber<std:: int64_t>(input);
+        const auto fileSize      = readNumber<std::uint64_t>(input);
+        const auto fileId        = readContainer<AFS::FileId>(input);
+        const bool isFollowedSymlink = readNumber<std::int8_t>(input) != 0;
+        const std::int64_t symlinkWriteTime = isFollowedSymlink ? readNumber<std::int64_t>(input) : 0;
+
+        folder.files.emplace(itemName, ScanIndexFolder::File(lastWriteTime, fileSize, fileId, isFollowedSymlink, symlinkWriteTime));
+    }
+
+    size_t linkCount = readNumber<std::uint32_t>(input);
+    while (linkCount-- != 0)
+    {
+        const Zstring itemName = readUtf8(input);
+        folder.symlinks.emplace(itemName, readNumber<std::int64_t>(input));
+    }
+
+    size_t dirCount = readNumber<std::uint32_t>(input);
+    while (dirCount-- != 0)
+        folder.folders.insert(readUtf8(input));
+
+    return folder;
+}
+}
+
+
+ScanIndex::ScanIndex(const AbstractPath& baseFolderPath, SymLinkHandling handleSymlinks) :
+    baseFolderPathUtf8_(utfCvrtTo<std::string>(AFS::getInitPathPhrase(baseFolderPath))),
+    handleSymlinks_(handleSymlinks),
+    indexFilePath_(getIndexFilePath(baseFolderPathUtf8_, handleSymlinks)),
+    traversalStartTime_(std::time(nullptr))
+{
+    try
+    {
+        MemStreamIn streamIn = loadBinStream<ByteArray>(indexFilePath_, nullptr); //throw FileError
+
+        //read FreeFileSync file identifier
+        char formatDescr[sizeof(FILE_FORMAT_DESCR)] = {};
+        readArray(streamIn, formatDescr, sizeof(formatDescr)); //throw UnexpectedEndOfStreamError
+
+        if (!std::equal(FILE_FORMAT_DESCR, FILE_FORMAT_DESCR + sizeof(FILE_FORMAT_DESCR), formatDescr))
+            return;
+
+        if (readNumber<std::int32_t>(streamIn) != INDEX_FORMAT_VER) //throw UnexpectedEndOfStreamError
+            return;
+
+        MemStreamIn in(decompress(readContainer<ByteArray>(streamIn))); //throw UnexpectedEndOfStreamError, ZlibInternalError
+
+        if (readContainer<std::string>(in) != baseFolderPathUtf8_ ||
+            readNumber<std::int32_t>(in) != static_cast<std::int32_t>(handleSymlinks_))
+            return;
+
+        const std::int64_t prevTraversalStartTime = readNumber<std::int64_t>(in);
+
+        std::map<Zstring, PrevFolder, LessFilePath> prevFolderList;
+        size_t folderCount = readNumber<std::uint32_t>(in);
+        while (folderCount-- != 0)
+        {
+            const Zstring relPath = readUtf8(in);
+            prevFolderList[relPath].listing = readFolder(in);
+        }
+
+        prevTraversalStartTime_ = prevTraversalStartTime;
+        prevFolders.swap(prevFolderList);
+    }
+    catch (FileError&) {} //index not yet existing or inaccessible => read all folders
+    catch (UnexpectedEndOfStreamError&) {} //index is corrupt => read all folders
+    catch (ZlibInternalError&) {} //
+}
+
+
+void ScanIndex::setChangedItems(std::int64_t changesCompleteSince, std::set<Zstring, LessFilePath>&& changedItems)
+{
+    //changes made before the previous traversal started are already contained in its listings
+    trustUnchanged_ = !prevFolders.empty() && prevTraversalStartTime_ >= changesCompleteSince;
+    changedItems_.swap(changedItems);
+
+    changedParents_.clear();
+    for (const Zstring& relPath : changedItems_)
+        changedParents_.insert(beforeLast(relPath, FILE_NAME_SEPARATOR, IF_MISSING_RETURN_NONE));
+}
+
+
+bool ScanIndex::isChangedFolder(const Zstring& relPath) const
+{
+    if (changedParents_.find(relPath) != changedParents_.end())
+        return true;
+
+    //a renamed or replaced folder is reported once, not per contained item => check all parents, too
+    for (Zstring path = relPath; !path.empty(); path = beforeLast(path, FILE_NAME_SEPARATOR, IF_MISSING_RETURN_NONE))
+        if (changedItems_.find(path) != changedItems_.end())
+            return true;
+    return false;
+}
+
+
+Opt<std::int64_t> ScanIndex::getTrustedFolderWriteTime(const Zstring& relPath) const
+{
+    if (!trustUnchanged_ || isChangedFolder(relPath))
+        return NoValue();
+
+    auto it = prevFolders.find(relPath);
+    if (it == prevFolders.end())
+        return NoValue();
+
+    return it->second.listing.folderWriteTime; //not changed by takeUnchangedFolder() => no need to lock
+}
+
+
+bool ScanIndex::takeUnchangedFolder(const Zstring& relPath, std::int64_t folderWriteTime, ScanIndexFolder& folder)
+{
+    auto it = prevFolders.find(relPath);
+    if (it == prevFolders.end())
+        return false;
+
+    if (trustUnchanged_)
+    {
+        if (isChangedFolder(relPath)) //a file's content may have changed without updating the folder's modification time
+            return false;
+    }
+    //folder may have been modified during the previous traversal within the same (FAT: two) seconds => not detectable via modification time
+    else if (folderWriteTime != it->second.listing.folderWriteTime ||
+             folderWriteTime >= prevTraversalStartTime_ - RACY_CLEAN_TOLERANCE)
+        return false;
+
+    //no need to lock: map structure is not changed and save() runs after all worker threads are joined
+    folder = std::move(it->second.listing);
+    it->second.taken = true; //the moved-from listing is empty: don't let an interrupted traversal save it as the folder's content!
+    return true;
+}
+
+
+void ScanIndex::addFolder(const Zstring& relPath, ScanIndexFolder&& folder)
+{
+    std::lock_guard<std::mutex> dummy(lockFolders);
+    folders[relPath] = std::move(folder);
+}
+
+
+void ScanIndex::save(bool traversalComplete) //throw FileError
+{
+    std::lock_guard<std::mutex> dummy(lockFolders);
+
+    //start time of the *oldest* listing: changes made since then may be missing => next traversal's change list must be complete since then
+    std::int64_t listingsStartTime = traversalStartTime_;
+
+    if (!traversalComplete) //keep unchanged folders not yet read => the next traversal resumes where this one was interrupted
+    {
+        for (auto& item : prevFolders)
+            if (!item.second.taken) //taken, but not re-added via addFolder() => traversal was interrupted before the listing was complete
+                if (folders.emplace(item.first, std::move(item.second.listing)).second) //no-op for folders read again
+                    listingsStartTime = std::min(listingsStartTime, prevTraversalStartTime_);
+        prevFolders.clear();
+    }
+
+    MemStreamOut out;
+    writeContainer<std::string>(out, baseFolderPathUtf8_);
+    writeNumber<std::int32_t>(out, handleSymlinks_);
+    writeNumber<std::int64_t>(out, listingsStartTime);
+
+    writeNumber<std::uint32_t>(out, static_cast<std::uint32_t>(folders.size()));
+    for (const auto& item : folders)
+    {
+        writeUtf8(out, item.first);
+        writeFolder(out, item.second);
+    }
+
+    MemStreamOut memStreamOut;
+
+    //write FreeFileSync file identifier
+    writeArray(memStreamOut, FILE_FORMAT_DESCR, sizeof(FILE_FORMAT_DESCR));
+
+    //save file format version
+    writeNumber<std::int32_t>(memStreamOut, INDEX_FORMAT_VER);
+
+    try
+    {
+        writeContainer<ByteArray>(memStreamOut, compress(out.ref(), 3)); //throw ZlibInternalError
+    }
+    catch (ZlibInternalError&)
+    {
+        throw FileError(replaceCpy(_("Cannot write file %x."), L"%x", fmtPath(indexFilePath_)), L"zlib internal error");
+    }
+
+    //write as a transaction: the index is only an optimization and must never be found half-written
+    const Zstring tmpFilePath = indexFilePath_ + Zstr(".tmp");
+
+    makeDirectoryRecursively(beforeLast(indexFilePath_, FILE_NAME_SEPARATOR, IF_MISSING_RETURN_NONE)); //throw FileError
+
+    ZEN_ON_SCOPE_FAIL(try { removeFile(tmpFilePath); /*throw FileError*/ }
+    catch (FileError&) {});
+
+    saveBinStream(tmpFilePath, memStreamOut.ref(), nullptr); //throw FileError
+    replaceFile(tmpFilePath, indexFilePath_); //throw FileError
+}
@@ -0,0 +1,100 @@
+// **************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under *
+// * GNU General Public License: http://www.gnu.org/licenses/gpl-3.0        *
+// * Copyright (C) Zenju (zenju AT gmx DOT de) - All Rights Reserved        *
+// **************************************************************************
+
+#ifndef SCAN_INDEX_H_3840578203475023485
+#define SCAN_INDEX_H_3840578203475023485
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <zen/file_error.h>
+#include "../file_hierarchy.h"
+
+
+namespace zen
+{
+/*
+Persistent scan index: raw listing of each folder read while traversing a base folder + the folder's modification time
+
+- creating, deleting or renaming an item updates the modification time of its parent folder => listing is read again
+- modifying a file's content does NOT update its parent folder! => the modification time of each file is checked again (no need to read the folder though)
+- listings are recorded *before* filtering => independent from filter settings
+- a folder modified around the time the previous traversal started cannot be trusted ("racily clean") => listing is read again
+- listings of an interrupted traversal are kept => next traversal resumes with the folders not yet read
+- change list (see change_list.h) complete since the previous traversal started: folders without changes are trusted without checking their modification times
+*/
+struct ScanIndexFolder
+{
+    struct File
+    {
+        File(std::int64_t lastWriteTimeIn, std::uint64_t fileSizeIn, const AFS::FileId& idIn, bool isFollowedSymlinkIn, std::int64_t symlinkWriteTimeIn) :
+            lastWriteTime(lastWriteTimeIn), fileSize(fileSizeIn), id(idIn), isFollowedSymlink(isFollowedSymlinkIn), symlinkWriteTime(symlinkWriteTimeIn) {}
+
+        std::int64_t  lastWriteTime;
+        std::uint64_t fileSize;
+        AFS::FileId   id;
+        bool          isFollowedSymlink;
+        std::int64_t  symlinkWriteTime; //only set if isFollowedSymlink
+    };
+
+    std::int64_t folderWriteTime = 0; //modification time of the folder itself *before* reading its items
+
+    std::map<Zstring, File,         LessFilePath> files;
+    std::map<Zstring, std::int64_t, LessFilePath> symlinks; //symlink modification time
+    std::set<Zstring,               LessFilePath> folders;
+};
+
+
+class ScanIndex
+{
+public:
+    //loads index of the previous traversal; an index which is missing, corrupt or incompatible is (silently) discarded
+    ScanIndex(const AbstractPath& baseFolderPath, SymLinkHandling handleSymlinks);
+
+    //"changedItems": relative paths of all items changed since "changesCompleteSince"; ignored if the previous traversal started earlier
+    //=> invalidates the parent folder of each item + the item's complete subtree (e.g. renamed or replaced folder)
+    void setChangedItems(std::int64_t changesCompleteSince, std::set<Zstring, LessFilePath>&& changedItems);
+
+    //context of worker threads: each relative path must be requested by at most one thread!
+    bool takeUnchangedFolder(const Zstring& relPath, std::int64_t folderWriteTime, ScanIndexFolder& folder); //"false" if folder was modified or is not indexed
+    Opt<std::int64_t> getTrustedFolderWriteTime(const Zstring& relPath) const; //"no value" if folder needs to be checked via its current modification time
+    void addFolder(const Zstring& relPath, ScanIndexFolder&& folder);
+
+    //traversalComplete: only keep folders of this traversal; otherwise also keep those of the previous one => resume
+    void save(bool traversalComplete); //throw FileError
+
+private:
+    ScanIndex           (const ScanIndex&) = delete;
+    ScanIndex& operator=(const ScanIndex&) = delete;
+
+    bool isChangedFolder(const Zstring& relPath) const;
+
+    using FolderList = std::map<Zstring, ScanIndexFolder, LessFilePath>; //relative path (empty for base folder) => listing
+
+    const std::string baseFolderPathUtf8_;
+    const SymLinkHandling handleSymlinks_;
+    const Zstring indexFilePath_;
+    const std::int64_t traversalStartTime_;
+
+    struct PrevFolder
+    {
+        ScanIndexFolder listing;
+        bool taken = false; //listing was moved out by takeUnchangedFolder() => must not be saved again
+    };
+
+    std::int64_t prevTraversalStartTime_ = 0;
+    std::map<Zstring, PrevFolder, LessFilePath> prevFolders; //never insert/erase after construction => concurrent access to *different* elements is fine
+
+    bool trustUnchanged_ = false; //set before traversal, read-only afterwards
+    std::set<Zstring, LessFilePath> changedItems_;   //
+    std::set<Zstring, LessFilePath> changedParents_; //
+
+    std::mutex lockFolders;
+    FolderList folders;
+};
+}
+
+#endif //SCAN_INDEX_H_3840578203475023485
@@ -183,7 +183,7 @@ void moveFileOrSymlink(const AbstractPath& sourcePath, //throw FileError
             AFS::copySymlink(sourcePath, targetPath, false /*copy filesystem permissions*/); //throw FileError
         else
             AFS::copyFileTransactional(sourcePath, targetPath, //throw FileError, ErrorFileLocked
-            false /*copyFilePermissions*/, true /*transactionalCopy*/, nullptr /*onDeleteTargetFile*/, onNotifyCopyStatus);
+            false /*copyFilePermissions*/, true /*transactionalCopy*/, false /*computeContentHash*/, nullptr /*onDeleteTargetFile*/, onNotifyCopyStatus);
 
         AFS::removeFile(sourcePath); //throw FileError; newly copied file is NOT deleted if exception is thrown here!
     };
@@ -200,7 +200,7 @@ void moveFile(const AbstractPath& sourcePath, //throw FileError
     {
         assert(!AFS::somethingExists(targetPath));
         AFS::copyFileTransactional(sourcePath, targetPath, //throw FileError, ErrorFileLocked
-        false /*copyFilePermissions*/, true /*transactionalCopy*/, nullptr /*onDeleteTargetFile*/, onNotifyCopyStatus);
+        false /*copyFilePermissions*/, true /*transactionalCopy*/, false /*computeContentHash*/, nullptr /*onDeleteTargetFile*/, onNotifyCopyStatus);
         AFS::removeFile(sourcePath); //throw FileError; newly copied file is NOT deleted if exception is thrown here!
     };
     moveItem(sourcePath, targetPath, copyDelete); //throw FileError
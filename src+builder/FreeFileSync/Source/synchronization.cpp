@@ -19,8 +19,11 @@
 // **************************************************************************
 
 #include "synchronization.h"
+#include <atomic>
+#include <mutex>
 #include <zen/process_priority.h>
 #include <zen/perf.h>
+#include <zen/thread.h>
 #include "lib/db_file.h"
 #include "lib/dir_exist_async.h"
 #include "lib/status_handler_impl.h"
@@ -631,8 +634,10 @@ class SynchronizeFolderPair
 public:
     SynchronizeFolderPair(ProcessCallback& procCallback,
                           bool verifyCopiedFiles,
+                          bool hashCopiedFilesForDb,
                           bool copyFilePermissions,
                           bool transactionalFileCopy,
+                          size_t fileCopyThreads,
 #ifdef ZEN_WIN
 #ifdef TODO_MinFFS_SHADOW_COPY_ENABLE
                           shadow::ShadowCopy* shadowCopyHandler,
@@ -649,8 +654,11 @@ public:
         delHandlingLeft_(delHandlingLeft),
         delHandlingRight_(delHandlingRight),
         verifyCopiedFiles_(verifyCopiedFiles),
+        hashCopiedFiles_(verifyCopiedFiles),
+        hashCopiedFilesForDb_(hashCopiedFilesForDb),
         copyFilePermissions_(copyFilePermissions),
         transactionalFileCopy_(transactionalFileCopy),
+        fileCopyThreads_(fileCopyThreads),
         txtCreatingFile     (_("Creating file %x"            )),
         txtCreatingLink     (_("Creating symbolic link %x"   )),
         txtCreatingFolder   (_("Creating folder %x"          )),
@@ -665,7 +673,9 @@ public:
     {
         runZeroPass(baseFolder);       //first process file moves
         runPass<PASS_ONE>(baseFolder); //delete files (or overwrite big ones with smaller ones)
+        copyFilesParallel();           //
         runPass<PASS_TWO>(baseFolder); //copy rest
+        copyFilesParallel();           //
     }
 
 private:
@@ -693,6 +703,9 @@ private:
     void synchronizeFile(FilePair& file);
     template <SelectedSide side> void synchronizeFileInt(FilePair& file, SyncOperation syncOp);
 
+    static bool canCopyInParallel(const FilePair& file);
+    void copyFilesParallel(); //process "filesToCopy"
+
     void synchronizeLink(SymlinkPair& link);
     template <SelectedSide sideTrg> void synchronizeLinkInt(SymlinkPair& link, SyncOperation syncOp);
 
@@ -713,6 +726,8 @@ private:
                                                   const std::function<void()>& onDeleteTargetFile,
                                                   const std::function<void(std::int64_t bytesDelta)>& onNotifyCopyStatus) const; //throw FileError
 
+    void hashTargetForDb(const AbstractPath& targetPath, AFS::FileAttribAfterCopy& newAttr, const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus) const; //throw X
+
     template <SelectedSide side>
     DeletionHandling& getDelHandling();
 
@@ -726,8 +741,13 @@ private:
     DeletionHandling& delHandlingRight_;
 
     const bool verifyCopiedFiles_;
+    const bool hashCopiedFiles_;      //compute content hash while copying: saves reading the source again during verification, but rules out the kernel's copy routines
+    const bool hashCopiedFilesForDb_; //comparison by content + database: read the target after copying => next comparison only needs to read files modified in the meantime
     const bool copyFilePermissions_;
     const bool transactionalFileCopy_;
+    const size_t fileCopyThreads_; //> 1: file copies of a pass are deferred to "filesToCopy" and processed in parallel
+
+    std::vector<FilePair*> filesToCopy;
 
     //preload status texts
     const std::wstring txtCreatingFile;
@@ -1099,7 +1119,12 @@ void SynchronizeFolderPair::runPass(HierarchyObject& hierObj)
     //synchronize files:
     for (FilePair& file : hierObj.refSubFiles())
         if (pass == this->getPass(file)) //"this->" required by two-pass lookup as enforced by GCC 4.7
-            tryReportingError([&] { synchronizeFile(file); }, procCallback_); //throw X?
+        {
+            if (fileCopyThreads_ > 1 && canCopyInParallel(file))
+                filesToCopy.push_back(&file); //copy after all folders of this pass have been created
+            else
+                tryReportingError([&] { synchronizeFile(file); }, procCallback_); //throw X?
+        }
 
     //synchronize symbolic links:
     for (SymlinkPair& symlink : hierObj.refSubLinks())
@@ -1199,6 +1224,7 @@ void SynchronizeFolderPair::synchronizeFileInt(FilePair& file, SyncOperation syn
                                           newAttr.targetFileId,
                                           newAttr.sourceFileId,
                                           false, file.isFollowedSymlink<sideSrc>());
+                file.setContentHash(newAttr.contentHash);
             }
             catch (FileError&)
             {
@@ -1319,6 +1345,7 @@ void SynchronizeFolderPair::synchronizeFileInt(FilePair& file, SyncOperation syn
                                       newAttr.sourceFileId,
                                       file.isFollowedSymlink<sideTrg>(),
                                       file.isFollowedSymlink<sideSrc>());
+            file.setContentHash(newAttr.contentHash);
 
             statReporter.reportFinished();
         }
@@ -1621,7 +1648,9 @@ void SynchronizeFolderPair::synchronizeFolderInt(FolderPair& folder, SyncOperati
 //###########################################################################################
 
 //--------------------- data verification -------------------------
-void verifyFiles(const AbstractPath& sourcePath, const AbstractPath& targetPath, const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus)  //throw FileError
+//sourceHash: hash of the data written while copying => only the target needs to be read again
+void verifyFiles(const AbstractPath& sourcePath, const AbstractPath& targetPath, const Opt<std::uint64_t>& sourceHash, //throw FileError
+                 const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus)
 {
     try
     {
@@ -1658,7 +1687,9 @@ void verifyFiles(const AbstractPath& sourcePath, const AbstractPath& targetPath,
 
         if (onUpdateStatus) onUpdateStatus(0);
 
-        if (!filesHaveSameContent(sourcePath, targetPath, onUpdateStatus)) //throw FileError
+        if (sourceHash ?
+            getFileContentHash(targetPath, onUpdateStatus) != *sourceHash : //throw FileError
+            !filesHaveSameContent(sourcePath, targetPath, onUpdateStatus)) //throw FileError
             throw FileError(replaceCpy(replaceCpy(_("%x and %y have different content."),
                                                   L"%x", L"\n" + fmtPath(AFS::getDisplayPath(sourcePath))),
                                        L"%y", L"\n" + fmtPath(AFS::getDisplayPath(targetPath))));
@@ -1670,6 +1701,18 @@ void verifyFiles(const AbstractPath& sourcePath, const AbstractPath& targetPath,
 }
 
 
+//not computed while copying: FICLONE, copy_file_range, sendfile are much faster than any copy through user space (see zen/file_access.cpp)
+void SynchronizeFolderPair::hashTargetForDb(const AbstractPath& targetPath, AFS::FileAttribAfterCopy& newAttr, const std::function<void(std::int64_t bytesDelta)>& onUpdateStatus) const //throw X
+{
+    if (hashCopiedFilesForDb_ && !newAttr.contentHash)
+        try
+        {
+            newAttr.contentHash = getFileContentHash(targetPath, onUpdateStatus); //throw FileError, X
+        }
+        catch (FileError&) {} //not critical: the next comparison reads both files
+}
+
+
 AFS::FileAttribAfterCopy SynchronizeFolderPair::copyFileWithCallback(const AbstractPath& sourcePath,  //throw FileError
                                                                      const AbstractPath& targetPath,
                                                                      const std::function<void()>& onDeleteTargetFile,
@@ -1680,6 +1723,7 @@ AFS::FileAttribAfterCopy SynchronizeFolderPair::copyFileWithCallback(const Abstr
         AFS::FileAttribAfterCopy newAttr = AFS::copyFileTransactional(sourcePathTmp, targetPath, //throw FileError, ErrorFileLocked
                                                                       copyFilePermissions_,
                                                                       transactionalFileCopy_,
+                                                                      hashCopiedFiles_, //computeContentHash
                                                                       onDeleteTargetFile,
                                                                       onNotifyCopyStatus);
 
@@ -1689,10 +1733,12 @@ AFS::FileAttribAfterCopy SynchronizeFolderPair::copyFileWithCallback(const Abstr
             ZEN_ON_SCOPE_FAIL( AFS::removeFile(targetPath); ); //delete target if verification fails
 
             procCallback_.reportInfo(replaceCpy(txtVerifying, L"%x", fmtPath(AFS::getDisplayPath(targetPath))));
-            verifyFiles(sourcePathTmp, targetPath, [&](std::int64_t bytesDelta) { procCallback_.requestUiRefresh(); }); //throw FileError
+            verifyFiles(sourcePathTmp, targetPath, newAttr.contentHash, [&](std::int64_t bytesDelta) { procCallback_.requestUiRefresh(); }); //throw FileError
         }
         //#################### /Verification #############################
 
+        hashTargetForDb(targetPath, newAttr, [&](std::int64_t bytesDelta) { procCallback_.requestUiRefresh(); }); //throw X
+
         return newAttr;
     };
 
@@ -1733,6 +1779,250 @@ AFS::FileAttribAfterCopy SynchronizeFolderPair::copyFileWithCallback(const Abstr
 #endif
 }
 
+/*
+Parallel file copy:
+    - files to create or overwrite are collected while traversing a pass and copied after the traversal => pass order is kept: deletions (1st pass)
+      are finished before, parent folders are created before any file of the pass is copied
+    - worker threads do not access the file hierarchy or the ProcessCallback: paths are resolved up front, the main thread reports progress
+      and updates the FilePair after all workers have finished
+    - deletion handlers are not thread-safe: removal of overwritten files (e.g. versioning) is serialized
+    - a failed copy is repeated by the main thread to support interactive error handling (retry/ignore) and Volume Shadow Copy
+*/
+inline
+bool SynchronizeFolderPair::canCopyInParallel(const FilePair& file)
+{
+    switch (file.getSyncOperation())
+    {
+        case SO_CREATE_NEW_LEFT:
+        case SO_CREATE_NEW_RIGHT:
+            return true;
+
+        case SO_OVERWRITE_LEFT:
+            return !file.isFollowedSymlink<LEFT_SIDE>(); //resolving the link may fail => leave it to synchronizeFile()
+        case SO_OVERWRITE_RIGHT:
+            return !file.isFollowedSymlink<RIGHT_SIDE>();
+
+        case SO_DELETE_LEFT:
+        case SO_DELETE_RIGHT:
+        case SO_MOVE_LEFT_SOURCE:
+        case SO_MOVE_RIGHT_SOURCE:
+        case SO_MOVE_LEFT_TARGET:
+        case SO_MOVE_RIGHT_TARGET:
+        case SO_COPY_METADATA_TO_LEFT:
+        case SO_COPY_METADATA_TO_RIGHT:
+        case SO_DO_NOTHING:
+        case SO_EQUAL:
+        case SO_UNRESOLVED_CONFLICT:
+            break;
+    }
+    return false;
+}
+
+
+void SynchronizeFolderPair::copyFilesParallel()
+{
+    std::vector<FilePair*> files;
+    files.swap(filesToCopy);
+
+    struct Task
+    {
+        Task(FilePair& file, SelectedSide sideTrg, const AbstractPath& sourcePath, const AbstractPath& targetPath,
+             DeletionHandling* delHandling, const std::wstring& statusText) :
+            file_(file),
+            sideTrg_(sideTrg),
+            sourcePath_(sourcePath),
+            targetPath_(targetPath),
+            relativePath_(file.getPairRelativePath()),
+            delHandling_(delHandling),
+            statusText_(statusText) {}
+
+        FilePair& file_; //access by main thread only!
+        const SelectedSide sideTrg_;
+        const AbstractPath sourcePath_;
+        const AbstractPath targetPath_;
+        const Zstring relativePath_;
+        DeletionHandling* const delHandling_; //nullptr if there is no target file to delete
+        const std::wstring statusText_;
+
+        AFS::FileAttribAfterCopy newAttr; //written by worker thread, read by main thread after join
+        bool failed = false;              //
+    };
+
+    std::vector<Task> tasks;
+    tasks.reserve(files.size());
+    std::uint64_t bytesTotal = 0;
+
+    for (FilePair* file : files)
+    {
+        const SyncOperation syncOp = file->getSyncOperation();
+        const SelectedSide sideTrg = *getTargetDirection(syncOp);
+        const bool overwrite = syncOp == SO_OVERWRITE_LEFT || syncOp == SO_OVERWRITE_RIGHT;
+
+        if (!overwrite)
+            if (auto parentFolder = dynamic_cast<const FolderPair*>(&file->parent()))
+                if (sideTrg == LEFT_SIDE ? parentFolder->isEmpty<LEFT_SIDE>() : parentFolder->isEmpty<RIGHT_SIDE>())
+                    continue; //if parent directory creation failed, there's no reason to show more errors!
+
+        //respect differences in case of source object:
+        if (sideTrg == LEFT_SIDE)
+        {
+            tasks.emplace_back(*file, LEFT_SIDE, file->getAbstractPath<RIGHT_SIDE>(),
+                               AFS::appendRelPath(file->base().getAbstractPath<LEFT_SIDE>(), file->getRelativePath<RIGHT_SIDE>()),
+                               overwrite ? &getDelHandling<LEFT_SIDE>() : nullptr,
+                               overwrite ? txtOverwritingFile : txtCreatingFile);
+            bytesTotal += file->getFileSize<RIGHT_SIDE>();
+        }
+        else
+        {
+            tasks.emplace_back(*file, RIGHT_SIDE, file->getAbstractPath<LEFT_SIDE>(),
+                               AFS::appendRelPath(file->base().getAbstractPath<RIGHT_SIDE>(), file->getRelativePath<LEFT_SIDE>()),
+                               overwrite ? &getDelHandling<RIGHT_SIDE>() : nullptr,
+                               overwrite ? txtOverwritingFile : txtCreatingFile);
+            bytesTotal += file->getFileSize<LEFT_SIDE>();
+        }
+    }
+    if (tasks.empty())
+        return;
+
+    std::atomic<size_t>       nextTaskIdx   (0);
+    std::atomic<size_t>       currentTaskIdx(0);
+    std::atomic<int>          itemsDone(0); //failed tasks are not counted
+    std::atomic<std::int64_t> bytesDone(0);
+    std::mutex lockDelHandling;
+
+    std::vector<InterruptibleThread> worker;
+    worker.reserve(fileCopyThreads_);
+
+    ZEN_ON_SCOPE_EXIT( //not only on failure: joined workers are not joinable anymore
+        for (InterruptibleThread& wt : worker)
+        if (wt.joinable())
+            wt.interrupt(); //interrupt all at once first, then join
+        for (InterruptibleThread& wt : worker)
+            if (wt.joinable())
+                wt.join();
+            );
+
+    for (size_t i = 0; i < std::min(fileCopyThreads_, tasks.size()); ++i)
+        worker.emplace_back([this, &tasks, &nextTaskIdx, &currentTaskIdx, &itemsDone, &bytesDone, &lockDelHandling]
+    {
+#ifdef ZEN_WIN
+        setCurrentThreadName("Copy Files");
+#endif
+        for (size_t taskIdx = nextTaskIdx++; taskIdx < tasks.size(); taskIdx = nextTaskIdx++)
+        {
+            interruptionPoint(); //throw ThreadInterruption
+            currentTaskIdx = taskIdx;
+            Task& task = tasks[taskIdx];
+
+            std::int64_t taskBytesDone = 0;
+            auto onNotifyCopyStatus = [&](std::int64_t bytesDelta)
+            {
+                bytesDone += bytesDelta;
+                taskBytesDone += bytesDelta;
+                interruptionPoint(); //throw ThreadInterruption
+            };
+
+            std::function<void()> onDeleteTargetFile;
+            if (task.delHandling_)
+                onDeleteTargetFile = [&]
+            {
+                std::lock_guard<std::mutex> dummy(lockDelHandling);
+                task.delHandling_->removeFileWithCallback(task.targetPath_, task.relativePath_, [] {}, onNotifyCopyStatus); //throw FileError
+            };
+
+            try
+            {
+                task.newAttr = AFS::copyFileTransactional(task.sourcePath_, task.targetPath_, //throw FileError, ErrorFileLocked
+                                                          copyFilePermissions_,
+                                                          transactionalFileCopy_,
+                                                          hashCopiedFiles_, //computeContentHash
+                                                          onDeleteTargetFile,
+                                                          onNotifyCopyStatus);
+                if (verifyCopiedFiles_)
+                {
+                    ZEN_ON_SCOPE_FAIL( AFS::removeFile(task.targetPath_); ); //delete target if verification fails
+                    verifyFiles(task.sourcePath_, task.targetPath_, task.newAttr.contentHash, [](std::int64_t bytesDelta) { interruptionPoint(); }); //throw FileError, ThreadInterruption
+                }
+                hashTargetForDb(task.targetPath_, task.newAttr, [](std::int64_t bytesDelta) { interruptionPoint(); }); //throw ThreadInterruption
+                ++itemsDone;
+            }
+            catch (ThreadInterruption&) { throw; }
+            catch (...) //FileError, std::bad_alloc, ...: must not leave the thread => repeat in main thread, which reports the error or throws
+            {
+                task.failed = true;
+                bytesDone -= taskBytesDone; //the retry in the main thread reports these bytes again
+            }
+        }
+    });
+
+    {
+        StatisticsReporter statReporter(static_cast<int>(tasks.size()), bytesTotal, procCallback_);
+        int          itemsReported = 0;
+        std::int64_t bytesReported = 0;
+
+        auto reportProgress = [&]
+        {
+            const int          itemsDoneNow = itemsDone;
+            const std::int64_t bytesDoneNow = bytesDone;
+            statReporter.reportDelta(itemsDoneNow - itemsReported, bytesDoneNow - bytesReported); //may throw!
+            itemsReported = itemsDoneNow;
+            bytesReported = bytesDoneNow;
+        };
+
+        //wait until done: the main thread is the only one talking to the ProcessCallback
+        for (InterruptibleThread& wt : worker)
+            do
+            {
+                const Task& task = tasks[currentTaskIdx];
+                reportStatus(task.statusText_, AFS::getDisplayPath(task.targetPath_)); //throw X
+                reportProgress(); //throw X
+            }
+            while (!wt.tryJoinFor(std::chrono::milliseconds(UI_UPDATE_INTERVAL / 2)));
+        reportProgress(); //throw X
+
+        statReporter.reportFinished(); //removes the failed tasks from the total...
+    }
+
+    int          itemsFailed = 0;
+    std::int64_t bytesFailed = 0;
+    for (const Task& task : tasks)
+        if (task.failed)
+        {
+            ++itemsFailed;
+            bytesFailed += task.sideTrg_ == LEFT_SIDE ? task.file_.getFileSize<RIGHT_SIDE>() : task.file_.getFileSize<LEFT_SIDE>();
+        }
+    procCallback_.updateTotalData(itemsFailed, bytesFailed); //...but synchronizeFile() expects them to be part of it
+
+    //update FilePair: nothrow => complete before calling back again
+    for (Task& task : tasks)
+        if (!task.failed)
+        {
+            FilePair& file = task.file_;
+            if (task.sideTrg_ == LEFT_SIDE)
+                file.setSyncedTo<LEFT_SIDE>(file.getItemName<RIGHT_SIDE>(), task.newAttr.fileSize,
+                                            task.newAttr.modificationTime, //target time set from source
+                                            task.newAttr.modificationTime,
+                                            task.newAttr.targetFileId,
+                                            task.newAttr.sourceFileId,
+                                            false, file.isFollowedSymlink<RIGHT_SIDE>());
+            else
+                file.setSyncedTo<RIGHT_SIDE>(file.getItemName<LEFT_SIDE>(), task.newAttr.fileSize,
+                                             task.newAttr.modificationTime,
+                                             task.newAttr.modificationTime,
+                                             task.newAttr.targetFileId,
+                                             task.newAttr.sourceFileId,
+                                             false, file.isFollowedSymlink<LEFT_SIDE>());
+            file.setContentHash(task.newAttr.contentHash);
+        }
+
+    for (Task& task : tasks)
+        if (task.failed)
+            //repeat in main thread: allow user to retry or ignore
+            tryReportingError([&] { synchronizeFile(task.file_); }, procCallback_); //throw X?
+        else
+            reportInfo(task.statusText_, AFS::getDisplayPath(task.targetPath_)); //log the same as synchronizeFile()
+}
+
 //###########################################################################################
 
 template <SelectedSide side>
@@ -1820,6 +2110,7 @@ void zen::synchronize(const TimeComp& timeStamp,
                       bool copyFilePermissions,
                       bool transactionalFileCopy,
                       bool runWithBackgroundPriority,
+                      size_t fileCopyThreads,
                       const std::vector<FolderPairSyncCfg>& syncConfig,
                       FolderComparison& folderCmp,
                       ProcessCallback& callback)
@@ -2236,7 +2527,7 @@ void zen::synchronize(const TimeComp& timeStamp,
                                              callback);
 
 
-                SynchronizeFolderPair syncFP(callback, verifyCopiedFiles, copyPermissionsFp, transactionalFileCopy,
+                SynchronizeFolderPair syncFP(callback, verifyCopiedFiles, folderPairCfg.saveSyncDB_ && j->getCompVariant() == CMP_BY_CONTENT, copyPermissionsFp, transactionalFileCopy, fileCopyThreads,
 #ifdef ZEN_WIN
 #ifdef TODO_MinFFS_SHADOW_COPY_ENABLE
                                              shadowCopyHandler.get(),
@@ -92,6 +92,7 @@ void synchronize(const TimeComp& timeStamp,
                  bool copyFilePermissions,
                  bool transactionalFileCopy,
                  bool runWithBackgroundPriority,
+                 size_t fileCopyThreads, //> 1: create/overwrite files in parallel
                  const std::vector<FolderPairSyncCfg>& syncConfig, //CONTRACT: syncConfig and folderCmp correspond row-wise!
                  FolderComparison& folderCmp,                      //
                  ProcessCallback& callback);
@@ -8,6 +8,8 @@
 #include "sorting.h"
 #include "../synchronization.h"
 #include <zen/stl_tools.h>
+#include <zen/thread.h>
+#include <map>
 
 using namespace zen;
 
@@ -318,113 +320,87 @@ void GridView::setData(FolderComparison& folderCmp)
 }
 
 
-//------------------------------------ SORTING TEMPLATES ------------------------------------------------
-template <bool ascending, SelectedSide side>
-struct GridView::LessFullPath
+//------------------------------------ SORTING ------------------------------------------------
+namespace
 {
-    bool operator()(const RefIndex a, const RefIndex b) const
-    {
-        const FileSystemObject* fsObjA = FileSystemObject::retrieve(a.objId);
-        const FileSystemObject* fsObjB = FileSystemObject::retrieve(b.objId);
-        if (!fsObjA) //invalid rows shall appear at the end
-            return false;
-        else if (!fsObjB)
-            return true;
-
-        return lessFullPath<ascending, side>(*fsObjA, *fsObjB);
-    }
-};
-
-
-template <bool ascending>
-struct GridView::LessRelativeFolder
+//stable sort on all hardware threads: sort one chunk per thread, then merge the chunks pairwise
+template <class T, class Less>
+void parallelSort(std::vector<T>& items, Less less)
 {
-    bool operator()(const RefIndex a, const RefIndex b) const
-    {
-        const FileSystemObject* fsObjA = FileSystemObject::retrieve(a.objId);
-        const FileSystemObject* fsObjB = FileSystemObject::retrieve(b.objId);
-        if (!fsObjA) //invalid rows shall appear at the end
-            return false;
-        else if (!fsObjB)
-            return true;
-
-        //presort by folder pair
-        if (a.folderIndex != b.folderIndex)
-            return ascending ?
-                   a.folderIndex < b.folderIndex :
-                   a.folderIndex > b.folderIndex;
-
-        return lessRelativeFolder<ascending>(*fsObjA, *fsObjB);
-    }
-};
+    const size_t MIN_ITEMS_PER_THREAD = 10000;
+    const size_t threadCount = std::min<size_t>(items.size() / MIN_ITEMS_PER_THREAD, std::max(std::thread::hardware_concurrency(), 1U));
+    if (threadCount <= 1)
+        return std::stable_sort(items.begin(), items.end(), less);
 
+    std::vector<size_t> chunkBegin; //threadCount + 1 positions
+    for (size_t i = 0; i <= threadCount; ++i)
+        chunkBegin.push_back(items.size() * i / threadCount);
 
-template <bool ascending, SelectedSide side>
-struct GridView::LessShortFileName
-{
-    bool operator()(const RefIndex a, const RefIndex b) const
+    std::vector<std::future<void>> jobs;
+    auto waitForJobs = [&]
     {
-        const FileSystemObject* fsObjA = FileSystemObject::retrieve(a.objId);
-        const FileSystemObject* fsObjB = FileSystemObject::retrieve(b.objId);
-        if (!fsObjA) //invalid rows shall appear at the end
-            return false;
-        else if (!fsObjB)
-            return true;
+        for (std::future<void>& ft : jobs)
+            ft.wait(); //no job may access "items" once we leave, even on exceptions
+        for (std::future<void>& ft : jobs)
+            ft.get(); //throw std::bad_alloc
+        jobs.clear();
+    };
+
+    for (size_t i = 0; i < threadCount; ++i)
+        jobs.push_back(runAsyncCompute([&items, &less, first = chunkBegin[i], last = chunkBegin[i + 1]]
+    {
+        std::stable_sort(items.begin() + first, items.begin() + last, less);
+    }));
+    waitForJobs();
 
-        return lessShortFileName<ascending, side>(*fsObjA, *fsObjB);
+    for (size_t step = 1; step < threadCount; step *= 2)
+    {
+        for (size_t i = 0; i + step < threadCount; i += 2 * step)
+            jobs.push_back(runAsyncCompute([&items, &less, first = chunkBegin[i], middle = chunkBegin[i + step], last = chunkBegin[std::min(i + 2 * step, threadCount)]]
+        {
+            std::inplace_merge(items.begin() + first, items.begin() + middle, items.begin() + last, less); //stable
+        }));
+        waitForJobs();
     }
-};
+}
 
 
-template <bool ascending, SelectedSide side>
-struct GridView::LessFilesize
+//extract one key per row, sort the keys, then reorder the rows accordingly: see sorting.h
+template <class RefIndex, class GetKey, class LessKey>
+void sortByKey(std::vector<RefIndex>& sortedRef, GetKey getKey /*(const FileSystemObject* fsObj, size_t folderIndex) -> Key*/, LessKey lessKey)
 {
-    bool operator()(const RefIndex a, const RefIndex b) const
-    {
-        const FileSystemObject* fsObjA = FileSystemObject::retrieve(a.objId);
-        const FileSystemObject* fsObjB = FileSystemObject::retrieve(b.objId);
-        if (!fsObjA) //invalid rows shall appear at the end
-            return false;
-        else if (!fsObjB)
-            return true;
+    using Key = decltype(getKey(static_cast<const FileSystemObject*>(nullptr), size_t()));
 
-        return lessFilesize<ascending, side>(*fsObjA, *fsObjB);
-    }
-};
+    std::vector<std::pair<Key, RefIndex>> keys;
+    keys.reserve(sortedRef.size());
+    for (const RefIndex& ref : sortedRef)
+        keys.emplace_back(getKey(FileSystemObject::retrieve(ref.objId), ref.folderIndex), ref); //invalid rows: nullptr
 
+    parallelSort(keys, [&](const std::pair<Key, RefIndex>& lhs, const std::pair<Key, RefIndex>& rhs) { return lessKey(lhs.first, rhs.first); });
 
-template <bool ascending, SelectedSide side>
-struct GridView::LessFiletime
-{
-    bool operator()(const RefIndex a, const RefIndex b) const
-    {
-        const FileSystemObject* fsObjA = FileSystemObject::retrieve(a.objId);
-        const FileSystemObject* fsObjB = FileSystemObject::retrieve(b.objId);
-        if (!fsObjA) //invalid rows shall appear at the end
-            return false;
-        else if (!fsObjB)
-            return true;
-
-        return lessFiletime<ascending, side>(*fsObjA, *fsObjB);
-    }
-};
+    for (size_t i = 0; i < keys.size(); ++i)
+        sortedRef[i] = keys[i].second;
+}
 
 
-template <bool ascending, SelectedSide side>
-struct GridView::LessExtension
+template <SelectedSide side, class RefIndex>
+void sortByFullPath(std::vector<RefIndex>& sortedRef, bool ascending)
 {
-    bool operator()(const RefIndex a, const RefIndex b) const
-    {
-        const FileSystemObject* fsObjA = FileSystemObject::retrieve(a.objId);
-        const FileSystemObject* fsObjB = FileSystemObject::retrieve(b.objId);
-        if (!fsObjA) //invalid rows shall appear at the end
-            return false;
-        else if (!fsObjB)
-            return true;
+    std::map<size_t, Zstring> baseFolderPfs; //display path per folder pair index: referenced by the keys!
 
-        return lessExtension<ascending, side>(*fsObjA, *fsObjB);
-    }
-};
+    sortByKey(sortedRef, [&](const FileSystemObject* fsObj, size_t folderIndex)
+    {
+        if (!fsObj)
+            return getFullPathKey<side>(nullptr, Zstring());
+
+        auto it = baseFolderPfs.find(folderIndex);
+        if (it == baseFolderPfs.end())
+            it = baseFolderPfs.emplace(folderIndex, getBaseFolderDisplayPf<side>(fsObj->base())).first;
+        return getFullPathKey<side>(fsObj, it->second);
+    },
+    [ascending](const FullPathKey& a, const FullPathKey& b) { return lessFullPath(a, b, ascending); });
+}
+}
 
 
 template <bool ascending>
@@ -491,38 +467,28 @@ void GridView::sortView(ColumnTypeRim type, bool onLeft, bool ascending)
     switch (type)
     {
         case COL_TYPE_FULL_PATH:
-            if      ( ascending &&  onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessFullPath<true,  LEFT_SIDE >());
-            else if ( ascending && !onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessFullPath<true,  RIGHT_SIDE>());
-            else if (!ascending &&  onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessFullPath<false, LEFT_SIDE >());
-            else if (!ascending && !onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessFullPath<false, RIGHT_SIDE>());
+            if (onLeft) sortByFullPath<LEFT_SIDE >(sortedRef, ascending);
+            else        sortByFullPath<RIGHT_SIDE>(sortedRef, ascending);
             break;
         case COL_TYPE_REL_FOLDER:
-            if      ( ascending) std::sort(sortedRef.begin(), sortedRef.end(), LessRelativeFolder<true>());
-            else if (!ascending) std::sort(sortedRef.begin(), sortedRef.end(), LessRelativeFolder<false>());
+            sortByKey(sortedRef, [](const FileSystemObject* fsObj, size_t folderIndex) { return getRelativeFolderKey(fsObj, folderIndex); },
+            [ascending](const RelativeFolderKey& a, const RelativeFolderKey& b) { return lessRelativeFolder(a, b, ascending); });
             break;
         case COL_TYPE_FILENAME:
-            if      ( ascending &&  onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessShortFileName<true,  LEFT_SIDE >());
-            else if ( ascending && !onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessShortFileName<true,  RIGHT_SIDE>());
-            else if (!ascending &&  onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessShortFileName<false, LEFT_SIDE >());
-            else if (!ascending && !onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessShortFileName<false, RIGHT_SIDE>());
+            sortByKey(sortedRef, [onLeft](const FileSystemObject* fsObj, size_t /*folderIndex*/) { return onLeft ? getFileNameKey<LEFT_SIDE>(fsObj) : getFileNameKey<RIGHT_SIDE>(fsObj); },
+            [ascending](const FileNameKey& a, const FileNameKey& b) { return lessFileName(a, b, ascending); });
             break;
         case COL_TYPE_SIZE:
-            if      ( ascending &&  onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessFilesize<true,  LEFT_SIDE >());
-            else if ( ascending && !onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessFilesize<true,  RIGHT_SIDE>());
-            else if (!ascending &&  onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessFilesize<false, LEFT_SIDE >());
-            else if (!ascending && !onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessFilesize<false, RIGHT_SIDE>());
+            sortByKey(sortedRef, [onLeft](const FileSystemObject* fsObj, size_t /*folderIndex*/) { return onLeft ? getFileSizeKey<LEFT_SIDE>(fsObj) : getFileSizeKey<RIGHT_SIDE>(fsObj); },
+            [ascending](const FileSizeKey& a, const FileSizeKey& b) { return lessFileSize(a, b, ascending); });
             break;
         case COL_TYPE_DATE:
-            if      ( ascending &&  onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessFiletime<true,  LEFT_SIDE >());
-            else if ( ascending && !onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessFiletime<true,  RIGHT_SIDE>());
-            else if (!ascending &&  onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessFiletime<false, LEFT_SIDE >());
-            else if (!ascending && !onLeft) std::sort(sortedRef.begin(), sortedRef.end(), LessFiletime<false, RIGHT_SIDE>());
+            sortByKey(sortedRef, [onLeft](const FileSystemObject* fsObj, size_t /*folderIndex*/) { return onLeft ? getFileTimeKey<LEFT_SIDE>(fsObj) : getFileTimeKey<RIGHT_SIDE>(fsObj); },
+            [ascending](const FileTimeKey& a, const FileTimeKey& b) { return lessFileTime(a, b, ascending); });
             break;
         case COL_TYPE_EXTENSION:
-            if      ( ascending &&  onLeft) std::stable_sort(sortedRef.begin(), sortedRef.end(), LessExtension<true,  LEFT_SIDE >());
-            else if ( ascending && !onLeft) std::stable_sort(sortedRef.begin(), sortedRef.end(), LessExtension<true,  RIGHT_SIDE>());
-            else if (!ascending &&  onLeft) std::stable_sort(sortedRef.begin(), sortedRef.end(), LessExtension<false, LEFT_SIDE >());
-            else if (!ascending && !onLeft) std::stable_sort(sortedRef.begin(), sortedRef.end(), LessExtension<false, RIGHT_SIDE>());
+            sortByKey(sortedRef, [onLeft](const FileSystemObject* fsObj, size_t /*folderIndex*/) { return onLeft ? getExtensionKey<LEFT_SIDE>(fsObj) : getExtensionKey<RIGHT_SIDE>(fsObj); },
+            [ascending](const ExtensionKey& a, const ExtensionKey& b) { return lessExtension(a, b, ascending); });
             break;
         //case SORT_BY_CMP_RESULT:
         //    if      ( ascending) std::stable_sort(sortedRef.begin(), sortedRef.end(), LessCmpResult<true >());
@@ -155,24 +155,6 @@ private:
     class SerializeHierarchy;
 
     //sorting classes
-    template <bool ascending, SelectedSide side>
-    struct LessFullPath;
-
-    template <bool ascending>
-    struct LessRelativeFolder;
-
-    template <bool ascending, SelectedSide side>
-    struct LessShortFileName;
-
-    template <bool ascending, SelectedSide side>
-    struct LessFilesize;
-
-    template <bool ascending, SelectedSide side>
-    struct LessFiletime;
-
-    template <bool ascending, SelectedSide side>
-    struct LessExtension;
-
     template <bool ascending>
     struct LessCmpResult;
 
@@ -2705,8 +2705,11 @@ void MainDialog::removeObsoleteCfgHistoryItems(const std::vector<Zstring>& fileP
         //check existence of all config files in parallel!
         std::list<std::future<bool>> fileEx;
 
+        AsyncCancellation cancellation;
+        ZEN_ON_SCOPE_EXIT(cancellation.cancel()); //don't keep pool threads busy with checks no one is waiting for
+
         for (const Zstring& filePath : filePaths)
-            fileEx.push_back(zen::runAsync([=] { return somethingExists(filePath); }));
+            fileEx.push_back(zen::runAsync([=] { return somethingExists(filePath); }, &cancellation));
 
         //potentially slow network access => limit maximum wait time!
         wait_for_all_timed(fileEx.begin(), fileEx.end(), std::chrono::milliseconds(1000));
@@ -3693,6 +3696,14 @@ void MainDialog::OnCompare(wxCommandEvent& event)
         folderCmp = compare(globalCfg.optDialogs,
                             true, //allowUserInteraction
                             globalCfg.runWithBackgroundPriority,
+                            globalCfg.traverserThreadsPerFolder,
+                            globalCfg.traverserStatQueueDepth,
+                            globalCfg.traverserStatQueueDepthPerFolder,
+                            globalCfg.useScanIndex,
+                            nullptr, //changeList
+                            globalCfg.contentCmpThreads,
+                            globalCfg.contentCmpThreadsPerDevice,
+                            globalCfg.contentCmpSampling,
                             globalCfg.createLockFile,
                             dirLocks,
                             cmpConfig,
@@ -3907,6 +3918,7 @@ void MainDialog::OnStartSync(wxCommandEvent& event)
                     globalCfg.copyFilePermissions,
                     globalCfg.failsafeFileCopy,
                     globalCfg.runWithBackgroundPriority,
+                    globalCfg.fileCopyThreads,
                     syncProcessCfg,
                     folderCmp,
                     statusHandler);
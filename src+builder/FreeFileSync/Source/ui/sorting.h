@@ -7,6 +7,7 @@
 #ifndef SORTING_H_82574232452345
 #define SORTING_H_82574232452345
 
+#include <array>
 #include <zen/type_tools.h>
 #include "../file_hierarchy.h"
 
@@ -23,159 +24,335 @@ struct CompileTimeReminder : public FSObjectVisitor
 } checkDymanicCasts; //just a compile-time reminder to manually check dynamic casts in this file when needed
 }
 
+/*
+Sort keys: extracted once per row, then sorted instead of the rows
+    - comparisons need no FileSystemObject::retrieve() hash lookups, no dynamic casts and no temporary strings
+    - keys reference strings owned by the FileSystemObjects: folder comparison must not change until sorting is done
+    - "group" is always sorted ascending, e.g. empty rows last regardless of sort direction
+    - fsObj == nullptr: invalid row => always last
+*/
+
+using StrSegment = std::pair<const Zchar*, size_t>;
+
+inline StrSegment toSegment(const Zstring& str) { return { str.c_str(), str.size() }; }
+
+//compare the concatenations "lhs[0] + lhs[1] + ..." and "rhs[0] + rhs[1] + ..." without creating them: cmpFilePath() compares char-wise
+template <size_t N> inline
+int cmpFilePathConcat(const std::array<StrSegment, N>& lhs, const std::array<StrSegment, N>& rhs)
+{
+    size_t idxL = 0, posL = 0;
+    size_t idxR = 0, posR = 0;
+    for (;;)
+    {
+        while (idxL < N && posL == lhs[idxL].second) { ++idxL; posL = 0; }
+        while (idxR < N && posR == rhs[idxR].second) { ++idxR; posR = 0; }
+
+        if (idxL == N || idxR == N)
+            return static_cast<int>(idxL != N) - static_cast<int>(idxR != N);
+
+        const size_t len = std::min(lhs[idxL].second - posL, rhs[idxR].second - posR);
+        const int rv = cmpFilePath(lhs[idxL].first + posL, len, rhs[idxR].first + posR, len);
+        if (rv != 0)
+            return rv;
+        posL += len;
+        posR += len;
+    }
+}
+
 
 inline
-bool isDirectoryPair(const FileSystemObject& fsObj)
+const Zstring& getPairItemNameRef(const FileSystemObject& fsObj) //like getPairItemName() without a copy
 {
-    return dynamic_cast<const FolderPair*>(&fsObj) != nullptr;
+    return fsObj.isEmpty<LEFT_SIDE>() ? fsObj.getItemName<RIGHT_SIDE>() : fsObj.getItemName<LEFT_SIDE>();
 }
 
+//-------------------------------------------------------------------------------------------------------
 
-template <bool ascending, SelectedSide side> inline
-bool lessShortFileName(const FileSystemObject& a, const FileSystemObject& b)
+struct FullPathKey
 {
-    //sort order: first files/symlinks, then directories then empty rows
+    const Zstring* baseFolderPf = nullptr; //
+    const Zstring* relFolderPf  = nullptr; //concatenation: display path of the item
+    const Zstring* itemName     = nullptr; //
+    unsigned char group = 0;
+};
+
+
+//item display path == base folder display path + separator + relative path, see AbstractFileSystem::appendPaths()
+template <SelectedSide side> inline
+Zstring getBaseFolderDisplayPf(const BaseFolderPair& baseFolder)
+{
+    Zstring displayPath = utfCvrtTo<Zstring>(AFS::getDisplayPath(baseFolder.getAbstractPath<side>()));
+    return displayPath.empty() ? displayPath : appendSeparator(std::move(displayPath));
+}
 
-    //empty rows always last
-    if (a.isEmpty<side>())
-        return false;
-    else if (b.isEmpty<side>())
-        return true;
 
-    //directories after files/symlinks:
-    if (isDirectoryPair(a))
+template <SelectedSide side> inline
+FullPathKey getFullPathKey(const FileSystemObject* fsObj, const Zstring& baseFolderPf)
+{
+    FullPathKey key;
+    if (!fsObj)
+        key.group = 2;
+    else if (fsObj->isEmpty<side>()) //empty rows always last
+        key.group = 1;
+    else
     {
-        if (!isDirectoryPair(b))
-            return false;
+        key.baseFolderPf = &baseFolderPf;
+        key.relFolderPf  = &fsObj->parent().getPairRelativePathPf();
+        key.itemName     = &fsObj->getItemName<side>();
     }
-    else if (isDirectoryPair(b))
-        return true;
-
-    //sort directories and files/symlinks by short name
-    return makeSortDirection(LessFilePath(), Int2Type<ascending>())(a.getItemName<side>(), b.getItemName<side>());
+    return key;
 }
 
 
-template <bool ascending, SelectedSide side> inline
-bool lessFullPath(const FileSystemObject& a, const FileSystemObject& b)
+inline
+bool lessFullPath(const FullPathKey& a, const FullPathKey& b, bool ascending)
 {
-    //empty rows always last
-    if (a.isEmpty<side>())
+    if (a.group != b.group)
+        return a.group < b.group;
+    if (a.group != 0)
         return false;
-    else if (b.isEmpty<side>())
-        return true;
 
-    return makeSortDirection(LessFilePath(), Int2Type<ascending>())(AFS::getDisplayPath(a.getAbstractPath<side>()),
-                                                                    AFS::getDisplayPath(b.getAbstractPath<side>()));
+    const int rv = cmpFilePathConcat<3>({{ toSegment(*a.baseFolderPf), toSegment(*a.relFolderPf), toSegment(*a.itemName) }},
+                                        {{ toSegment(*b.baseFolderPf), toSegment(*b.relFolderPf), toSegment(*b.itemName) }});
+    return ascending ? rv < 0 : rv > 0;
 }
 
+//-------------------------------------------------------------------------------------------------------
+
+struct RelativeFolderKey
+{
+    size_t folderIndex = 0;
+    const Zstring* relFolderPf  = nullptr; //postfixed or empty
+    const Zstring* pairItemName = nullptr;
+    bool isFolder = false;
+    unsigned char group = 0;
+};
+
 
-template <bool ascending>  inline //side currently unused!
-bool lessRelativeFolder(const FileSystemObject& a, const FileSystemObject& b)
+inline //side currently unused!
+RelativeFolderKey getRelativeFolderKey(const FileSystemObject* fsObj, size_t folderIndex)
 {
-    const bool isDirectoryA = isDirectoryPair(a);
-    const Zstring& relFolderA = isDirectoryA ?
-                                a.getPairRelativePath() : //directory
-                                beforeLast(a.getPairRelativePath(), FILE_NAME_SEPARATOR, IF_MISSING_RETURN_NONE);
+    RelativeFolderKey key;
+    if (!fsObj)
+        key.group = 1;
+    else
+    {
+        key.folderIndex  = folderIndex;
+        key.relFolderPf  = &fsObj->parent().getPairRelativePathPf();
+        key.pairItemName = &getPairItemNameRef(*fsObj);
+        key.isFolder     = dynamic_cast<const FolderPair*>(fsObj) != nullptr;
+    }
+    return key;
+}
 
-    const bool isDirectoryB = isDirectoryPair(b);
-    const Zstring& relFolderB = isDirectoryB ?
-                                b.getPairRelativePath() : //directory
-                                beforeLast(b.getPairRelativePath(), FILE_NAME_SEPARATOR ,IF_MISSING_RETURN_NONE);
+
+inline
+bool lessRelativeFolder(const RelativeFolderKey& a, const RelativeFolderKey& b, bool ascending)
+{
+    if (a.group != b.group)
+        return a.group < b.group;
+    if (a.group != 0)
+        return false;
+
+    //presort by folder pair
+    if (a.folderIndex != b.folderIndex)
+        return ascending ?
+               a.folderIndex < b.folderIndex :
+               a.folderIndex > b.folderIndex;
+
+    //relative folder: path of a directory, parent path of files/symlinks
+    auto getRelFolder = [](const RelativeFolderKey& key) -> std::array<StrSegment, 2>
+    {
+        if (key.isFolder)
+            return {{ toSegment(*key.relFolderPf), toSegment(*key.pairItemName) }};
+        return {{ StrSegment(key.relFolderPf->c_str(), key.relFolderPf->empty() ? 0 : key.relFolderPf->size() - 1), StrSegment(nullptr, 0) }};
+    };
 
     //compare relative names without filepaths first
-    const int rv = cmpFilePath(relFolderA.c_str(), relFolderA.size(),
-                               relFolderB.c_str(), relFolderB.size());
+    const int rv = cmpFilePathConcat(getRelFolder(a), getRelFolder(b));
     if (rv != 0)
-        return makeSortDirection(std::less<int>(), Int2Type<ascending>())(rv, 0);
+        return ascending ? rv < 0 : rv > 0;
 
     //compare the filepaths
-    if (isDirectoryB) //directories shall appear before files
+    if (b.isFolder) //directories shall appear before files
         return false;
-    else if (isDirectoryA)
+    else if (a.isFolder)
         return true;
 
-    return LessFilePath()(a.getPairItemName(), b.getPairItemName());
+    return LessFilePath()(*a.pairItemName, *b.pairItemName);
 }
 
+//-------------------------------------------------------------------------------------------------------
 
-template <bool ascending, SelectedSide side> inline
-bool lessFilesize(const FileSystemObject& a, const FileSystemObject& b)
+struct FileNameKey
 {
-    //empty rows always last
-    if (a.isEmpty<side>())
-        return false;
-    else if (b.isEmpty<side>())
-        return true;
+    const Zstring* itemName = nullptr;
+    unsigned char group = 0;
+};
+
 
-    //directories second last
-    if (isDirectoryPair(a))
+template <SelectedSide side> inline
+FileNameKey getFileNameKey(const FileSystemObject* fsObj)
+{
+    //sort order: first files/symlinks, then directories then empty rows
+    FileNameKey key;
+    if (!fsObj)
+        key.group = 3;
+    else if (fsObj->isEmpty<side>())
+        key.group = 2;
+    else
+    {
+        key.group = dynamic_cast<const FolderPair*>(fsObj) ? 1 : 0;
+        key.itemName = &fsObj->getItemName<side>();
+    }
+    return key;
+}
+
+
+inline
+bool lessFileName(const FileNameKey& a, const FileNameKey& b, bool ascending)
+{
+    if (a.group != b.group)
+        return a.group < b.group;
+    if (a.group >= 2)
         return false;
-    else if (isDirectoryPair(b))
-        return true;
 
-    const FilePair* fileA = dynamic_cast<const FilePair*>(&a);
-    const FilePair* fileB = dynamic_cast<const FilePair*>(&b);
+    //sort directories and files/symlinks by short name
+    return ascending ?
+           LessFilePath()(*a.itemName, *b.itemName) :
+           LessFilePath()(*b.itemName, *a.itemName);
+}
+
+//-------------------------------------------------------------------------------------------------------
+
+struct FileSizeKey
+{
+    std::uint64_t fileSize = 0;
+    unsigned char group = 0;
+};
+
+
+template <SelectedSide side> inline
+FileSizeKey getFileSizeKey(const FileSystemObject* fsObj)
+{
+    //sort order: files, then symlinks, then directories, then empty rows
+    FileSizeKey key;
+    if (!fsObj)
+        key.group = 4;
+    else if (fsObj->isEmpty<side>())
+        key.group = 3;
+    else if (dynamic_cast<const FolderPair*>(fsObj))
+        key.group = 2;
+    else if (const FilePair* file = dynamic_cast<const FilePair*>(fsObj))
+        key.fileSize = file->getFileSize<side>();
+    else
+        key.group = 1;
+    return key;
+}
 
-    //then symlinks
-    if (!fileA)
+
+inline
+bool lessFileSize(const FileSizeKey& a, const FileSizeKey& b, bool ascending)
+{
+    if (a.group != b.group)
+        return a.group < b.group;
+    if (a.group != 0)
         return false;
-    else if (!fileB)
-        return true;
 
     //return list beginning with largest files first
-    return makeSortDirection(std::less<>(), Int2Type<ascending>())(fileA->getFileSize<side>(), fileB->getFileSize<side>());
+    return ascending ?
+           a.fileSize < b.fileSize :
+           a.fileSize > b.fileSize;
 }
 
+//-------------------------------------------------------------------------------------------------------
 
-template <bool ascending, SelectedSide side> inline
-bool lessFiletime(const FileSystemObject& a, const FileSystemObject& b)
+struct FileTimeKey
 {
-    if (a.isEmpty<side>())
-        return false; //empty rows always last
-    else if (b.isEmpty<side>())
-        return true; //empty rows always last
+    std::int64_t lastWriteTime = 0;
+    unsigned char group = 0;
+};
 
-    const FilePair* fileA = dynamic_cast<const FilePair*>(&a);
-    const FilePair* fileB = dynamic_cast<const FilePair*>(&b);
 
-    const SymlinkPair* symlinkA = dynamic_cast<const SymlinkPair*>(&a);
-    const SymlinkPair* symlinkB = dynamic_cast<const SymlinkPair*>(&b);
+template <SelectedSide side> inline
+FileTimeKey getFileTimeKey(const FileSystemObject* fsObj)
+{
+    //sort order: files/symlinks, then directories, then empty rows
+    FileTimeKey key;
+    if (!fsObj)
+        key.group = 3;
+    else if (fsObj->isEmpty<side>())
+        key.group = 2;
+    else if (const FilePair* file = dynamic_cast<const FilePair*>(fsObj))
+        key.lastWriteTime = file->getLastWriteTime<side>();
+    else if (const SymlinkPair* symlink = dynamic_cast<const SymlinkPair*>(fsObj))
+        key.lastWriteTime = symlink->getLastWriteTime<side>();
+    else
+        key.group = 1;
+    return key;
+}
 
-    if (!fileA && !symlinkA)
-        return false; //directories last
-    else if (!fileB && !symlinkB)
-        return true; //directories last
 
-    const std::int64_t dateA = fileA ? fileA->getLastWriteTime<side>() : symlinkA->getLastWriteTime<side>();
-    const std::int64_t dateB = fileB ? fileB->getLastWriteTime<side>() : symlinkB->getLastWriteTime<side>();
+inline
+bool lessFileTime(const FileTimeKey& a, const FileTimeKey& b, bool ascending)
+{
+    if (a.group != b.group)
+        return a.group < b.group;
+    if (a.group != 0)
+        return false;
 
     //return list beginning with newest files first
-    return makeSortDirection(std::less<>(), Int2Type<ascending>())(dateA, dateB);
+    return ascending ?
+           a.lastWriteTime < b.lastWriteTime :
+           a.lastWriteTime > b.lastWriteTime;
 }
 
+//-------------------------------------------------------------------------------------------------------
 
-template <bool ascending, SelectedSide side> inline
-bool lessExtension(const FileSystemObject& a, const FileSystemObject& b)
+struct ExtensionKey
 {
-    if (a.isEmpty<side>())
-        return false; //empty rows always last
-    else if (b.isEmpty<side>())
-        return true; //empty rows always last
+    StrSegment extension; //part of the item name
+    unsigned char group = 0;
+};
 
-    if (dynamic_cast<const FolderPair*>(&a))
-        return false; //directories last
-    else if (dynamic_cast<const FolderPair*>(&b))
-        return true; //directories last
 
-    auto getExtension = [](const FileSystemObject& fsObj)
+template <SelectedSide side> inline
+ExtensionKey getExtensionKey(const FileSystemObject* fsObj)
+{
+    //sort order: files/symlinks, then directories, then empty rows
+    ExtensionKey key;
+    if (!fsObj)
+        key.group = 3;
+    else if (fsObj->isEmpty<side>())
+        key.group = 2;
+    else if (dynamic_cast<const FolderPair*>(fsObj))
+        key.group = 1;
+    else
     {
-        return afterLast(fsObj.getItemName<side>(), Zchar('.'), zen::IF_MISSING_RETURN_NONE);
-    };
+        const Zstring& itemName = fsObj->getItemName<side>();
+        const size_t pos = itemName.rfind(Zchar('.'));
+        key.extension = pos == Zstring::npos ?
+                        StrSegment(itemName.c_str() + itemName.size(), 0) :
+                        StrSegment(itemName.c_str() + pos + 1, itemName.size() - pos - 1);
+    }
+    return key;
+}
+
+
+inline
+bool lessExtension(const ExtensionKey& a, const ExtensionKey& b, bool ascending)
+{
+    if (a.group != b.group)
+        return a.group < b.group;
+    if (a.group != 0)
+        return false;
 
-    return makeSortDirection(LessFilePath(), Int2Type<ascending>())(getExtension(a), getExtension(b));
+    const int rv = cmpFilePath(a.extension.first, a.extension.second,
+                               b.extension.first, b.extension.second);
+    return ascending ? rv < 0 : rv > 0;
 }
 
+//-------------------------------------------------------------------------------------------------------
 
 template <bool ascending> inline
 bool lessCmpResult(const FileSystemObject& a, const FileSystemObject& b)
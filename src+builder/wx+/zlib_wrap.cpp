@@ -5,6 +5,10 @@
 // **************************************************************************
 
 #include "zlib_wrap.h"
+#include <mutex>
+#include <atomic>
+#include <zen/thread.h>
+#include <zen/scope_guard.h>
 #ifdef ZEN_WIN
     #include <wx/../../src/zlib/zlib.h> //not really a "nice" place to look for a stable solution
 #elif defined ZEN_LINUX || defined ZEN_MAC
@@ -52,3 +56,61 @@ size_t zen::impl::zlib_decompress(const void* src, size_t srcLen, void* trg, siz
         throw ZlibInternalError();
     return bufferSize;
 }
+
+
+namespace
+{
+//helper threads shared by all concurrent runParallel() calls: e.g. db_file.cpp (de-)compresses three streams at once
+std::atomic<size_t> helpersActive{ 0 };
+
+size_t acquireHelpers(size_t helpersWanted)
+{
+    const size_t helpersMax = std::max(std::thread::hardware_concurrency(), 1U) - 1; //the calling thread works, too
+
+    size_t active = helpersActive;
+    for (;;)
+    {
+        const size_t helpersGranted = std::min(helpersWanted, helpersMax - std::min(active, helpersMax));
+        if (helpersActive.compare_exchange_weak(active, active + helpersGranted))
+            return helpersGranted;
+    }
+}
+}
+
+
+void zen::impl::runParallel(size_t taskCount, const std::function<void(size_t taskIdx)>& task) //throw X
+{
+    std::atomic<size_t> nextTask(0);
+    std::exception_ptr firstError;
+    std::mutex lockError;
+
+    auto runTasks = [&]
+    {
+        for (size_t taskIdx = nextTask++; taskIdx < taskCount; taskIdx = nextTask++)
+            try
+            {
+                task(taskIdx); //throw X
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> dummy(lockError);
+                if (!firstError)
+                    firstError = std::current_exception();
+                nextTask = taskCount; //skip remaining tasks
+            }
+    };
+
+    const size_t helperCount = taskCount > 1 ? acquireHelpers(taskCount - 1) : 0;
+    ZEN_ON_SCOPE_EXIT(helpersActive -= helperCount);
+    {
+        std::vector<std::future<void>> helpers;
+        ZEN_ON_SCOPE_EXIT(for (std::future<void>& ft : helpers) ft.wait(); ); //tasks reference the caller's stack!
+
+        for (size_t i = 0; i < helperCount; ++i) //current thread is the first worker
+            helpers.push_back(runAsyncCompute(runTasks)); //pool threads: runTasks() doesn't throw
+        runTasks();
+    }
+
+    if (firstError)
+        std::rethrow_exception(firstError);
+}
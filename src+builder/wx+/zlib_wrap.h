@@ -7,6 +7,7 @@
 #ifndef ZLIB_WRAP_H_428597064566
 #define ZLIB_WRAP_H_428597064566
 
+#include <limits>
 #include <zen/serialize.h>
 
 
@@ -24,6 +25,14 @@ BinContainer compress(const BinContainer& stream, int level); //throw ZlibIntern
 template <class BinContainer>
 BinContainer decompress(const BinContainer& stream);          //throw ZlibInternalError
 
+//large streams: compress chunks of CHUNK_SIZE_PARALLEL bytes independently, using one thread per CPU core
+//caveat: output format differs from compress()! => use decompressParallel()
+template <class BinContainer>
+BinContainer compressParallel(const BinContainer& stream, int level); //throw ZlibInternalError
+
+template <class BinContainer>
+BinContainer decompressParallel(const BinContainer& stream);          //throw ZlibInternalError
+
 
 
 
@@ -40,6 +49,31 @@ namespace impl
 size_t zlib_compressBound(size_t len);
 size_t zlib_compress  (const void* src, size_t srcLen, void* trg, size_t trgLen, int level); //throw ZlibInternalError
 size_t zlib_decompress(const void* src, size_t srcLen, void* trg, size_t trgLen);            //throw ZlibInternalError
+
+//run task(0) to task(taskCount - 1) on the calling thread + pool threads: at most one per CPU core across all concurrent calls
+//rethrows the first exception after all threads have finished
+void runParallel(size_t taskCount, const std::function<void(size_t taskIdx)>& task); //throw X
+
+const size_t CHUNK_SIZE_PARALLEL = 1024 * 1024; //compression ratio for zlib level 3 is on par with a single stream; smaller chunks lose some
+
+template <class Num, class BinContainer> inline
+void appendNumber(BinContainer& cont, Num num)
+{
+    const size_t oldSize = cont.size();
+    cont.resize(oldSize + sizeof(num));
+    std::copy(reinterpret_cast<const char*>(&num), reinterpret_cast<const char*>(&num) + sizeof(num), &*cont.begin() + oldSize);
+}
+
+template <class Num, class BinContainer> inline
+Num extractNumber(const BinContainer& cont, size_t& pos) //throw ZlibInternalError
+{
+    Num num = 0;
+    if (cont.size() < pos + sizeof(num))
+        throw ZlibInternalError();
+    std::copy(&*cont.begin() + pos, &*cont.begin() + pos + sizeof(num), reinterpret_cast<char*>(&num));
+    pos += sizeof(num);
+    return num;
+}
 }
 
 
@@ -109,6 +143,121 @@ BinContainer decompress(const BinContainer& stream) //throw ZlibInternalError
     }
     return contOut;
 }
+
+
+/*
+stream layout of compressParallel(): (use portable number types!)
+    std::uint64_t    uncompressed stream size
+    std::uint32_t    uncompressed chunk size: all chunks are full except for the last one
+    std::uint32_t    chunk count
+    std::uint64_t[]  compressed size of each chunk
+    ...              compressed chunks
+*/
+template <class BinContainer>
+BinContainer compressParallel(const BinContainer& stream, int level) //throw ZlibInternalError
+{
+    BinContainer contOut;
+    if (!stream.empty()) //don't dereference iterator into empty container!
+    {
+        const size_t chunkSize  = impl::CHUNK_SIZE_PARALLEL;
+        const size_t chunkCount = (stream.size() + chunkSize - 1) / chunkSize;
+
+        std::vector<BinContainer> chunksOut(chunkCount);
+
+        impl::runParallel(chunkCount, [&](size_t chunkIdx) //throw ZlibInternalError
+        {
+            const size_t chunkPos = chunkIdx * chunkSize;
+            const size_t chunkLen = std::min(chunkSize, stream.size() - chunkPos);
+
+            BinContainer& chunkOut = chunksOut[chunkIdx];
+            const size_t bufferEstimate = impl::zlib_compressBound(chunkLen); //upper limit for buffer size, larger than input size!!!
+            chunkOut.resize(bufferEstimate);
+
+            const size_t bytesWritten = impl::zlib_compress(&*stream.begin() + chunkPos,
+                                                            chunkLen,
+                                                            &*chunkOut.begin(),
+                                                            bufferEstimate,
+                                                            level); //throw ZlibInternalError
+            chunkOut.resize(bytesWritten);
+        });
+
+        impl::appendNumber<std::uint64_t>(contOut, stream.size());
+        impl::appendNumber<std::uint32_t>(contOut, static_cast<std::uint32_t>(chunkSize));
+        impl::appendNumber<std::uint32_t>(contOut, static_cast<std::uint32_t>(chunkCount));
+
+        size_t outSize = contOut.size() + chunkCount * sizeof(std::uint64_t);
+        for (const BinContainer& chunkOut : chunksOut)
+        {
+            impl::appendNumber<std::uint64_t>(contOut, chunkOut.size());
+            outSize += chunkOut.size();
+        }
+
+        size_t outPos = contOut.size();
+        contOut.resize(outSize);
+        for (const BinContainer& chunkOut : chunksOut)
+        {
+            std::copy(chunkOut.begin(), chunkOut.end(), contOut.begin() + outPos);
+            outPos += chunkOut.size();
+        }
+    }
+    return contOut;
+}
+
+
+template <class BinContainer>
+BinContainer decompressParallel(const BinContainer& stream) //throw ZlibInternalError
+{
+    BinContainer contOut;
+    if (!stream.empty()) //don't dereference iterator into empty container!
+    {
+        size_t pos = 0;
+        const std::uint64_t uncompressedSize = impl::extractNumber<std::uint64_t>(stream, pos); //throw ZlibInternalError
+        const size_t chunkSize               = impl::extractNumber<std::uint32_t>(stream, pos); //
+        const size_t chunkCount              = impl::extractNumber<std::uint32_t>(stream, pos); //
+
+        if (uncompressedSize == 0 || chunkSize == 0 || //cannot be 0: compressParallel() directly maps empty -> empty container skipping zlib!
+            uncompressedSize > std::numeric_limits<size_t>::max() || //32-bit: don't truncate
+            chunkCount != (uncompressedSize - 1) / chunkSize + 1 ||  //no overflow for huge sizes
+            chunkCount > (stream.size() - pos) / sizeof(std::uint64_t)) //table of compressed sizes must fit into the stream
+            throw ZlibInternalError();
+
+        std::vector<size_t> chunkPos; //position of each compressed chunk
+        std::vector<size_t> chunkLen; //
+        size_t dataPos = pos + chunkCount * sizeof(std::uint64_t);
+        for (size_t i = 0; i < chunkCount; ++i)
+        {
+            const std::uint64_t compressedLen = impl::extractNumber<std::uint64_t>(stream, pos); //throw ZlibInternalError
+            if (compressedLen == 0 || compressedLen > stream.size() - std::min<size_t>(dataPos, stream.size()))
+                throw ZlibInternalError();
+            chunkPos.push_back(dataPos);
+            chunkLen.push_back(static_cast<size_t>(compressedLen));
+            dataPos += static_cast<size_t>(compressedLen);
+        }
+
+        try
+        {
+            contOut.resize(static_cast<size_t>(uncompressedSize)); //throw std::bad_alloc
+        }
+        catch (std::bad_alloc&) //most likely due to data corruption!
+        {
+            throw ZlibInternalError();
+        }
+
+        impl::runParallel(chunkCount, [&](size_t chunkIdx) //throw ZlibInternalError
+        {
+            const size_t uncompressedPos = chunkIdx * chunkSize;
+            const size_t uncompressedLen = std::min(chunkSize, static_cast<size_t>(uncompressedSize) - uncompressedPos);
+
+            const size_t bytesWritten = impl::zlib_decompress(&*stream.begin() + chunkPos[chunkIdx],
+                                                              chunkLen[chunkIdx],
+                                                              &*contOut.begin() + uncompressedPos,
+                                                              uncompressedLen); //throw ZlibInternalError
+            if (bytesWritten != uncompressedLen)
+                throw ZlibInternalError();
+        });
+    }
+    return contOut;
+}
 }
 
 #endif //ZLIB_WRAP_H_428597064566
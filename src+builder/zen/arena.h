@@ -0,0 +1,112 @@
+// **************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under *
+// * GNU General Public License: http://www.gnu.org/licenses/gpl-3.0        *
+// * Copyright (C) Zenju (zenju AT gmx DOT de) - All Rights Reserved        *
+// **************************************************************************
+
+#ifndef ARENA_H_4389275098320745982
+#define ARENA_H_4389275098320745982
+
+#include <new>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+
+namespace zen
+{
+/*
+bump-pointer allocator for large numbers of small, long-lived objects (e.g. tree nodes of a folder comparison):
+    - memory is requested in big blocks and released all at once when the arena is destroyed => no per-object malloc overhead
+    - no deallocation of single objects: the owner still has to call their destructors!
+    - not thread-safe: use one arena per thread
+*/
+class Arena
+{
+public:
+    Arena() {}
+    ~Arena() { for (void* block : blocks_) ::operator delete(block); }
+
+    void* allocate(size_t bytes, size_t alignment) //throw std::bad_alloc
+    {
+        assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && alignment <= alignof(std::max_align_t));
+
+        size_t padding = (alignment - reinterpret_cast<std::uintptr_t>(pos_) % alignment) % alignment;
+        if (bytes + padding > static_cast<size_t>(end_ - pos_))
+        {
+            if (bytes > BLOCK_SIZE / 4) //don't waste the remainder of the current block
+                return allocateBlock(bytes); //throw std::bad_alloc
+
+            pos_ = static_cast<char*>(allocateBlock(BLOCK_SIZE)); //throw std::bad_alloc
+            end_ = pos_ + BLOCK_SIZE;
+            padding = 0; //::operator new() returns memory suitably aligned for any fundamental type
+        }
+
+        void* mem = pos_ + padding;
+        pos_ += padding + bytes;
+        return mem;
+    }
+
+    size_t getBytesReserved() const { return bytesReserved_; }
+
+private:
+    Arena           (const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocateBlock(size_t size) //throw std::bad_alloc
+    {
+        blocks_.reserve(blocks_.size() + 1); //don't leak "block" if push_back() throws
+        void* block = ::operator new(size); //throw std::bad_alloc
+        blocks_.push_back(block);
+        bytesReserved_ += size;
+        return block;
+    }
+
+    static const size_t BLOCK_SIZE = 128 * 1024;
+
+    char* pos_ = nullptr; //free range of the current block
+    char* end_ = nullptr; //
+    std::vector<void*> blocks_;
+    size_t bytesReserved_ = 0;
+};
+
+
+//STL allocator drawing from an Arena: deallocate() is a no-op => all instances compare equal, so containers may swap/move nodes
+//between different arenas as long as all of them outlive the containers
+template <class T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    typedef std::true_type is_always_equal;
+
+    template <class U> struct rebind { typedef ArenaAllocator<U> other; };
+
+    explicit ArenaAllocator(Arena& arena) : arena_(&arena) {}
+    template <class U> ArenaAllocator(const ArenaAllocator<U>& other) : arena_(&other.getArena()) {}
+
+    T* allocate(size_t n) //throw std::bad_alloc
+    {
+        if (n > static_cast<size_t>(-1) / sizeof(T))
+            throw std::bad_alloc();
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T))); //throw std::bad_alloc
+    }
+
+    void deallocate(T* /*p*/, size_t /*n*/) {} //memory is released together with the arena
+
+    Arena& getArena() const { return *arena_; }
+
+private:
+    Arena* arena_;
+};
+
+template <class T, class U> inline bool operator==(const ArenaAllocator<T>& /*lhs*/, const ArenaAllocator<U>& /*rhs*/) { return true; }
+template <class T, class U> inline bool operator!=(const ArenaAllocator<T>& /*lhs*/, const ArenaAllocator<U>& /*rhs*/) { return false; }
+}
+
+#endif //ARENA_H_4389275098320745982
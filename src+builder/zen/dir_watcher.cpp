@@ -22,7 +22,14 @@
     #include <fcntl.h> //fcntl
     #include <unistd.h> //close
     #include <limits.h> //NAME_MAX
+    #include <cstdlib> //realpath
+    #include <unordered_map>
+    #include <sys/stat.h>
+    #include <sys/fanotify.h>
+    #include <poll.h>
     #include "file_traverser.h"
+    #include "file_access.h"
+    #include "optional.h"
 
 #elif defined ZEN_MAC
     #include <CoreServices/CoreServices.h>
@@ -38,6 +45,17 @@ namespace
 class SharedData
 {
 public:
+    SharedData() :
+        changeEvent(::CreateEvent(nullptr,     //__in_opt  LPSECURITY_ATTRIBUTES lpEventAttributes,
+                                  true,        //__in      BOOL bManualReset,
+                                  false,       //__in      BOOL bInitialState,
+                                  nullptr)) {} //__in_opt  LPCTSTR lpName
+    //CreateEvent() failure is not critical: DirWatcher::waitForChanges() falls back to sleeping
+
+    ~SharedData() { if (changeEvent) ::CloseHandle(changeEvent); }
+
+    HANDLE getChangeEvent() const { return changeEvent; } //signaled while changes or errors are pending; may be nullptr
+
     //context of worker thread
     void addChanges(const char* buffer, DWORD bytesWritten, const Zstring& dirpath) //throw ()
     {
@@ -88,6 +106,7 @@ public:
                 bufPos += notifyInfo.NextEntryOffset;
             }
         }
+        if (changeEvent) ::SetEvent(changeEvent);
     }
 
     ////context of main thread
@@ -113,6 +132,7 @@ public:
 
         output.swap(changedFiles);
         changedFiles.clear();
+        if (changeEvent) ::ResetEvent(changeEvent);
     }
 
 
@@ -121,11 +141,13 @@ public:
     {
         std::lock_guard<std::mutex> dummy(lockAccess);
         errorInfo = ErrorInfo({ copyStringTo<BasicWString>(msg), copyStringTo<BasicWString>(description), errorCode });
+        if (changeEvent) ::SetEvent(changeEvent);
     }
 
 private:
     typedef Zbase<wchar_t> BasicWString; //thread safe string class for UI texts
 
+    const HANDLE changeEvent;
     std::mutex lockAccess;
     std::vector<DirWatcher::Entry> changedFiles;
 
@@ -371,38 +393,300 @@ std::vector<DirWatcher::Entry> DirWatcher::getChanges(const std::function<void()
 #elif defined ZEN_LINUX
 struct DirWatcher::Pimpl
 {
-    int notifDescr = 0;
+    ~Pimpl()
+    {
+        if (notifDescr    != -1) ::close(notifDescr); //associated watches are removed automatically!
+        if (fanDescr      != -1) ::close(fanDescr);
+        if (fanMountDescr != -1) ::close(fanMountDescr);
+    }
+
+    std::vector<char> eventBuffer = std::vector<char>(512 * (sizeof(struct ::inotify_event) + NAME_MAX + 1)); //allocate once: getChanges() is called at a high rate
+
+    //inotify: one watch per folder
+    int notifDescr = -1;
     std::map<int, Zstring> watchDescrs; //watch descriptor and (sub-)directory name (postfixed with separator) -> owned by "notifDescr"
+    std::map<Zstring, int, LessFilePath> watchedPaths; //reverse lookup: find watches of a sub tree
+
+    //add watches for a folder and all its sub folders that are not yet watched; report items found as "created"
+    void addWatchesRecursively(const Zstring& dirPath, std::vector<DirWatcher::Entry>* newItems); //throw FileError
+    void removeWatchesRecursively(const Zstring& dirPath);
+    void removeWatch(int wd);
+
+    //fanotify: a single mark for the whole file system, events are filtered by path => no setup cost per folder
+    int fanDescr = -1;
+    bool initFanotify(const Zstring& baseDirPath); //"false" if not supported by the kernel or missing privileges (CAP_SYS_ADMIN, CAP_DAC_READ_SEARCH)
+    std::vector<DirWatcher::Entry> getFanotifyChanges(const Zstring& baseDirPath); //throw FileError
+
+private:
+    bool addWatch(const Zstring& dirPath); //throw FileError; "false" if folder is not existing (anymore)
+
+    Opt<Zstring> getFolderPath(const struct ::file_handle& fh); //"no value" if folder is not existing anymore
+
+    int fanMountDescr = -1; //any folder on the marked file system: required by open_by_handle_at()
+    Zstring baseDirPathReal; //fanotify reports paths without symlinks
+    std::unordered_map<std::string, Zstring> folderPathBuf; //file handle => folder path
 };
 
 
-DirWatcher::DirWatcher(const Zstring& dirPath) : //throw FileError
-    baseDirPath(dirPath),
-    pimpl_(std::make_unique<Pimpl>())
+bool DirWatcher::Pimpl::initFanotify(const Zstring& baseDirPath)
+{
+#ifdef FAN_REPORT_DFID_NAME //requires Linux 5.9
+    bool success = false;
+    ZEN_ON_SCOPE_EXIT(if (!success)
+    {
+        if (fanDescr      != -1) { ::close(fanDescr);      fanDescr      = -1; }
+        if (fanMountDescr != -1) { ::close(fanMountDescr); fanMountDescr = -1; }
+    });
+
+    char* pathReal = ::realpath(baseDirPath.c_str(), nullptr);
+    if (!pathReal)
+        return false;
+    ZEN_ON_SCOPE_EXIT(::free(pathReal));
+    baseDirPathReal = pathReal;
+
+    fanMountDescr = ::open(baseDirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fanMountDescr == -1)
+        return false;
+
+    //check early if folder paths can be resolved: open_by_handle_at() requires CAP_DAC_READ_SEARCH
+    {
+        std::vector<char> buffer(sizeof(struct ::file_handle) + MAX_HANDLE_SZ);
+        struct ::file_handle& fh = reinterpret_cast<struct ::file_handle&>(buffer[0]);
+        fh.handle_bytes = MAX_HANDLE_SZ;
+        int mountId = 0;
+        if (::name_to_handle_at(fanMountDescr, "", &fh, &mountId, AT_EMPTY_PATH) != 0 ||
+            !getFolderPath(fh))
+            return false;
+    }
+
+    fanDescr = ::fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_NONBLOCK | FAN_CLOEXEC, O_RDONLY | O_LARGEFILE); //requires CAP_SYS_ADMIN
+    if (fanDescr == -1)
+        return false;
+
+    if (::fanotify_mark(fanDescr, FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+                        FAN_CREATE      |
+                        FAN_MODIFY      |
+                        FAN_CLOSE_WRITE |
+                        FAN_DELETE      |
+                        FAN_MOVED_FROM  |
+                        FAN_MOVED_TO    |
+                        FAN_ONDIR, //also report folders
+                        fanMountDescr, nullptr) != 0)
+        return false;
+
+    success = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+Opt<Zstring> DirWatcher::Pimpl::getFolderPath(const struct ::file_handle& fh)
+{
+    const std::string handleId(reinterpret_cast<const char*>(&fh), sizeof(fh) + fh.handle_bytes);
+
+    auto it = folderPathBuf.find(handleId);
+    if (it != folderPathBuf.end())
+        return it->second;
+
+    const int fd = ::open_by_handle_at(fanMountDescr, const_cast<struct ::file_handle*>(&fh), O_PATH | O_CLOEXEC);
+    if (fd == -1) //ESTALE: folder was deleted
+        return NoValue();
+    ZEN_ON_SCOPE_EXIT(::close(fd));
+
+    struct ::stat fileInfo = {};
+    if (::fstat(fd, &fileInfo) != 0 || fileInfo.st_nlink == 0) //folder was deleted, but is still referenced
+        return NoValue();
+
+    std::vector<char> buffer(10000);
+    const ssize_t bytesWritten = ::readlink(("/proc/self/fd/" + numberTo<std::string>(fd)).c_str(), &buffer[0], buffer.size());
+    if (bytesWritten < 0 || bytesWritten >= static_cast<ssize_t>(buffer.size())) //"readlink does not append a null byte to buf."
+        return NoValue();
+    const Zstring folderPath(&buffer[0], bytesWritten);
+
+    if (folderPathBuf.size() > 100000) //don't grow without bounds
+        folderPathBuf.clear();
+    folderPathBuf.emplace(handleId, folderPath);
+    return folderPath;
+}
+
+
+std::vector<DirWatcher::Entry> DirWatcher::Pimpl::getFanotifyChanges(const Zstring& baseDirPath) //throw FileError
 {
-    //get all subdirectories
-    std::vector<Zstring> fullFolderList { baseDirPath };
+    std::vector<Entry> output;
+#ifdef FAN_REPORT_DFID_NAME
+    ssize_t bytesRead = 0;
+    do
+    {
+        //non-blocking call, see FAN_NONBLOCK
+        bytesRead = ::read(fanDescr, &eventBuffer[0], eventBuffer.size()); //operator new: alignment suitable for fanotify_event_metadata
+    }
+    while (bytesRead < 0 && errno == EINTR); //"Interrupted function call; When this happens, you should try the call again."
+
+    if (bytesRead < 0)
     {
-        std::function<void (const Zstring& path)> traverse;
+        if (errno == EAGAIN)
+            return output;
 
-        traverse = [&traverse, &fullFolderList](const Zstring& path)
+        THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(baseDirPath)), L"read");
+    }
+
+    const Zstring baseDirPathRealPf = appendSeparator(baseDirPathReal);
+
+    auto evt = reinterpret_cast<const struct ::fanotify_event_metadata*>(&eventBuffer[0]);
+    for (; FAN_EVENT_OK(evt, bytesRead); evt = FAN_EVENT_NEXT(evt, bytesRead))
+    {
+        if (evt->vers != FANOTIFY_METADATA_VERSION)
+            throw FileError(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(baseDirPath)), L"fanotify: unexpected metadata version.");
+
+        if (evt->mask & FAN_Q_OVERFLOW) //events were dropped: report some "dummy" change (analog to Windows)
         {
-            traverseFolder(path, nullptr,
-            [&](const DirInfo& di ) { fullFolderList.push_back(di.fullPath); traverse(di.fullPath); },
-            nullptr, //don't traverse into symlinks (analog to windows build)
-            [&](const std::wstring& errorMsg) { throw FileError(errorMsg); });
-        };
+            output.emplace_back(ACTION_CREATE, Zstr("Overflow."));
+            continue;
+        }
 
-        traverse(baseDirPath);
+        //records: file system ID, handle of parent folder, item name
+        const char* const recordsEnd = reinterpret_cast<const char*>(evt) + evt->event_len;
+        for (const char* it = reinterpret_cast<const char*>(evt) + evt->metadata_len; it < recordsEnd;)
+        {
+            const auto& info = *reinterpret_cast<const struct ::fanotify_event_info_fid*>(it);
+            if (info.hdr.len == 0)
+                break;
+            it += info.hdr.len;
+
+            if (info.hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME)
+                continue;
+
+            const auto& fh = *reinterpret_cast<const struct ::file_handle*>(info.handle);
+            const char* itemName = reinterpret_cast<const char*>(fh.f_handle + fh.handle_bytes);
+
+            if (Opt<Zstring> parentPath = getFolderPath(fh))
+            {
+                //the file system mark reports all changes: filter by base folder
+                Zstring fullname;
+                if (*parentPath == baseDirPathReal)
+                    fullname = appendSeparator(baseDirPath) + itemName;
+                else if (pathStartsWith(*parentPath, baseDirPathRealPf))
+                    fullname = appendSeparator(baseDirPath) + afterFirst(*parentPath, baseDirPathRealPf, IF_MISSING_RETURN_NONE) + FILE_NAME_SEPARATOR + itemName;
+                else
+                    continue;
+
+                if (evt->mask & (FAN_CREATE | FAN_MOVED_TO))
+                    output.emplace_back(ACTION_CREATE, fullname);
+                else if (evt->mask & (FAN_MODIFY | FAN_CLOSE_WRITE))
+                    output.emplace_back(ACTION_UPDATE, fullname);
+                else if (evt->mask & (FAN_DELETE | FAN_MOVED_FROM))
+                    output.emplace_back(ACTION_DELETE, fullname);
+            }
+        }
+
+        if ((evt->mask & FAN_ONDIR) && (evt->mask & (FAN_MOVED_FROM | FAN_MOVED_TO | FAN_DELETE))) //buffered paths of this folder and its sub folders are outdated
+            folderPathBuf.clear();
     }
+#endif
+    return output;
+}
+
+
+bool DirWatcher::Pimpl::addWatch(const Zstring& dirPath) //throw FileError
+{
+    int wd = ::inotify_add_watch(notifDescr, dirPath.c_str(),
+                                 IN_ONLYDIR     | //"Only watch pathname if it is a directory."
+                                 IN_DONT_FOLLOW | //don't follow symbolic links
+                                 IN_CREATE      |
+                                 IN_MODIFY      |
+                                 IN_CLOSE_WRITE |
+                                 IN_DELETE      |
+                                 IN_DELETE_SELF |
+                                 IN_MOVED_FROM  |
+                                 IN_MOVED_TO    |
+                                 IN_MOVE_SELF);
+    if (wd == -1)
+    {
+        const ErrorCode ec = getLastError(); //copy before directly/indirectly making other system calls!
+        if (ec == ENOENT || ec == ENOTDIR) //folder was deleted (or replaced) in the meantime: its removal is reported by the parent's watch
+            return false;
+
+        if (ec == ENOSPC) //fix misleading system message "No space left on device"
+            throw FileError(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(dirPath)),
+                            formatSystemError(L"inotify_add_watch", ec, L"The user limit on the total number of inotify watches was reached or the kernel failed to allocate a needed resource."));
+
+        throw FileError(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(dirPath)), formatSystemError(L"inotify_add_watch", ec));
+    }
+
+    const Zstring dirPathPf = appendSeparator(dirPath);
+    auto it = watchedPaths.find(dirPathPf);
+    if (it != watchedPaths.end() && it->second != wd) //folder was replaced: old watch is removed automatically
+        watchDescrs.erase(it->second);
+
+    watchDescrs[wd] = dirPathPf; //same folder => same watch descriptor
+    watchedPaths[dirPathPf] = wd;
+    return true;
+}
+
+
+void DirWatcher::Pimpl::addWatchesRecursively(const Zstring& dirPath, std::vector<DirWatcher::Entry>* newItems) //throw FileError
+{
+    //add watch *before* reading the folder: items created in the meantime are either reported by the watch or found by the traversal
+    if (watchedPaths.find(appendSeparator(dirPath)) == watchedPaths.end())
+        if (!addWatch(dirPath)) //throw FileError
+            return;
+
+    std::vector<Zstring> subDirPaths;
+    traverseFolder(dirPath,
+    [&](const FileInfo&    fi) { if (newItems) newItems->emplace_back(DirWatcher::ACTION_CREATE, fi.fullPath); },
+    [&](const DirInfo&     di) { if (newItems) newItems->emplace_back(DirWatcher::ACTION_CREATE, di.fullPath); subDirPaths.push_back(di.fullPath); },
+    [&](const SymlinkInfo& si) { if (newItems) newItems->emplace_back(DirWatcher::ACTION_CREATE, si.fullPath); }, //don't traverse into symlinks (analog to windows build)
+    [&](const std::wstring& errorMsg)
+    {
+        if (dirExists(dirPath)) //ignore folders deleted in the meantime
+            throw FileError(errorMsg);
+    });
+
+    for (const Zstring& subDirPath : subDirPaths)
+        addWatchesRecursively(subDirPath, newItems); //throw FileError
+}
+
+
+void DirWatcher::Pimpl::removeWatchesRecursively(const Zstring& dirPath)
+{
+    //folder was moved away: watches would report items with outdated paths
+    const Zstring dirPathPf = appendSeparator(dirPath);
+    for (auto it = watchedPaths.lower_bound(dirPathPf); it != watchedPaths.end() && pathStartsWith(it->first, dirPathPf);)
+    {
+        ::inotify_rm_watch(notifDescr, it->second); //results in IN_IGNORED
+        watchDescrs.erase(it->second);
+        it = watchedPaths.erase(it);
+    }
+}
+
+
+void DirWatcher::Pimpl::removeWatch(int wd)
+{
+    auto it = watchDescrs.find(wd);
+    if (it != watchDescrs.end())
+    {
+        auto itPath = watchedPaths.find(it->second);
+        if (itPath != watchedPaths.end() && itPath->second == wd)
+            watchedPaths.erase(itPath);
+        watchDescrs.erase(it);
+    }
+}
+
+
+DirWatcher::DirWatcher(const Zstring& dirPath) : //throw FileError
+    baseDirPath(dirPath),
+    pimpl_(std::make_unique<Pimpl>())
+{
+    if (pimpl_->initFanotify(baseDirPath)) //no privileges? => fall back to inotify
+        return;
 
     //init
     pimpl_->notifDescr  = ::inotify_init();
     if (pimpl_->notifDescr == -1)
         THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(baseDirPath)), L"inotify_init");
 
-    ZEN_ON_SCOPE_FAIL( ::close(pimpl_->notifDescr); );
-
     //set non-blocking mode
     bool initSuccess = false;
     {
@@ -414,43 +698,21 @@ DirWatcher::DirWatcher(const Zstring& dirPath) : //throw FileError
         THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(baseDirPath)), L"fcntl");
 
     //add watches
-    for (const Zstring& subDirPath : fullFolderList)
-    {
-        int wd = ::inotify_add_watch(pimpl_->notifDescr, subDirPath.c_str(),
-                                     IN_ONLYDIR     | //"Only watch pathname if it is a directory."
-                                     IN_DONT_FOLLOW | //don't follow symbolic links
-                                     IN_CREATE      |
-                                     IN_MODIFY      |
-                                     IN_CLOSE_WRITE |
-                                     IN_DELETE      |
-                                     IN_DELETE_SELF |
-                                     IN_MOVED_FROM  |
-                                     IN_MOVED_TO    |
-                                     IN_MOVE_SELF);
-        if (wd == -1)
-        {
-            const ErrorCode ec = getLastError(); //copy before directly/indirectly making other system calls!
-            if (ec == ENOSPC) //fix misleading system message "No space left on device"
-                throw FileError(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(subDirPath)),
-                                formatSystemError(L"inotify_add_watch", ec, L"The user limit on the total number of inotify watches was reached or the kernel failed to allocate a needed resource."));
-
-            throw FileError(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(subDirPath)), formatSystemError(L"inotify_add_watch", ec));
-        }
-
-        pimpl_->watchDescrs.emplace(wd, appendSeparator(subDirPath));
-    }
+    pimpl_->addWatchesRecursively(baseDirPath, nullptr); //throw FileError
+    if (pimpl_->watchedPaths.empty())
+        throw FileError(replaceCpy(_("Cannot monitor directory %x."), L"%x", fmtPath(baseDirPath)), formatSystemError(L"inotify_add_watch", ENOENT));
 }
 
 
-DirWatcher::~DirWatcher()
-{
-    ::close(pimpl_->notifDescr); //associated watches are removed automatically!
-}
+DirWatcher::~DirWatcher() {}
 
 
 std::vector<DirWatcher::Entry> DirWatcher::getChanges(const std::function<void()>&) //throw FileError
 {
-    std::vector<char> buffer(512 * (sizeof(struct ::inotify_event) + NAME_MAX + 1));
+    if (pimpl_->fanDescr != -1)
+        return pimpl_->getFanotifyChanges(baseDirPath); //throw FileError
+
+    std::vector<char>& buffer = pimpl_->eventBuffer;
 
     ssize_t bytesRead = 0;
     do
@@ -475,6 +737,16 @@ std::vector<DirWatcher::Entry> DirWatcher::getChanges(const std::function<void()
     {
         struct ::inotify_event& evt = reinterpret_cast<struct ::inotify_event&>(buffer[bytePos]);
 
+        if (evt.mask & IN_Q_OVERFLOW) //events were dropped: report some "dummy" change (analog to Windows)
+        {
+            output.emplace_back(ACTION_CREATE, Zstr("Overflow."));
+            //lost events do not tell which folders were created: watch them now, existing watches are kept
+            pimpl_->addWatchesRecursively(baseDirPath, nullptr); //throw FileError
+        }
+
+        if (evt.mask & (IN_DELETE_SELF | IN_IGNORED)) //watched folder was deleted: watch is removed automatically
+            pimpl_->removeWatch(evt.wd);
+
         if (evt.len != 0) //exclude case: deletion of "self", already reported by parent directory watch
         {
             auto it = pimpl_->watchDescrs.find(evt.wd);
@@ -486,7 +758,12 @@ std::vector<DirWatcher::Entry> DirWatcher::getChanges(const std::function<void()
 
                 if ((evt.mask & IN_CREATE) ||
                     (evt.mask & IN_MOVED_TO))
+                {
                     output.emplace_back(ACTION_CREATE, fullname);
+
+                    if (evt.mask & IN_ISDIR) //new folder (or one moved into the watched tree): watch it, including sub folders
+                        pimpl_->addWatchesRecursively(fullname, &output); //throw FileError
+                }
                 else if ((evt.mask & IN_MODIFY) ||
                          (evt.mask & IN_CLOSE_WRITE))
                     output.emplace_back(ACTION_UPDATE, fullname);
@@ -494,7 +771,12 @@ std::vector<DirWatcher::Entry> DirWatcher::getChanges(const std::function<void()
                          (evt.mask & IN_DELETE_SELF) ||
                          (evt.mask & IN_MOVE_SELF  ) ||
                          (evt.mask & IN_MOVED_FROM))
+                {
                     output.emplace_back(ACTION_DELETE, fullname);
+
+                    if ((evt.mask & IN_MOVED_FROM) && (evt.mask & IN_ISDIR))
+                        pimpl_->removeWatchesRecursively(fullname);
+                }
             }
         }
         bytePos += sizeof(struct ::inotify_event) + evt.len;
@@ -613,3 +895,34 @@ std::vector<DirWatcher::Entry> DirWatcher::getChanges(const std::function<void()
     return changes;
 }
 #endif
+
+
+void DirWatcher::waitForChanges(const std::vector<const DirWatcher*>& watchers, std::chrono::milliseconds timeout) //noexcept
+{
+#ifdef ZEN_WIN
+    std::vector<HANDLE> events;
+    for (const DirWatcher* watcher : watchers)
+        if (HANDLE changeEvent = watcher->pimpl_->shared->getChangeEvent())
+            events.push_back(changeEvent);
+
+    if (!events.empty() && events.size() == watchers.size() && events.size() <= MAXIMUM_WAIT_OBJECTS)
+    {
+        ::WaitForMultipleObjects(static_cast<DWORD>(events.size()), //__in  DWORD nCount,
+                                 &events[0],                        //__in  const HANDLE *lpHandles,
+                                 false,                             //__in  BOOL bWaitAll,
+                                 static_cast<DWORD>(timeout.count())); //__in  DWORD dwMilliseconds; errors are handled like a timeout
+        return;
+    }
+#elif defined ZEN_LINUX
+    std::vector<struct ::pollfd> descriptors;
+    for (const DirWatcher* watcher : watchers)
+        descriptors.push_back({ watcher->pimpl_->fanDescr != -1 ? watcher->pimpl_->fanDescr : watcher->pimpl_->notifDescr, POLLIN, 0 });
+
+    if (!descriptors.empty())
+    {
+        ::poll(&descriptors[0], descriptors.size(), static_cast<int>(timeout.count())); //errors (e.g. EINTR) are handled like a timeout
+        return;
+    }
+#endif
+    std::this_thread::sleep_for(timeout);
+}
@@ -9,6 +9,7 @@
 
 #include <vector>
 #include <memory>
+#include <chrono>
 #include <functional>
 #include "file_error.h"
 
@@ -16,7 +17,8 @@
 namespace zen
 {
 //Windows: ReadDirectoryChangesW http://msdn.microsoft.com/en-us/library/aa365465(v=vs.85).aspx
-//Linux:   inotify               http://linux.die.net/man/7/inotify
+//Linux:   fanotify              http://man7.org/linux/man-pages/man7/fanotify.7.html -> requires CAP_SYS_ADMIN + CAP_DAC_READ_SEARCH and Linux 5.9
+//         inotify               http://linux.die.net/man/7/inotify  -> fallback: one watch per directory
 //OS X:    kqueue                http://developer.apple.com/library/mac/documentation/Darwin/Reference/ManPages/man2/kqueue.2.html
 
 //watch directory including subdirectories
@@ -28,12 +30,15 @@ namespace zen
              Renaming of top watched directory handled incorrectly: Not notified(!) + additional changes in subfolders
              now do report FILE_ACTION_MODIFIED for directory (check that should prevent this fails!)
 
-    Linux: newly added subdirectories are reported but not automatically added for watching! -> reset Dirwatcher!
-           removal of top watched directory is NOT notified!
+    Linux: fanotify: single mark for the whole file system, changes are filtered by path => no setup per subdirectory, but
+                     items of moved in subdirectories are not reported individually (same as Windows)
+           inotify:  newly added (or moved in) subdirectories are added for watching by getChanges(), including their items which are reported as "created"
+                     removal of top watched directory is NOT notified!
+                     event queue overflow: reported as "Overflow." change, watches for subdirectories added in the meantime are added
 
     OS X: everything works as expected; renaming of top level folder is also detected
 
-    Overcome all issues portably: check existence of top watched directory externally + reinstall watch after changes in directory structure (added directories) are detected
+    Overcome all issues portably: check existence of top watched directory externally
 */
 class DirWatcher
 {
@@ -60,6 +65,10 @@ public:
     //extract accumulated changes since last call
     std::vector<Entry> getChanges(const std::function<void()>& processGuiMessages); //throw FileError
 
+    //block until changes are available for at least one of the watchers or the timeout expires => no need to poll getChanges() at a high rate
+    //Linux: poll() on the notification descriptors; Windows: wait for the change events (more than MAXIMUM_WAIT_OBJECTS watchers: sleep); OS X: sleep
+    static void waitForChanges(const std::vector<const DirWatcher*>& watchers, std::chrono::milliseconds timeout); //noexcept
+
 private:
     DirWatcher           (const DirWatcher&) = delete;
     DirWatcher& operator=(const DirWatcher&) = delete;
@@ -27,6 +27,7 @@
 #include "symlink_target.h"
 #include "file_id_def.h"
 #include "serialize.h"
+#include "xxhash64.h"
 
 #ifdef ZEN_WIN
     #include <Aclapi.h>
@@ -54,6 +55,10 @@ typedef struct _FILE_BASIC_INFO {
 #elif defined ZEN_LINUX
     #include <sys/vfs.h> //statfs
     #include <sys/time.h> //lutimes
+    #include <sys/ioctl.h>
+    #include <sys/sendfile.h>
+    #include <sys/syscall.h> //copy_file_range: no wrapper before glibc 2.27
+    #include <linux/fs.h> //FICLONE
     #ifdef HAVE_SELINUX
         #include <selinux/selinux.h>
     #endif
@@ -250,6 +255,47 @@ std::uint64_t zen::getFilesize(const Zstring& filePath) //throw FileError
 }
 
 
+std::int64_t zen::getFileTime(const Zstring& itemPath) //throw FileError
+{
+#ifdef ZEN_WIN
+    {
+        WIN32_FIND_DATA fileInfo = {};
+        const HANDLE searchHandle = ::FindFirstFile(applyLongPathPrefix(itemPath).c_str(), &fileInfo);
+        if (searchHandle == INVALID_HANDLE_VALUE)
+            THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot read file attributes of %x."), L"%x", fmtPath(itemPath)), L"FindFirstFile");
+        ::FindClose(searchHandle);
+
+        if (!isSymlink(fileInfo))
+            return filetimeToTimeT(fileInfo.ftLastWriteTime);
+    }
+
+    //open handle to target of symbolic link
+    const HANDLE hItem = ::CreateFile(applyLongPathPrefix(itemPath).c_str(),                  //_In_      LPCTSTR lpFileName,
+                                      0,                                                      //_In_      DWORD dwDesiredAccess,
+                                      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, //_In_      DWORD dwShareMode,
+                                      nullptr,                                                //_In_opt_  LPSECURITY_ATTRIBUTES lpSecurityAttributes,
+                                      OPEN_EXISTING,                                          //_In_      DWORD dwCreationDisposition,
+                                      FILE_FLAG_BACKUP_SEMANTICS, /*needed to open a directory*/ //_In_      DWORD dwFlagsAndAttributes,
+                                      nullptr);                                               //_In_opt_  HANDLE hTemplateFile
+    if (hItem == INVALID_HANDLE_VALUE)
+        THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot read file attributes of %x."), L"%x", fmtPath(itemPath)), L"CreateFile");
+    ZEN_ON_SCOPE_EXIT(::CloseHandle(hItem));
+
+    BY_HANDLE_FILE_INFORMATION itemInfoHnd = {};
+    if (!::GetFileInformationByHandle(hItem, &itemInfoHnd))
+        THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot read file attributes of %x."), L"%x", fmtPath(itemPath)), L"GetFileInformationByHandle");
+    return filetimeToTimeT(itemInfoHnd.ftLastWriteTime);
+
+#elif defined ZEN_LINUX || defined ZEN_MAC
+    struct ::stat itemInfo = {};
+    if (::stat(itemPath.c_str(), &itemInfo) != 0)
+        THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot read file attributes of %x."), L"%x", fmtPath(itemPath)), L"stat");
+
+    return itemInfo.st_mtime;
+#endif
+}
+
+
 std::uint64_t zen::getFreeDiskSpace(const Zstring& path) //throw FileError, returns 0 if not available
 {
 #ifdef ZEN_WIN
@@ -2224,6 +2270,7 @@ InSyncAttributes copyFileWindowsSelectRoutine(const Zstring& sourceFile, const Z
 inline
 InSyncAttributes copyFileOsSpecific(const Zstring& sourceFile,
                                     const Zstring& targetFile,
+                                    bool computeContentHash, //not supported: file content is not visible for ::CopyFileEx() and ::BackupWrite() callers
                                     const std::function<void(std::int64_t bytesDelta)>& onUpdateCopyStatus)
 {
     try
@@ -2244,8 +2291,111 @@ InSyncAttributes copyFileOsSpecific(const Zstring& sourceFile,
 
 
 #elif defined ZEN_LINUX || defined ZEN_MAC
+#ifdef ZEN_LINUX
+/*
+copy file content within the kernel, if possible:
+    1. FICLONE:         reflink (Btrfs, XFS): source and target share the same data extents => no data is copied at all
+    2. copy_file_range: no round trip through user space, may be offloaded to the server (NFS 4.2, SMB) or use reflinks itself
+    3. sendfile:        no round trip through user space
+    4. copyStream:      read/write loop
+each routine continues at the current file positions of the previous one => fall back even after a partial copy
+*/
+bool isKernelCopyUnsupported(int ec)
+{
+    return ec == ENOSYS     || //kernel too old
+           ec == EXDEV      || //copy_file_range: cross-file system copy (kernel < 5.3)
+           ec == EINVAL     || //file system does not support the operation
+           ec == EOPNOTSUPP || //
+           ec == EBADF;        //e.g. target opened with O_APPEND by FUSE
+}
+
+
+void copyFileContentLinux(FileInput& fileIn, FileOutput& fileOut, std::uint64_t fileSize, //throw FileError, X
+                          const Zstring& sourceFile, const Zstring& targetFile,
+                          const std::function<void(std::int64_t bytesDelta)>& onUpdateCopyStatus)
+{
+    const size_t KERNEL_COPY_BLOCK_SIZE = 8 * 1024 * 1024; //limit bytes per call => keep progress updates and cancellation responsive
+
+    const int fdSource = fileIn .getHandle();
+    const int fdTarget = fileOut.getHandle();
+
+#ifdef FICLONE
+    if (fileSize > 0 && ::ioctl(fdTarget, FICLONE, fdSource) == 0)
+    {
+        if (onUpdateCopyStatus) onUpdateCopyStatus(fileSize); //throw X!
+        return;
+    }
+    //reflinks are an optimization only: EOPNOTSUPP, EXDEV, EINVAL, ENOTTY, ... => copy the data instead
+#endif
+
+    auto throwCopyError = [&](const wchar_t* functionName, int ec)
+    {
+        throw FileError(replaceCpy(replaceCpy(_("Cannot copy file %x to %y."), L"%x", L"\n" + fmtPath(sourceFile)), L"%y", L"\n" + fmtPath(targetFile)),
+                        formatSystemError(functionName, ec));
+    };
+
+    //returns false if the routine is not supported and nothing has been copied
+    auto copyKernel = [&](const wchar_t* functionName, const std::function<ssize_t(size_t bytesToCopy)>& copyBlock) //throw FileError, X
+    {
+        std::uint64_t bytesCopied = 0;
+        for (;;)
+        {
+            const ssize_t bytesWritten = copyBlock(KERNEL_COPY_BLOCK_SIZE);
+            if (bytesWritten < 0)
+            {
+                const int ec = errno; //copy before making other system calls!
+                if (ec == EINTR)
+                    continue;
+                if (isKernelCopyUnsupported(ec))
+                    return false; //continue with next routine at current file positions
+                throwCopyError(functionName, ec);
+            }
+            if (bytesWritten == 0) //end of file
+                //special files (e.g. procfs) report 0 bytes although having content => let the next routine read them
+                return bytesCopied > 0 || fileSize == 0;
+
+            bytesCopied += bytesWritten;
+            if (onUpdateCopyStatus) onUpdateCopyStatus(bytesWritten); //throw X!
+        }
+    };
+
+#ifdef __NR_copy_file_range
+    if (copyKernel(L"copy_file_range", [&](size_t bytesToCopy) { return static_cast<ssize_t>(::syscall(__NR_copy_file_range, fdSource, nullptr, fdTarget, nullptr, bytesToCopy, 0)); }))
+        return;
+#endif
+    if (copyKernel(L"sendfile", [&](size_t bytesToCopy) { return ::sendfile(fdTarget, fdSource, nullptr, bytesToCopy); }))
+        return;
+
+    copyStream(fileIn, fileOut, std::min(fileIn .optimalBlockSize(),
+                                         fileOut.optimalBlockSize()), onUpdateCopyStatus); //throw FileError, X
+}
+#endif
+
+
+//copy file content through user space and calculate its hash on the fly
+std::uint64_t copyStreamWithHash(FileInput& fileIn, FileOutput& fileOut, size_t blockSize, //throw FileError, X
+                                 const std::function<void(std::int64_t bytesDelta)>& onUpdateCopyStatus)
+{
+    XxHash64 hash;
+    std::vector<char> buffer(blockSize);
+    for (;;)
+    {
+        const size_t bytesRead = fileIn.read(&buffer[0], buffer.size()); //throw FileError
+        fileOut.write(&buffer[0], bytesRead); //throw FileError
+        hash.update(&buffer[0], bytesRead);
+
+        if (onUpdateCopyStatus)
+            onUpdateCopyStatus(bytesRead); //throw X!
+
+        if (bytesRead != buffer.size()) //end of file
+            return hash.digest();
+    }
+}
+
+
 InSyncAttributes copyFileOsSpecific(const Zstring& sourceFile, //throw FileError, ErrorTargetExisting
                                     const Zstring& targetFile,
+                                    bool computeContentHash,
                                     const std::function<void(std::int64_t bytesDelta)>& onUpdateCopyStatus)
 {
     FileInput fileIn(sourceFile); //throw FileError
@@ -2279,8 +2429,16 @@ InSyncAttributes copyFileOsSpecific(const Zstring& sourceFile, //throw FileError
         FileOutput fileOut(fdTarget, targetFile); //pass ownership
         if (onUpdateCopyStatus) onUpdateCopyStatus(0); //throw X!
 
-        copyStream(fileIn, fileOut, std::min(fileIn .optimalBlockSize(),
-                                             fileOut.optimalBlockSize()), onUpdateCopyStatus); //throw FileError, X
+        if (computeContentHash) //data must pass through user space => no kernel copy
+            newAttrib.contentHash = copyStreamWithHash(fileIn, fileOut, std::min(fileIn .optimalBlockSize(),
+                                                                                 fileOut.optimalBlockSize()), onUpdateCopyStatus); //throw FileError, X
+        else
+#ifdef ZEN_LINUX
+            copyFileContentLinux(fileIn, fileOut, sourceInfo.st_size, sourceFile, targetFile, onUpdateCopyStatus); //throw FileError, X
+#else
+            copyStream(fileIn, fileOut, std::min(fileIn .optimalBlockSize(),
+                                                 fileOut.optimalBlockSize()), onUpdateCopyStatus); //throw FileError, X
+#endif
 
         struct ::stat targetInfo = {};
         if (::fstat(fileOut.getHandle(), &targetInfo) != 0)
@@ -2341,9 +2499,10 @@ copyFileWindowsDefault(::CopyFileEx)  copyFileWindowsBackupStream(::BackupRead/:
 
 
 InSyncAttributes zen::copyNewFile(const Zstring& sourceFile, const Zstring& targetFile, bool copyFilePermissions, //throw FileError, ErrorTargetExisting, ErrorFileLocked
+                                  bool computeContentHash,
                                   const std::function<void(std::int64_t bytesDelta)>& onUpdateCopyStatus)
 {
-    const InSyncAttributes attr = copyFileOsSpecific(sourceFile, targetFile, onUpdateCopyStatus); //throw FileError, ErrorTargetExisting, ErrorFileLocked
+    const InSyncAttributes attr = copyFileOsSpecific(sourceFile, targetFile, computeContentHash, onUpdateCopyStatus); //throw FileError, ErrorTargetExisting, ErrorFileLocked
 
     //at this point we know we created a new file, so it's fine to delete it for cleanup!
     ZEN_ON_SCOPE_FAIL(try { removeFile(targetFile); }
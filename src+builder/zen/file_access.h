@@ -11,6 +11,7 @@
 #include "zstring.h"
 #include "file_error.h"
 #include "file_id_def.h"
+#include "optional.h"
 
 
 namespace zen
@@ -30,6 +31,7 @@ void setFileTime(const Zstring& filePath, std::int64_t modificationTime, ProcSym
 
 //symlink handling: always evaluate target
 std::uint64_t getFilesize(const Zstring& filePath); //throw FileError
+std::int64_t  getFileTime(const Zstring& itemPath); //throw FileError; number of seconds since Jan. 1st 1970 UTC
 std::uint64_t getFreeDiskSpace(const Zstring& path); //throw FileError, returns 0 if not available
 
 bool removeFile(const Zstring& filePath); //throw FileError; return "false" if file is not existing
@@ -59,9 +61,11 @@ struct InSyncAttributes
     std::int64_t modificationTime = 0; //time_t UTC compatible
     FileId sourceFileId;
     FileId targetFileId;
+    Opt<std::uint64_t> contentHash; //XxHash64 of the data written; only if requested and supported by the copy routine
 };
 
 InSyncAttributes copyNewFile(const Zstring& sourceFile, const Zstring& targetFile, bool copyFilePermissions, //throw FileError, ErrorTargetExisting, ErrorFileLocked
+                             bool computeContentHash, //Windows: not supported by ::CopyFileEx()
                              //accummulated delta != file size! consider ADS, sparse, compressed files
                              const std::function<void(std::int64_t bytesDelta)>& onUpdateCopyStatus); //may be nullptr; throw X!
 }
@@ -180,6 +180,24 @@ FileInput::~FileInput()
 }
 
 
+void FileInput::setPosition(std::uint64_t offset) //throw FileError
+{
+#ifdef ZEN_WIN
+    LARGE_INTEGER pos = {};
+    pos.QuadPart = offset;
+    if (!::SetFilePointerEx(fileHandle,  //__in       HANDLE hFile,
+                            pos,         //__in       LARGE_INTEGER liDistanceToMove,
+                            nullptr,     //__out_opt  PLARGE_INTEGER lpNewFilePointer,
+                            FILE_BEGIN)) //__in       DWORD dwMoveMethod
+        THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot read file %x."), L"%x", fmtPath(getFilePath())), L"SetFilePointerEx");
+
+#elif defined ZEN_LINUX || defined ZEN_MAC
+    if (::lseek(fileHandle, offset, SEEK_SET) == static_cast<off_t>(-1))
+        THROW_LAST_FILE_ERROR(replaceCpy(_("Cannot read file %x."), L"%x", fmtPath(getFilePath())), L"lseek");
+#endif
+}
+
+
 size_t FileInput::read(void* buffer, size_t bytesToRead) //throw FileError; returns actual number of bytes read
 {
     size_t bytesReadTotal = 0;
@@ -55,6 +55,7 @@ public:
     ~FileInput();
 
     size_t read(void* buffer, size_t bytesToRead); //throw FileError; returns "bytesToRead", unless end of file!
+    void setPosition(std::uint64_t offset); //throw FileError; random access: next read() starts at "offset"
     FileHandle getHandle() { return fileHandle; }
     size_t optimalBlockSize() const { return 128 * 1024; }
 
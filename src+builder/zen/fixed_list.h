@@ -9,6 +9,7 @@
 
 #include <cassert>
 #include <iterator>
+#include "arena.h"
 
 
 namespace zen
@@ -29,6 +30,8 @@ class FixedList
 
 public:
     FixedList() {}
+    explicit FixedList(Arena& arena) : arena_(&arena) {} //allocate nodes from "arena" which must outlive this list
+
 
     ~FixedList() { clear(); }
 
@@ -68,7 +71,13 @@ public:
     const_reference& back() const { return lastInsert->val; }
 
     template <class... Args>
-    void emplace_back(Args&& ... args) { pushNode(new Node(std::forward<Args>(args)...)); }
+    void emplace_back(Args&& ... args)
+    {
+        if (arena_)
+            pushNode(new (arena_->allocate(sizeof(Node), alignof(Node))) Node(std::forward<Args>(args)...)); //throw std::bad_alloc
+        else
+            pushNode(new Node(std::forward<Args>(args)...));
+    }
 
     template <class Predicate>
     void remove_if(Predicate pred)
@@ -115,11 +124,14 @@ public:
 
     size_t size() const { return sz; }
 
+    Arena* getArena() const { return arena_; } //nullptr if nodes are allocated individually
+
     void swap(FixedList& other)
     {
         std::swap(firstInsert, other.firstInsert);
         std::swap(lastInsert , other.lastInsert);
         std::swap(sz         , other.sz);
+        std::swap(arena_     , other.arena_);
     }
 
 private:
@@ -146,12 +158,16 @@ private:
     {
         assert(sz > 0);
         --sz;
-        delete oldNode;
+        if (arena_)
+            oldNode->~Node(); //memory is released together with the arena
+        else
+            delete oldNode;
     }
 
     Node* firstInsert = nullptr;
     Node* lastInsert  = nullptr; //point to last insertion; required by efficient emplace_back()
     size_t sz = 0;
+    Arena* arena_ = nullptr; //optional
 };
 }
 
@@ -84,7 +84,7 @@ struct BinOutputStream
 template <class BinContainer>
 struct MemoryStreamIn
 {
-    MemoryStreamIn(const BinContainer& cont) : buffer(cont), pos(0) {} //this better be cheap!
+    MemoryStreamIn(const BinContainer& cont, size_t startPos = 0) : buffer(cont), pos(std::min(startPos, cont.size())) {} //this better be cheap!
 
     size_t read(void* data, size_t len) //return "len" bytes unless end of stream!
     {
@@ -124,7 +124,7 @@ void shellExecute(const Zstring& command, ExecutionType type) //throw FileError
             throw FileError(_("Incorrect command line:") + L"\n" + utfCvrtTo<std::wstring>(command));
     }
     else
-        runAsync([=] { int rv = ::system(command.c_str()); (void)rv; });
+        std::thread([=] { int rv = ::system(command.c_str()); (void)rv; }).detach(); //may run indefinitely: don't occupy a runAsync() pool thread
 #endif
 }
 }
@@ -9,6 +9,9 @@
 
 #include <thread>
 #include <future>
+#include <deque>
+#include <vector>
+#include <functional>
 #include "scope_guard.h"
 #include "type_traits.h"
 #include "optional.h"
@@ -67,10 +70,16 @@ void setCurrentThreadName(const char* threadName);
 #endif
 //------------------------------------------------------------------------------------------
 
+class AsyncCancellation;
+
 /*
 std::async replacement without crappy semantics:
     1. guaranteed to run asynchronously
     2. does not follow C++11 [futures.async], Paragraph 5, where std::future waits for thread in destructor
+    3. runs on a process-wide pool of reusable threads: their number stays bounded even if tasks hang, e.g. on an unreachable network path
+        => don't wait for other runAsync() tasks without a time out: they may not have been started yet! see runAsyncCompute()
+        => use a dedicated thread for tasks running indefinitely
+    4. tasks may call interruptionPoint(), interruptibleWait(), interruptibleSleep(): see AsyncCancellation
 
 Example:
         Zstring dirpath = ...
@@ -79,7 +88,28 @@ Example:
             //dir exising
 */
 template <class Function>
-auto runAsync(Function&& fun);
+auto runAsync(Function&& fun, AsyncCancellation* cancellation = nullptr);
+
+//CPU-bound tasks the caller waits for without a time out: never queued behind hung runAsync() tasks, but started
+//right away on an idle pool thread or a new one, even beyond the pool's thread limit
+template <class Function>
+auto runAsyncCompute(Function&& fun);
+
+//cancel tasks started by runAsync(): tasks not yet started are skipped (std::future reports "broken_promise"),
+//running tasks are interrupted at their next interruption point (std::future reports ThreadInterruption)
+class AsyncCancellation
+{
+public:
+    void cancel();
+
+private:
+    template <class Function> friend auto runAsync(Function&& fun, AsyncCancellation* cancellation);
+    void add(const std::shared_ptr<InterruptionStatus>& intStatus);
+
+    std::mutex lockTasks;
+    bool cancelled = false;
+    std::vector<std::shared_ptr<InterruptionStatus>> tasks;
+};
 
 //wait for all with a time limit: return true if *all* results are available!
 template<class InputIterator, class Duration>
@@ -146,38 +176,6 @@ private:
 
 //###################### implementation ######################
 
-namespace impl
-{
-template <class Function> inline
-auto runAsync(Function&& fun, TrueType /*copy-constructible*/)
-{
-    typedef decltype(fun()) ResultType;
-
-    //note: std::packaged_task does NOT support move-only function objects!
-    std::packaged_task<ResultType()> pt(std::forward<Function>(fun));
-    auto fut = pt.get_future();
-    std::thread(std::move(pt)).detach(); //we have to explicitly detach since C++11: [thread.thread.destr] ~thread() calls std::terminate() if joinable()!!!
-    return fut;
-}
-
-
-template <class Function> inline
-auto runAsync(Function&& fun, FalseType /*copy-constructible*/)
-{
-    //support move-only function objects!
-    auto sharedFun = std::make_shared<Function>(std::forward<Function>(fun));
-    return runAsync([sharedFun] { return (*sharedFun)(); }, TrueType());
-}
-}
-
-
-template <class Function> inline
-auto runAsync(Function&& fun)
-{
-    return impl::runAsync(std::forward<Function>(fun), StaticBool<std::is_copy_constructible<Function>::value>());
-}
-
-
 template<class InputIterator, class Duration> inline
 bool wait_for_all_timed(InputIterator first, InputIterator last, const Duration& duration)
 {
@@ -248,9 +246,8 @@ template <class T>
 template <class Fun> inline
 void GetFirstResult<T>::addJob(Fun&& f) //f must return a zen::Opt<T> containing a value on success
 {
-    std::thread t([asyncResult = this->asyncResult_, f = std::forward<Fun>(f)] { asyncResult->reportFinished(f()); });
+    runAsync([asyncResult = this->asyncResult_, f = std::forward<Fun>(f)] { asyncResult->reportFinished(f()); });
     ++jobsTotal_;
-    t.detach(); //we have to be explicit since C++11: [thread.thread.destr] ~thread() calls std::terminate() if joinable()!!!
 }
 
 
@@ -415,6 +412,157 @@ inline
 void InterruptibleThread::interrupt() { intStatus_->interrupt(); }
 
 
+namespace impl
+{
+class AsyncThreadPool
+{
+public:
+    static AsyncThreadPool& instance()
+    {
+        static AsyncThreadPool& inst = *new AsyncThreadPool; //never destroyed: workers are detached and may still be running at exit
+        return inst;
+    }
+
+    //limited: task may hang (e.g. I/O on an unreachable network path) => queue it once THREADS_MAX threads are busy
+    void run(std::function<void()>&& task, const std::shared_ptr<InterruptionStatus>& intStatus, bool limited)
+    {
+        {
+            std::lock_guard<std::mutex> dummy(lockQueue);
+            (limited ? tasks : tasksUnlimited).emplace_back(std::move(task), intStatus);
+
+            //idle threads pick unlimited tasks first => enough threads for these, no matter how many others are hung
+            if ((tasks.size() + tasksUnlimited.size() > threadsIdle && threadsTotal < THREADS_MAX) ||
+                tasksUnlimited.size() > threadsIdle)
+            {
+                ++threadsTotal;
+                std::thread([this] { workerLoop(); }).detach(); //we have to explicitly detach since C++11: [thread.thread.destr] ~thread() calls std::terminate() if joinable()!!!
+            }
+        }
+        conditionNewTask.notify_one();
+    }
+
+private:
+    AsyncThreadPool() {}
+    AsyncThreadPool           (const AsyncThreadPool&) = delete;
+    AsyncThreadPool& operator=(const AsyncThreadPool&) = delete;
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> dummy(lockQueue);
+        for (;;)
+        {
+            ++threadsIdle;
+            const bool haveTask = conditionNewTask.wait_for(dummy, THREAD_IDLE_TIME_MAX, [this] { return !tasks.empty() || !tasksUnlimited.empty(); });
+            --threadsIdle;
+            if (!haveTask) //don't keep threads around in long-running processes after a burst of tasks
+            {
+                --threadsTotal;
+                return;
+            }
+
+            {
+                TaskQueue& queue = !tasksUnlimited.empty() ? tasksUnlimited : tasks;
+                std::pair<std::function<void()>, std::shared_ptr<InterruptionStatus>> task = std::move(queue.front());
+                queue.pop_front();
+                dummy.unlock();
+                ZEN_ON_SCOPE_EXIT(dummy.lock());
+
+                refThreadLocalInterruptionStatus() = task.second.get();
+                ZEN_ON_SCOPE_EXIT(refThreadLocalInterruptionStatus() = nullptr);
+                try
+                {
+                    task.second->checkInterruption(); //throw ThreadInterruption: cancelled before being started
+                    task.first(); //std::packaged_task: stores exceptions in the std::future
+                }
+                catch (ThreadInterruption&) {}
+            } //destroy task (and captured data) before going idle
+        }
+    }
+
+    static const size_t THREADS_MAX = 64; //hung tasks don't block the others until there are this many; see run()
+    const std::chrono::seconds THREAD_IDLE_TIME_MAX{ 60 };
+
+    using TaskQueue = std::deque<std::pair<std::function<void()>, std::shared_ptr<InterruptionStatus>>>;
+
+    std::mutex lockQueue;
+    std::condition_variable conditionNewTask;
+    TaskQueue tasks;
+    TaskQueue tasksUnlimited;
+    size_t threadsTotal = 0;
+    size_t threadsIdle  = 0;
+};
+
+
+template <class Function> inline
+auto runAsync(Function&& fun, const std::shared_ptr<InterruptionStatus>& intStatus, bool limited, TrueType /*copy-constructible*/)
+{
+    typedef decltype(fun()) ResultType;
+
+    //note: std::packaged_task does NOT support move-only function objects!
+    //std::function requires a copy-constructible function object => share the std::packaged_task
+    auto pt = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Function>(fun));
+    auto fut = pt->get_future();
+    AsyncThreadPool::instance().run([pt] { (*pt)(); }, intStatus, limited);
+    return fut;
+}
+
+
+template <class Function> inline
+auto runAsync(Function&& fun, const std::shared_ptr<InterruptionStatus>& intStatus, bool limited, FalseType /*copy-constructible*/)
+{
+    //support move-only function objects!
+    auto sharedFun = std::make_shared<typename std::decay<Function>::type>(std::forward<Function>(fun));
+    return runAsync([sharedFun] { return (*sharedFun)(); }, intStatus, limited, TrueType());
+}
+}
+
+
+template <class Function> inline
+auto runAsync(Function&& fun, AsyncCancellation* cancellation)
+{
+    auto intStatus = std::make_shared<InterruptionStatus>();
+    if (cancellation)
+        cancellation->add(intStatus);
+
+    using FunType = typename std::decay<Function>::type;
+    return impl::runAsync(std::forward<Function>(fun), intStatus, true /*limited*/, StaticBool<std::is_copy_constructible<FunType>::value>());
+}
+
+
+template <class Function> inline
+auto runAsyncCompute(Function&& fun)
+{
+    using FunType = typename std::decay<Function>::type;
+    return impl::runAsync(std::forward<Function>(fun), std::make_shared<InterruptionStatus>(), false /*limited*/, StaticBool<std::is_copy_constructible<FunType>::value>());
+}
+
+
+inline
+void AsyncCancellation::add(const std::shared_ptr<InterruptionStatus>& intStatus)
+{
+    std::lock_guard<std::mutex> dummy(lockTasks);
+    if (cancelled)
+        intStatus->interrupt();
+    else
+        tasks.push_back(intStatus);
+}
+
+
+inline
+void AsyncCancellation::cancel()
+{
+    std::vector<std::shared_ptr<InterruptionStatus>> tasksTmp;
+    {
+        std::lock_guard<std::mutex> dummy(lockTasks);
+        cancelled = true;
+        tasksTmp.swap(tasks);
+    }
+    //newest first: a worker freed by interrupting an older task must not pick up a queued task before its status is set
+    for (auto it = tasksTmp.rbegin(); it != tasksTmp.rend(); ++it)
+        (*it)->interrupt();
+}
+
+
 #ifdef ZEN_WIN
 //https://randomascii.wordpress.com/2015/10/26/thread-naming-in-windows-time-for-something-better/
 
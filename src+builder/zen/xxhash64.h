@@ -0,0 +1,160 @@
+// **************************************************************************
+// * This file is part of the FreeFileSync project. It is distributed under *
+// * GNU General Public License: http://www.gnu.org/licenses/gpl-3.0        *
+// * Copyright (C) Zenju (zenju AT gmx DOT de) - All Rights Reserved        *
+// **************************************************************************
+
+#ifndef XXHASH64_H_8340958723409857234
+#define XXHASH64_H_8340958723409857234
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <cstddef>
+
+
+namespace zen
+{
+/*
+streaming implementation of the xxHash64 algorithm: http://cyan4973.github.io/xxHash/
+    - fast non-cryptographic hash: good enough to detect corrupt data, but NOT tampering!
+    - feed data in blocks of arbitrary size: result is identical to hashing all data at once
+
+    XxHash64 hash;
+    hash.update(buf, size);
+    ...
+    std::uint64_t digest = hash.digest();
+*/
+class XxHash64
+{
+public:
+    explicit XxHash64(std::uint64_t seed = 0) :
+        v1_(seed + PRIME1 + PRIME2),
+        v2_(seed + PRIME2),
+        v3_(seed),
+        v4_(seed - PRIME1),
+        seed_(seed) {}
+
+    void update(const void* data, size_t len)
+    {
+        const unsigned char* it  = static_cast<const unsigned char*>(data);
+        const unsigned char* end = it + len;
+        totalLen_ += len;
+
+        if (bufferLen_ > 0) //complete pending stripe first
+        {
+            const size_t bytesToCopy = std::min<size_t>(len, STRIPE_SIZE - bufferLen_);
+            std::memcpy(buffer_ + bufferLen_, it, bytesToCopy);
+            bufferLen_ += bytesToCopy;
+            it         += bytesToCopy;
+
+            if (bufferLen_ < STRIPE_SIZE)
+                return;
+            processStripe(buffer_);
+            bufferLen_ = 0;
+        }
+
+        for (; end - it >= static_cast<std::ptrdiff_t>(STRIPE_SIZE); it += STRIPE_SIZE)
+            processStripe(it);
+
+        std::memcpy(buffer_, it, end - it);
+        bufferLen_ = end - it;
+    }
+
+    std::uint64_t digest() const
+    {
+        std::uint64_t h = 0;
+        if (totalLen_ >= STRIPE_SIZE)
+        {
+            h = rotl(v1_, 1) + rotl(v2_, 7) + rotl(v3_, 12) + rotl(v4_, 18);
+            h = mergeRound(h, v1_);
+            h = mergeRound(h, v2_);
+            h = mergeRound(h, v3_);
+            h = mergeRound(h, v4_);
+        }
+        else
+            h = seed_ + PRIME5;
+
+        h += totalLen_;
+
+        const unsigned char* it  = buffer_;
+        const unsigned char* end = buffer_ + bufferLen_;
+
+        for (; end - it >= 8; it += 8)
+        {
+            h ^= round(0, read64(it));
+            h = rotl(h, 27) * PRIME1 + PRIME4;
+        }
+        if (end - it >= 4)
+        {
+            h ^= static_cast<std::uint64_t>(read32(it)) * PRIME1;
+            h = rotl(h, 23) * PRIME2 + PRIME3;
+            it += 4;
+        }
+        for (; it != end; ++it)
+        {
+            h ^= *it * PRIME5;
+            h = rotl(h, 11) * PRIME1;
+        }
+
+        //avalanche
+        h ^= h >> 33;
+        h *= PRIME2;
+        h ^= h >> 29;
+        h *= PRIME3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static const std::uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    static const std::uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    static const std::uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+    static const std::uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    static const std::uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+    static const size_t STRIPE_SIZE = 32;
+
+    static std::uint64_t rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    //data is read as little endian: digest does not depend on the platform
+    static std::uint64_t read64(const unsigned char* p) { return static_cast<std::uint64_t>(read32(p)) | static_cast<std::uint64_t>(read32(p + 4)) << 32; }
+    static std::uint32_t read32(const unsigned char* p)
+    {
+        return static_cast<std::uint32_t>(p[0])       | static_cast<std::uint32_t>(p[1]) << 8 |
+               static_cast<std::uint32_t>(p[2]) << 16 | static_cast<std::uint32_t>(p[3]) << 24;
+    }
+
+    static std::uint64_t round(std::uint64_t acc, std::uint64_t input)
+    {
+        acc += input * PRIME2;
+        acc = rotl(acc, 31);
+        return acc * PRIME1;
+    }
+
+    static std::uint64_t mergeRound(std::uint64_t acc, std::uint64_t val)
+    {
+        acc ^= round(0, val);
+        return acc * PRIME1 + PRIME4;
+    }
+
+    void processStripe(const unsigned char* p)
+    {
+        v1_ = round(v1_, read64(p));
+        v2_ = round(v2_, read64(p + 8));
+        v3_ = round(v3_, read64(p + 16));
+        v4_ = round(v4_, read64(p + 24));
+    }
+
+    std::uint64_t v1_;
+    std::uint64_t v2_;
+    std::uint64_t v3_;
+    std::uint64_t v4_;
+    const std::uint64_t seed_;
+    std::uint64_t totalLen_ = 0;
+
+    unsigned char buffer_[STRIPE_SIZE]; //pending bytes of an incomplete stripe
+    size_t bufferLen_ = 0;
+};
+}
+
+#endif //XXHASH64_H_8340958723409857234